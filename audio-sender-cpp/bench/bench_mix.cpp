@@ -0,0 +1,141 @@
+// Microbenchmark for the relay's mix-minus mixer.
+// For N participants, times one 20 ms frame of N outputs three ways: the
+// naive mix (each output sums the N - 1 others), mix-minus with the scalar
+// kernels, and mix-minus with the SIMD kernels. Checks that all three agree,
+// and that a late packet (reordered, or rebuilt by FEC) still fills its gap.
+
+#include "mixer.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t kFrame = 960;      // 20 ms at 48 kHz, mono
+constexpr int kMinIterations = 50;
+
+template <typename Fn>
+double time_us_per_frame(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+// Every output sums the others directly: N * (N - 1) samples added per position
+void mix_naive(const std::vector<std::vector<int16_t>>& inputs, std::vector<std::vector<int16_t>>& outputs) {
+    for (size_t listener = 0; listener < inputs.size(); listener++) {
+        int16_t* out = outputs[listener].data();
+        for (size_t i = 0; i < kFrame; i++) {
+            int32_t sum = 0;
+            for (size_t speaker = 0; speaker < inputs.size(); speaker++) {
+                if (speaker != listener) sum += inputs[speaker][i];
+            }
+            out[i] = static_cast<int16_t>(std::min(32767, std::max(-32768, sum)));
+        }
+    }
+}
+
+template <typename Accumulate, typename Subtract>
+void mix_minus(const std::vector<std::vector<int16_t>>& inputs, std::vector<std::vector<int16_t>>& outputs,
+               std::vector<int32_t>& acc, Accumulate accumulate, Subtract subtract) {
+    std::fill(acc.begin(), acc.end(), 0);
+    for (const auto& input : inputs) {
+        accumulate(acc.data(), input.data(), kFrame);
+    }
+    for (size_t listener = 0; listener < inputs.size(); listener++) {
+        subtract(acc.data(), inputs[listener].data(), outputs[listener].data(), kFrame);
+    }
+}
+
+// One stream's packets mixed in order, and again with every other pair
+// swapped; the mix must come out the same
+bool late_packets_fill_gaps() {
+    MixerConfig config;
+    Mixer in_order(config);
+    Mixer reordered(config);
+    size_t frames = static_cast<size_t>(config.sample_rate * config.frame_ms / 1000);
+    
+    std::vector<std::vector<uint8_t>> payloads(8, std::vector<uint8_t>(frames * 2));
+    std::vector<PacketHeader> headers(payloads.size());
+    for (size_t p = 0; p < payloads.size(); p++) {
+        for (size_t i = 0; i < frames; i++) {
+            auto sample = static_cast<uint16_t>(static_cast<int16_t>(1000 + p * 100 + i));
+            payloads[p][i * 2] = static_cast<uint8_t>(sample & 0xFF);
+            payloads[p][i * 2 + 1] = static_cast<uint8_t>(sample >> 8);
+        }
+        headers[p].sequence = static_cast<uint32_t>(p);
+        headers[p].timestamp = p * frames;
+        headers[p].sample_rate = static_cast<uint32_t>(config.sample_rate);
+        headers[p].encoding = PayloadEncoding::S16;
+        headers[p].payload_length = static_cast<uint32_t>(frames * 2);
+    }
+    
+    // The first packet starts the stream, so only later ones are swapped
+    in_order.push(1, headers[0], payloads[0].data());
+    reordered.push(1, headers[0], payloads[0].data());
+    for (size_t p = 1; p < payloads.size(); p++) {
+        size_t late = p % 2 == 1 && p + 1 < payloads.size() ? p + 1 : p % 2 == 0 ? p - 1 : p;
+        in_order.push(1, headers[p], payloads[p].data());
+        reordered.push(1, headers[late], payloads[late].data());
+    }
+    
+    std::vector<uint8_t> expected(in_order.frame_bytes());
+    std::vector<uint8_t> actual(reordered.frame_bytes());
+    for (size_t f = 0; f < payloads.size() + 4; f++) {
+        in_order.mix();
+        reordered.mix();
+        in_order.write_mix(expected.data());
+        reordered.write_mix(actual.data());
+        if (expected != actual) return false;
+    }
+    return reordered.stats().filled > 0;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(-20000, 20000);
+    std::vector<int32_t> acc(kFrame);
+    bool identical = true;
+    
+    std::cout << "One " << kFrame << "-sample frame for N listeners, SIMD kernel: " << Mixer::kernel_name() << "\n";
+    std::cout << "  " << std::setw(5) << "N" << std::setw(14) << "naive us" << std::setw(14) << "scalar us"
+              << std::setw(14) << "simd us" << std::setw(10) << "speedup\n";
+    for (size_t n : {2, 4, 16, 64, 256}) {
+        // Loud enough that sums of many clip, so saturation is exercised
+        std::vector<std::vector<int16_t>> inputs(n, std::vector<int16_t>(kFrame));
+        for (auto& input : inputs) {
+            for (int16_t& v : input) v = static_cast<int16_t>(dist(rng));
+        }
+        std::vector<std::vector<int16_t>> naive(n, std::vector<int16_t>(kFrame));
+        std::vector<std::vector<int16_t>> scalar(n, std::vector<int16_t>(kFrame));
+        std::vector<std::vector<int16_t>> simd(n, std::vector<int16_t>(kFrame));
+        
+        int iterations = std::max<int>(kMinIterations, static_cast<int>(20000 / (n * n)));
+        double naive_us = time_us_per_frame(iterations, [&] { mix_naive(inputs, naive); });
+        double scalar_us = time_us_per_frame(iterations, [&] {
+            mix_minus(inputs, scalar, acc, Mixer::accumulate_scalar, Mixer::subtract_scalar);
+        });
+        double simd_us = time_us_per_frame(iterations, [&] {
+            mix_minus(inputs, simd, acc, Mixer::accumulate, Mixer::subtract);
+        });
+        identical = identical && naive == scalar && scalar == simd;
+        
+        std::cout << "  " << std::setw(5) << n << std::fixed << std::setprecision(1) << std::setw(14) << naive_us
+                  << std::setw(14) << scalar_us << std::setw(14) << simd_us << std::setw(9) << naive_us / simd_us
+                  << "x\n";
+    }
+    
+    std::cout << (identical ? "Naive, scalar and SIMD outputs are identical\n" : "MISMATCH between kernels\n");
+    
+    bool filled = late_packets_fill_gaps();
+    std::cout << (filled ? "Late packets fill their gaps\n" : "MISMATCH: late packets are lost\n");
+    return identical && filled ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// Throughput benchmark for a running relay: audio-relay or linux-cli-server.js.
+// Senders push header-framed packets as fast as they can (or at --rate),
+// listeners count what arrives. Reports packets offered, packets delivered to
+// each listener per second, and the share of copies lost on the way.
+//
+//   ./audio-relay -q &                      then  ./bench-relay --udp --port 8081
+//   echo 'udp 8081' | node linux-cli-server.js > /dev/null &  (same command)
+
+#include "packet.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8081;
+    bool stream = false;
+    int senders = 4;
+    int listeners = 4;
+    int seconds = 5;
+    size_t payload = 160;           // 20 ms of 8 kHz s16, or a typical Opus frame
+    int rate = 0;                   // packets per second per sender; 0 = as fast as possible
+};
+
+// Sent once and then every few seconds, so the UDP relay knows a listener
+// that sends nothing else; a headerless byte is not counted as audio
+constexpr auto kHelloInterval = std::chrono::seconds(5);
+
+// Listeners keep counting this long after the senders stop, for queued packets
+constexpr auto kDrainTime = std::chrono::milliseconds(500);
+
+int connect_socket(const Options& options) {
+    int fd = socket(AF_INET, options.stream ? SOCK_STREAM : SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    
+    int buffer = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    if (options.stream) {
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    
+    struct timeval timeout{0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+void run_sender(const Options& options, int fd, uint32_t stream_id, const std::atomic<bool>& sending,
+                std::atomic<uint64_t>& sent) {
+    std::vector<uint8_t> packet(PacketHeader::kSize + options.payload, 0);
+    PacketHeader header;
+    header.stream_id = stream_id;
+    header.sample_rate = 8000;
+    header.encoding = PayloadEncoding::S16;
+    header.payload_length = static_cast<uint32_t>(options.payload);
+    
+    auto next = std::chrono::steady_clock::now();
+    auto interval = std::chrono::nanoseconds(options.rate > 0 ? 1000000000 / options.rate : 0);
+    uint64_t count = 0;
+    while (sending) {
+        header.serialize(packet.data());
+        ssize_t written = send(fd, packet.data(), packet.size(), MSG_NOSIGNAL);
+        if (written < 0 && errno != ENOBUFS && errno != EAGAIN && errno != ECONNREFUSED) break;
+        if (written > 0) {
+            count++;
+            header.sequence++;
+            header.timestamp += options.payload / 2;
+        }
+        if (options.rate > 0) {
+            next += interval;
+            std::this_thread::sleep_until(next);
+        }
+        
+        // Drain what the relay sends back so the socket buffer does not fill
+        if (!options.stream && (count & 63) == 0) {
+            uint8_t discard[2048];
+            while (recv(fd, discard, sizeof(discard), MSG_DONTWAIT) > 0) {}
+        }
+    }
+    sent += count;
+}
+
+void run_listener(const Options& options, int fd, const std::atomic<bool>& listening,
+                  std::atomic<uint64_t>& received) {
+    std::vector<uint8_t> buffer(1 << 16);
+    uint64_t count = 0;
+    
+    // Streams are counted a packet at a time across reads
+    size_t header_fill = 0;
+    uint8_t header_bytes[PacketHeader::kSize];
+    size_t skip = 0;
+    
+    auto next_hello = std::chrono::steady_clock::now();
+    while (listening) {
+        if (!options.stream && std::chrono::steady_clock::now() >= next_hello) {
+            uint8_t hello = 0;
+            send(fd, &hello, 1, 0);
+            next_hello += kHelloInterval;
+        }
+        
+        ssize_t got = recv(fd, buffer.data(), buffer.size(), 0);
+        if (got <= 0) {
+            if (got == 0) break;
+            continue;
+        }
+        
+        if (!options.stream) {
+            PacketHeader header;
+            count += PacketHeader::parse(buffer.data(), static_cast<size_t>(got), header) &&
+                     !(header.flags & PacketHeader::kFlagReport);
+            continue;
+        }
+        
+        const uint8_t* data = buffer.data();
+        size_t size = static_cast<size_t>(got);
+        while (size > 0) {
+            if (skip > 0) {
+                size_t skipped = std::min(skip, size);
+                skip -= skipped;
+                data += skipped;
+                size -= skipped;
+                continue;
+            }
+            size_t take = std::min(PacketHeader::kSize - header_fill, size);
+            std::memcpy(header_bytes + header_fill, data, take);
+            header_fill += take;
+            data += take;
+            size -= take;
+            if (header_fill < PacketHeader::kSize) break;
+            
+            PacketHeader header;
+            if (!PacketHeader::parse(header_bytes, PacketHeader::kSize, header)) {
+                std::cerr << "Lost packet framing on a TCP listener" << std::endl;
+                return;
+            }
+            count++;
+            skip = header.payload_length;
+            header_fill = 0;
+        }
+    }
+    received += count;
+}
+
+bool parse_args(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--tcp") {
+            options.stream = true;
+        } else if (arg == "--udp") {
+            options.stream = false;
+        } else if (arg == "--host" && has_value) {
+            options.host = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            options.port = std::stoi(argv[++i]);
+        } else if (arg == "--senders" && has_value) {
+            options.senders = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--listeners" && has_value) {
+            options.listeners = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seconds" && has_value) {
+            options.seconds = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--payload" && has_value) {
+            options.payload = static_cast<size_t>(std::max(0, std::stoi(argv[++i])));
+        } else if (arg == "--rate" && has_value) {
+            options.rate = std::max(0, std::stoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--tcp|--udp] [--host IP] [--port PORT] [--senders N]"
+                      << " [--listeners N] [--seconds N] [--payload BYTES] [--rate PPS]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_args(argc, argv, options)) return 1;
+    
+    std::vector<int> listener_fds;
+    for (int i = 0; i < options.listeners; i++) {
+        int fd = connect_socket(options);
+        if (fd < 0) {
+            std::cerr << "Cannot reach the relay at " << options.host << ":" << options.port << std::endl;
+            return 1;
+        }
+        listener_fds.push_back(fd);
+    }
+    
+    std::atomic<bool> listening{true};
+    std::atomic<uint64_t> received{0};
+    std::vector<std::thread> listeners;
+    for (int fd : listener_fds) {
+        listeners.emplace_back(run_listener, std::cref(options), fd, std::cref(listening), std::ref(received));
+    }
+    
+    // Let the relay register the listeners before audio flows
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    
+    std::atomic<bool> sending{true};
+    std::atomic<uint64_t> sent{0};
+    std::vector<int> sender_fds;
+    std::vector<std::thread> senders;
+    for (int i = 0; i < options.senders; i++) {
+        int fd = connect_socket(options);
+        if (fd < 0) return 1;
+        sender_fds.push_back(fd);
+        senders.emplace_back(run_sender, std::cref(options), fd, 0x1000u + static_cast<uint32_t>(i),
+                             std::cref(sending), std::ref(sent));
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    sending = false;
+    for (auto& thread : senders) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::this_thread::sleep_for(kDrainTime);
+    listening = false;
+    for (auto& thread : listeners) thread.join();
+    for (int fd : sender_fds) close(fd);
+    for (int fd : listener_fds) close(fd);
+    
+    // Every listener should get every sender's packets
+    uint64_t offered = sent;
+    uint64_t expected = offered * static_cast<uint64_t>(options.listeners);
+    uint64_t delivered = received;
+    double loss = expected > 0 ? 100.0 * (expected - std::min(expected, delivered)) / expected : 0.0;
+    std::cout << (options.stream ? "tcp" : "udp") << " " << options.senders << " senders x " << options.listeners
+              << " listeners, " << options.payload << " B payload, " << seconds << " s\n";
+    std::cout << std::fixed << std::setprecision(0) << "  offered   " << std::setw(10) << offered / seconds
+              << " pkt/s\n"
+              << "  delivered " << std::setw(10) << delivered / seconds << " pkt/s ("
+              << delivered / seconds / options.listeners << " per listener)\n"
+              << std::setprecision(1) << "  lost      " << std::setw(10) << loss << " %\n";
+    return 0;
+}
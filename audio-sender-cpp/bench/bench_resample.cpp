@@ -0,0 +1,106 @@
+// Frequency response check for the polyphase resampler.
+// For each rate pair, feeds pure tones through Resampler and measures the
+// output level: flatness in the passband, and how far tones above the
+// output Nyquist frequency are attenuated before they alias back into it.
+// Upsampling is checked for droop only. Also times the resampler, and exits
+// non-zero if a response is out of bounds.
+
+#include "resampler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr size_t kBlock = 960;
+constexpr double kSeconds = 0.5;
+
+// Limits as fractions of the lower Nyquist frequency
+constexpr double kPassbandEdge = 0.75;      // at most kMaxDroopDb down up to here
+constexpr double kStopbandEdge = 1.125;     // at least kMinRejectionDb down from here
+constexpr double kMaxDroopDb = 1.0;
+constexpr double kMinRejectionDb = 60.0;
+
+// Output level of a full-scale tone at frequency, in dB; the first 0.1 s
+// of output is skipped so the filter has settled
+double tone_level_db(int input_rate, int output_rate, double frequency) {
+    Resampler resampler;
+    resampler.configure(input_rate, output_rate, 1, kBlock);
+    size_t total = static_cast<size_t>(input_rate * kSeconds);
+    std::vector<float> in(kBlock);
+    std::vector<float> out(resampler.max_output_frames(kBlock));
+    size_t skip = static_cast<size_t>(output_rate / 10);
+    size_t produced = 0;
+    double energy = 0.0;
+    size_t counted = 0;
+    for (size_t done = 0; done < total; done += kBlock) {
+        for (size_t i = 0; i < kBlock; i++) {
+            in[i] = static_cast<float>(std::sin(2.0 * kPi * frequency * static_cast<double>(done + i) / input_rate));
+        }
+        size_t frames = resampler.process(in.data(), kBlock, out.data());
+        for (size_t i = 0; i < frames; i++, produced++) {
+            if (produced >= skip) {
+                energy += static_cast<double>(out[i]) * out[i];
+                counted++;
+            }
+        }
+    }
+    double rms = std::sqrt(energy / std::max<size_t>(1, counted));
+    return 20.0 * std::log10(std::max(rms * std::sqrt(2.0), 1e-12));
+}
+
+double ns_per_output(int input_rate, int output_rate) {
+    Resampler resampler;
+    resampler.configure(input_rate, output_rate, 1, kBlock);
+    std::vector<float> in(kBlock, 0.25f);
+    std::vector<float> out(resampler.max_output_frames(kBlock));
+    size_t produced = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; i++) {
+        produced += resampler.process(in.data(), kBlock, out.data());
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / std::max<size_t>(1, produced);
+}
+
+} // namespace
+
+int main() {
+    const int pairs[][2] = {{48000, 16000}, {44100, 16000}, {48000, 8000}, {44100, 48000}, {16000, 48000}};
+    bool within = true;
+    
+    std::cout << "Resampler response (passband to " << kPassbandEdge << ", stopband from " << kStopbandEdge
+              << " of the lower Nyquist)\n";
+    for (const auto& pair : pairs) {
+        int input_rate = pair[0];
+        int output_rate = pair[1];
+        double nyquist = std::min(input_rate, output_rate) / 2.0;
+        
+        // Worst case over a sweep of each band; stopband tones only exist below the input Nyquist
+        double droop = 0.0;
+        for (double f = 100.0; f <= kPassbandEdge * nyquist; f += nyquist / 40) {
+            droop = std::max(droop, -tone_level_db(input_rate, output_rate, f));
+        }
+        double rejection = 1e9;
+        for (double f = kStopbandEdge * nyquist; f < input_rate / 2.0; f += nyquist / 20) {
+            rejection = std::min(rejection, -tone_level_db(input_rate, output_rate, f));
+        }
+        bool ok = droop <= kMaxDroopDb && (rejection >= kMinRejectionDb || output_rate > input_rate);
+        within = within && ok;
+        
+        std::cout << "  " << std::setw(6) << input_rate << " -> " << std::setw(6) << output_rate << std::fixed
+                  << std::setprecision(2) << "  droop " << std::setw(5) << droop << " dB";
+        if (output_rate < input_rate) {
+            std::cout << ", alias rejection " << std::setw(5) << std::setprecision(1) << rejection << " dB";
+        }
+        std::cout << ", " << std::setprecision(1) << ns_per_output(input_rate, output_rate) << " ns/output"
+                  << (ok ? "" : "  OUT OF BOUNDS") << "\n";
+    }
+    
+    std::cout << (within ? "Every response is within bounds\n" : "Some responses are out of bounds\n");
+    return within ? 0 : 1;
+}
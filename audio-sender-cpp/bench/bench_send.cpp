@@ -0,0 +1,161 @@
+// Microbenchmark for the send path.
+// Pushes a burst of header + payload messages through the NetworkEngine to a
+// loopback sink, once with epoll and once with io_uring, over UDP and TCP.
+// Reports messages per second and system calls per message.
+
+#include "network.h"
+#include "net_engine.h"
+#include "shared_buffer.h"
+#include "uring.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kMessages = 200000;
+constexpr size_t kHeaderBytes = 32;
+constexpr int kPort = 47311;
+
+struct Setup {
+    const char* name;
+    bool stream;
+    size_t payload_bytes;
+};
+
+// Reads until the sender is done; UDP may lose datagrams on a busy loopback
+class Sink {
+public:
+    explicit Sink(bool stream) : stream_(stream) {
+        listen_fd_ = socket(AF_INET, stream ? SOCK_STREAM : SOCK_DGRAM, 0);
+        int enable = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        int buffer = 4 << 20;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        
+        struct sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(kPort);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+        if (stream) {
+            listen(listen_fd_, 1);
+        }
+        
+        struct timeval timeout{0, 200000};
+        setsockopt(listen_fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        thread_ = std::thread(&Sink::run, this);
+    }
+    
+    ~Sink() {
+        done_ = true;
+        thread_.join();
+        close(listen_fd_);
+    }
+    
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    void run() {
+        int fd = listen_fd_;
+        if (stream_) {
+            while (!done_ && (fd = accept(listen_fd_, nullptr, nullptr)) < 0) {}
+            if (fd < 0) return;
+            struct timeval timeout{0, 200000};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        }
+        
+        std::vector<uint8_t> buffer(1 << 16);
+        while (!done_) {
+            ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+            if (received > 0) {
+                bytes_ += static_cast<uint64_t>(received);
+            } else if (received == 0 && stream_) {
+                break;
+            }
+        }
+        if (stream_) {
+            close(fd);
+        }
+    }
+    
+    bool stream_;
+    int listen_fd_ = -1;
+    std::atomic<bool> done_{false};
+    std::atomic<uint64_t> bytes_{0};
+    std::thread thread_;
+};
+
+void run(const Setup& setup, IoBackend backend) {
+    Sink sink(setup.stream);
+    std::unique_ptr<Network> network;
+    if (setup.stream) {
+        network = std::make_unique<TCPNetwork>();
+    } else {
+        network = std::make_unique<UDPNetwork>();
+    }
+    if (!network->connect("127.0.0.1", kPort)) return;
+    
+    // A deep queue and waiting for room, so nothing is dropped and the socket sets the pace
+    EngineConfig config;
+    config.sample_rate = 48000;
+    config.queue_ms = 1000;
+    config.wait_when_full = true;
+    config.backend = backend;
+    NetworkEngine engine(*network, config);
+    if (!engine.start()) return;
+    
+    BufferPool pool;
+    pool.configure(setup.payload_bytes, 64);
+    uint8_t header[kHeaderBytes] = {};
+    
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kMessages; i++) {
+        SharedBuffer payload = pool.acquire();
+        payload.resize(setup.payload_bytes);
+        std::memcpy(header, &i, sizeof(i));
+        ConstBuffer parts[2] = {{header, kHeaderBytes}, {payload.data(), payload.size()}};
+        engine.submit(parts, 2, 16, payload);
+    }
+    engine.drain(std::chrono::seconds(10));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    engine.stop();
+    
+    const NetworkStats& stats = network->stats();
+    std::cout << "  " << std::left << std::setw(16) << setup.name << std::setw(10) << io_backend_name(engine.backend())
+              << std::right << std::fixed << std::setprecision(0) << std::setw(10) << stats.messages / seconds
+              << " msg/s" << std::setprecision(3) << std::setw(8)
+              << static_cast<double>(stats.syscalls) / std::max<uint64_t>(1, stats.messages) << " syscalls/msg"
+              << std::setw(8) << engine.stats().zerocopy_sends << " zero-copy\n";
+}
+
+} // namespace
+
+int main() {
+    const Setup setups[] = {
+        {"udp 160 B", false, 160},
+        {"udp 1200 B", false, 1200},
+        {"tcp 160 B", true, 160},
+        {"tcp 4096 B", true, 4096},
+    };
+    
+    std::cout << kMessages << " messages per run, " << kHeaderBytes << "-byte header + payload, loopback\n";
+    if (!IoUring::available()) {
+        std::cout << "io_uring is unavailable here; both runs use epoll\n";
+    }
+    for (const Setup& setup : setups) {
+        run(setup, IoBackend::Epoll);
+        run(setup, IoBackend::Uring);
+    }
+    return 0;
+}
@@ -1,11 +1,35 @@
 #include "audio_base.h"
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // This file provides the factory method implementation
 // Platform-specific implementations are in separate files
 
+int64_t AudioInterface::host_time_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 #if !defined(__APPLE__) && !defined(_WIN32) && !defined(__linux__)
 // Fallback implementation for unsupported platforms
 class DummyAudioInterface : public AudioInterface {
+private:
+    std::vector<float> buffer_;
+
 public:
     std::vector<AudioDevice> list_input_devices() override {
         return {};
@@ -14,15 +38,20 @@ public:
     bool initialize(const AudioConfig& config) override {
         current_config_ = config;
         current_device_name_ = "Dummy Audio Device";
+        buffer_.assign(static_cast<size_t>(config.buffer_size) * config.channels, 0.0f);
         return true;
     }
     
     bool start_capture(AudioCallback callback) override {
         audio_callback_ = callback;
         // Generate dummy audio data for testing
-        std::vector<float> dummy_data(current_config_.buffer_size, 0.0f);
+        AudioBlock block;
+        block.data = buffer_.data();
+        block.frames = current_config_.buffer_size;
+        block.channels = current_config_.channels;
+        block.host_time_ns = host_time_ns();
         if (audio_callback_) {
-            audio_callback_(dummy_data);
+            audio_callback_(block);
         }
         return true;
     }
@@ -39,4 +68,285 @@ public:
 std::unique_ptr<AudioInterface> AudioInterface::create() {
     return std::make_unique<DummyAudioInterface>();
 }
-#endif
\ No newline at end of file
+#endif
+
+// Memory-mapped WAV or raw float32 file replayed through the capture callback
+class FileAudioInterface : public AudioInterface {
+private:
+    enum class SampleFormat { F32, S16, S24, S32 };
+    
+    FileSourceOptions options_;
+    const uint8_t* file_data_ = nullptr;
+    size_t file_size_ = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> file_contents_;
+#endif
+    
+    const uint8_t* pcm_data_ = nullptr;
+    size_t total_frames_ = 0;
+    size_t bytes_per_frame_ = 0;
+    SampleFormat format_ = SampleFormat::F32;
+    
+    std::vector<float> buffer_;
+    std::thread capture_thread_;
+    std::atomic<bool> is_capturing_{false};
+    std::atomic<bool> is_finished_{false};
+    
+    static uint16_t read_u16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+    
+    static uint32_t read_u32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+    
+    bool map_file() {
+#ifdef _WIN32
+        std::ifstream in(options_.path, std::ios::binary);
+        if (!in) return false;
+        file_contents_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        file_data_ = file_contents_.data();
+        file_size_ = file_contents_.size();
+        return true;
+#else
+        int fd = open(options_.path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return false;
+        
+        madvise(addr, st.st_size, MADV_SEQUENTIAL);
+        file_data_ = static_cast<const uint8_t*>(addr);
+        file_size_ = st.st_size;
+        return true;
+#endif
+    }
+    
+    void unmap_file() {
+#ifdef _WIN32
+        file_contents_.clear();
+#else
+        if (file_data_) {
+            munmap(const_cast<uint8_t*>(file_data_), file_size_);
+        }
+#endif
+        file_data_ = nullptr;
+        file_size_ = 0;
+    }
+    
+    bool parse_wav() {
+        if (file_size_ < 12 || std::memcmp(file_data_, "RIFF", 4) != 0 ||
+            std::memcmp(file_data_ + 8, "WAVE", 4) != 0) {
+            return false;
+        }
+        
+        bool have_format = false;
+        size_t pos = 12;
+        while (pos + 8 <= file_size_) {
+            const uint8_t* chunk = file_data_ + pos;
+            size_t chunk_size = read_u32(chunk + 4);
+            size_t body = pos + 8;
+            size_t available = std::min(chunk_size, file_size_ - body);
+            
+            if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+                uint16_t tag = read_u16(chunk + 8);
+                int channels = read_u16(chunk + 10);
+                int sample_rate = static_cast<int>(read_u32(chunk + 12));
+                int bits = read_u16(chunk + 22);
+                
+                // WAVE_FORMAT_EXTENSIBLE keeps the real tag at the start of the subformat GUID
+                if (tag == 0xFFFE && available >= 26) {
+                    tag = read_u16(chunk + 32);
+                }
+                
+                // A malformed header must not leave bytes_per_frame_ at 0
+                if (channels <= 0 || sample_rate <= 0) {
+                    std::cerr << "Invalid WAV format: " << channels << " channels at " << sample_rate << " Hz"
+                              << std::endl;
+                    return false;
+                }
+                if (tag == 3 && bits == 32) {
+                    format_ = SampleFormat::F32;
+                } else if (tag == 1 && bits == 16) {
+                    format_ = SampleFormat::S16;
+                } else if (tag == 1 && bits == 24) {
+                    format_ = SampleFormat::S24;
+                } else if (tag == 1 && bits == 32) {
+                    format_ = SampleFormat::S32;
+                } else {
+                    std::cerr << "Unsupported WAV format " << tag << " / " << bits << " bits" << std::endl;
+                    return false;
+                }
+                
+                current_config_.channels = channels;
+                current_config_.sample_rate = sample_rate;
+                bytes_per_frame_ = static_cast<size_t>(channels) * (bits / 8);
+                have_format = true;
+            } else if (std::memcmp(chunk, "data", 4) == 0 && have_format) {
+                pcm_data_ = file_data_ + body;
+                total_frames_ = available / bytes_per_frame_;
+                return true;
+            }
+            
+            // Chunks are padded to an even size
+            pos = body + chunk_size + (chunk_size & 1);
+        }
+        
+        std::cerr << "WAV file has no data chunk" << std::endl;
+        return false;
+    }
+    
+    // Points at the file when it already holds aligned interleaved float32, else converts
+    const float* frames_at(size_t frame, size_t count) {
+        const uint8_t* src = pcm_data_ + frame * bytes_per_frame_;
+        if (format_ == SampleFormat::F32 && reinterpret_cast<uintptr_t>(src) % alignof(float) == 0) {
+            return reinterpret_cast<const float*>(src);
+        }
+        
+        size_t samples = count * current_config_.channels;
+        float* out = buffer_.data();
+        for (size_t i = 0; i < samples; i++) {
+            switch (format_) {
+            case SampleFormat::F32:
+                std::memcpy(&out[i], src + i * 4, sizeof(float));
+                break;
+            case SampleFormat::S16:
+                out[i] = static_cast<int16_t>(read_u16(src + i * 2)) / 32768.0f;
+                break;
+            case SampleFormat::S24: {
+                const uint8_t* p = src + i * 3;
+                int32_t value = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                                     (static_cast<uint32_t>(p[1]) << 16) |
+                                                     (static_cast<uint32_t>(p[2]) << 24));
+                out[i] = (value >> 8) / 8388608.0f;
+                break;
+            }
+            case SampleFormat::S32:
+                out[i] = static_cast<int32_t>(read_u32(src + i * 4)) / 2147483648.0f;
+                break;
+            }
+        }
+        return out;
+    }
+    
+    void capture_loop() {
+        size_t period = static_cast<size_t>(current_config_.buffer_size);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sample_time = 0;
+        size_t position = 0;
+        
+        while (is_capturing_) {
+            if (position >= total_frames_) {
+                if (!options_.loop) break;
+                position = 0;
+            }
+            
+            size_t count = std::min(period, total_frames_ - position);
+            
+            if (options_.realtime) {
+                auto offset = std::chrono::duration<double>(static_cast<double>(sample_time) / current_config_.sample_rate);
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::nanoseconds>(offset));
+            }
+            
+            AudioBlock block;
+            block.data = frames_at(position, count);
+            block.frames = count;
+            block.channels = current_config_.channels;
+            block.sample_time = sample_time;
+            block.host_time_ns = host_time_ns();
+            audio_callback_(block);
+            
+            position += count;
+            sample_time += count;
+        }
+        
+        is_finished_ = true;
+    }
+
+public:
+    explicit FileAudioInterface(const FileSourceOptions& options) : options_(options) {}
+    
+    ~FileAudioInterface() override {
+        stop_capture();
+        unmap_file();
+    }
+    
+    std::vector<AudioDevice> list_input_devices() override {
+        return {};
+    }
+    
+    bool initialize(const AudioConfig& config) override {
+        unmap_file();
+        current_config_ = config;
+        current_device_name_ = "File: " + options_.path;
+        
+        if (!map_file()) {
+            std::cerr << "Failed to map audio file: " << options_.path << std::endl;
+            return false;
+        }
+        
+        // Anything that is not a RIFF/WAVE file is raw float32 at the configured rate
+        bool is_wav = file_size_ >= 4 && std::memcmp(file_data_, "RIFF", 4) == 0;
+        if (is_wav) {
+            if (!parse_wav()) return false;
+        } else {
+            if (config.channels <= 0 || config.sample_rate <= 0) {
+                std::cerr << "Raw audio needs a channel count and sample rate" << std::endl;
+                return false;
+            }
+            format_ = SampleFormat::F32;
+            pcm_data_ = file_data_;
+            bytes_per_frame_ = sizeof(float) * config.channels;
+            total_frames_ = file_size_ / bytes_per_frame_;
+        }
+        
+        if (total_frames_ == 0) {
+            std::cerr << "Audio file is empty: " << options_.path << std::endl;
+            return false;
+        }
+        
+        buffer_.assign(static_cast<size_t>(config.buffer_size) * current_config_.channels, 0.0f);
+        return true;
+    }
+    
+    bool start_capture(AudioCallback callback) override {
+        if (!file_data_ || is_capturing_) return false;
+        
+        audio_callback_ = callback;
+        is_finished_ = false;
+        is_capturing_ = true;
+        capture_thread_ = std::thread(&FileAudioInterface::capture_loop, this);
+        return true;
+    }
+    
+    void stop_capture() override {
+        is_capturing_ = false;
+        if (capture_thread_.joinable()) {
+            capture_thread_.join();
+        }
+    }
+    
+    std::string get_device_name() const override {
+        return current_device_name_;
+    }
+    
+    bool is_realtime() const override {
+        return options_.realtime;
+    }
+    
+    bool is_finished() const override {
+        return is_finished_;
+    }
+};
+
+std::unique_ptr<AudioInterface> AudioInterface::create_file(const FileSourceOptions& options) {
+    return std::make_unique<FileAudioInterface>(options);
+}
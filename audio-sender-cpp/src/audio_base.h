@@ -4,6 +4,8 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <cstddef>
+#include <cstdint>
 
 struct AudioDevice {
     std::string name;
@@ -19,7 +21,51 @@ struct AudioConfig {
     int buffer_size = 4096;
 };
 
-using AudioCallback = std::function<void(const std::vector<float>&)>;
+// Options for the file-backed capture source (WAV or raw float32 PCM)
+struct FileSourceOptions {
+    std::string path;
+    bool realtime = true;   // pace to wall-clock time at the file's sample rate
+    bool loop = false;      // restart at end of file instead of finishing
+};
+
+// Options for the synthetic signal source used in soak and load tests
+struct SyntheticOptions {
+    enum class Signal { Sine, Noise, Chirp, Speech };
+    
+    Signal signal = Signal::Sine;
+    double frequency = 440.0;   // sine frequency / chirp start, Hz
+    float amplitude = 0.5f;
+    bool stamp_counter = true;  // embed the sample counter at the start of each block
+    
+    static bool parse_signal(const std::string& name, Signal& signal);
+};
+
+// Stamped blocks carry sample_time in their first eight samples, one byte each,
+// least significant first. A byte is stored as a signed value / 128.0f, which
+// lands in the top byte of an s16 or s24 sample, so the stamp survives every
+// wire format whatever scale the converter uses.
+constexpr size_t kSyntheticStampSamples = 8;
+
+void write_synthetic_stamp(uint64_t sample_time, float* samples);
+
+// Reads a stamp back from samples decoded as value / 32768.0f (or / 32767.0f)
+uint64_t read_synthetic_stamp(const float* samples);
+
+// Non-owning view of one block of interleaved float samples. Points into a
+// buffer the backend preallocated in initialize(), so it is only valid for
+// the duration of the callback.
+struct AudioBlock {
+    const float* data = nullptr;
+    size_t frames = 0;
+    int channels = 0;
+    uint64_t sample_time = 0;   // first frame, in samples since capture started
+    int64_t host_time_ns = 0;   // steady_clock time the block was captured
+    
+    size_t sample_count() const { return frames * static_cast<size_t>(channels); }
+};
+
+// Called on the capture thread; must not block or allocate
+using AudioCallback = std::function<void(const AudioBlock&)>;
 
 class AudioInterface {
 public:
@@ -28,6 +74,12 @@ public:
     // Factory method to create platform-specific audio interface
     static std::unique_ptr<AudioInterface> create();
     
+    // Factory method for a memory-mapped file source, for replay and benchmarks
+    static std::unique_ptr<AudioInterface> create_file(const FileSourceOptions& options);
+    
+    // Factory method for a synthetic signal source; all instances share one timer thread
+    static std::unique_ptr<AudioInterface> create_synthetic(const SyntheticOptions& options);
+    
     // Get list of available input devices
     virtual std::vector<AudioDevice> list_input_devices() = 0;
     
@@ -43,6 +95,18 @@ public:
     // Get current device name
     virtual std::string get_device_name() const = 0;
     
+    // Effective configuration after initialize(); devices may adjust the rate
+    const AudioConfig& get_config() const { return current_config_; }
+    
+    // False for sources that run faster than real time and tolerate backpressure
+    virtual bool is_realtime() const { return true; }
+    
+    // True once a finite source has delivered all of its data
+    virtual bool is_finished() const { return false; }
+    
+    // Monotonic clock used for AudioBlock::host_time_ns
+    static int64_t host_time_ns();
+
 protected:
     AudioCallback audio_callback_;
     AudioConfig current_config_;
@@ -0,0 +1,424 @@
+#ifdef __linux__
+
+#include "audio_base.h"
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+class LinuxAudioInterface : public AudioInterface {
+private:
+    snd_pcm_t* pcm_ = nullptr;
+    snd_pcm_format_t format_ = SND_PCM_FORMAT_FLOAT_LE;
+    snd_pcm_uframes_t period_size_ = 0;
+    snd_pcm_uframes_t buffer_size_ = 0;
+    bool is_initialized_ = false;
+    
+    std::thread capture_thread_;
+    std::atomic<bool> is_capturing_{false};
+    int wake_pipe_[2] = {-1, -1};
+    
+    // Preallocated in initialize(); used only when the mmap area cannot be
+    // handed to the callback directly (non-float format or split channels)
+    std::vector<float> convert_buffer_;
+    std::vector<struct pollfd> poll_fds_;
+    uint64_t captured_frames_ = 0;
+    std::atomic<uint64_t> xruns_{0};
+    
+    static std::string resolve_device(const std::string& name) {
+        if (name.empty()) return "default";
+        
+        // Plain ALSA PCM names (hw:1,0, plughw:..., null, file:..., default) are used as-is
+        if (name.find(':') != std::string::npos || name == "default" || name == "null") {
+            return name;
+        }
+        return "";
+    }
+    
+    bool recover(int err) {
+        if (err == -EPIPE || err == -ESTRPIPE) {
+            xruns_++;
+        }
+        
+        err = snd_pcm_recover(pcm_, err, 1);
+        if (err < 0) {
+            std::cerr << "ALSA recovery failed: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        err = snd_pcm_start(pcm_);
+        if (err < 0 && err != -EBADFD) {
+            std::cerr << "ALSA restart failed: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // Block until a period is ready or stop_capture() writes to the wake pipe
+    bool wait_for_period() {
+        int count = static_cast<int>(poll_fds_.size());
+        int result = poll(poll_fds_.data(), count, 1000);
+        if (result < 0) return errno == EINTR;
+        if (result == 0) return true;
+        
+        if (poll_fds_[0].revents & POLLIN) {
+            char drain[16];
+            while (read(wake_pipe_[0], drain, sizeof(drain)) > 0) {}
+            return true;
+        }
+        
+        unsigned short revents = 0;
+        snd_pcm_poll_descriptors_revents(pcm_, poll_fds_.data() + 1, count - 1, &revents);
+        if (revents & POLLERR) {
+            return recover(-EPIPE);
+        }
+        return true;
+    }
+    
+    void deliver(const snd_pcm_channel_area_t* areas, snd_pcm_uframes_t offset, snd_pcm_uframes_t frames) {
+        int channels = current_config_.channels;
+        AudioBlock block;
+        block.frames = frames;
+        block.channels = channels;
+        block.sample_time = captured_frames_;
+        block.host_time_ns = host_time_ns();
+        
+        // Interleaved float: point the callback straight into the DMA ring
+        bool interleaved = true;
+        for (int ch = 0; ch < channels; ch++) {
+            if (areas[ch].addr != areas[0].addr ||
+                areas[ch].first != areas[0].first + ch * 32u ||
+                areas[ch].step != channels * 32u) {
+                interleaved = false;
+                break;
+            }
+        }
+        
+        if (format_ == SND_PCM_FORMAT_FLOAT_LE && interleaved && areas[0].first == 0) {
+            block.data = static_cast<const float*>(areas[0].addr) + offset * channels;
+        } else {
+            float* out = convert_buffer_.data();
+            for (int ch = 0; ch < channels; ch++) {
+                const auto* base = static_cast<const uint8_t*>(areas[ch].addr);
+                unsigned int step = areas[ch].step / 8;
+                const uint8_t* src = base + areas[ch].first / 8 + offset * step;
+                
+                for (snd_pcm_uframes_t i = 0; i < frames; i++, src += step) {
+                    float sample;
+                    if (format_ == SND_PCM_FORMAT_FLOAT_LE) {
+                        std::memcpy(&sample, src, sizeof(sample));
+                    } else {
+                        int16_t value;
+                        std::memcpy(&value, src, sizeof(value));
+                        sample = value / 32768.0f;
+                    }
+                    out[i * channels + ch] = sample;
+                }
+            }
+            block.data = out;
+        }
+        
+        if (audio_callback_) {
+            audio_callback_(block);
+        }
+        captured_frames_ += frames;
+    }
+    
+    void capture_loop() {
+        int err = snd_pcm_start(pcm_);
+        if (err < 0) {
+            std::cerr << "Failed to start ALSA capture: " << snd_strerror(err) << std::endl;
+            return;
+        }
+        
+        while (is_capturing_) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm_);
+            if (avail < 0) {
+                if (!recover(static_cast<int>(avail))) break;
+                continue;
+            }
+            
+            if (static_cast<snd_pcm_uframes_t>(avail) < period_size_) {
+                if (!wait_for_period()) break;
+                continue;
+            }
+            
+            // Consume whole periods; mmap_begin may return less at the ring wrap
+            snd_pcm_uframes_t remaining = static_cast<snd_pcm_uframes_t>(avail) / period_size_ * period_size_;
+            while (remaining > 0 && is_capturing_) {
+                const snd_pcm_channel_area_t* areas = nullptr;
+                snd_pcm_uframes_t offset = 0;
+                snd_pcm_uframes_t frames = std::min(remaining, period_size_);
+                
+                err = snd_pcm_mmap_begin(pcm_, &areas, &offset, &frames);
+                if (err < 0) {
+                    if (!recover(err)) return;
+                    break;
+                }
+                
+                deliver(areas, offset, frames);
+                
+                snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm_, offset, frames);
+                if (committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != frames) {
+                    if (!recover(committed >= 0 ? -EPIPE : static_cast<int>(committed))) return;
+                    break;
+                }
+                remaining -= frames;
+            }
+        }
+        
+        snd_pcm_drop(pcm_);
+    }
+    
+    bool configure(const AudioConfig& config) {
+        snd_pcm_hw_params_t* hw_params;
+        snd_pcm_hw_params_alloca(&hw_params);
+        
+        int err = snd_pcm_hw_params_any(pcm_, hw_params);
+        if (err < 0) {
+            std::cerr << "Failed to query ALSA hw params: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        err = snd_pcm_hw_params_set_access(pcm_, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+        if (err < 0) {
+            err = snd_pcm_hw_params_set_access(pcm_, hw_params, SND_PCM_ACCESS_MMAP_NONINTERLEAVED);
+        }
+        if (err < 0) {
+            std::cerr << "Device does not support mmap access: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        format_ = SND_PCM_FORMAT_FLOAT_LE;
+        if (snd_pcm_hw_params_set_format(pcm_, hw_params, format_) < 0) {
+            format_ = SND_PCM_FORMAT_S16_LE;
+            err = snd_pcm_hw_params_set_format(pcm_, hw_params, format_);
+            if (err < 0) {
+                std::cerr << "Failed to set sample format: " << snd_strerror(err) << std::endl;
+                return false;
+            }
+        }
+        
+        err = snd_pcm_hw_params_set_channels(pcm_, hw_params, config.channels);
+        if (err < 0) {
+            std::cerr << "Failed to set channels: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        unsigned int rate = config.sample_rate;
+        err = snd_pcm_hw_params_set_rate_near(pcm_, hw_params, &rate, nullptr);
+        if (err < 0) {
+            std::cerr << "Failed to set sample rate: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        if (static_cast<int>(rate) != config.sample_rate) {
+            std::cerr << "Device rate " << rate << " Hz differs from requested "
+                      << config.sample_rate << " Hz" << std::endl;
+            current_config_.sample_rate = rate;
+        }
+        
+        // One period per AudioConfig::buffer_size, four periods in the ring
+        period_size_ = config.buffer_size;
+        err = snd_pcm_hw_params_set_period_size_near(pcm_, hw_params, &period_size_, nullptr);
+        if (err < 0) {
+            std::cerr << "Failed to set period size: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        buffer_size_ = period_size_ * 4;
+        err = snd_pcm_hw_params_set_buffer_size_near(pcm_, hw_params, &buffer_size_);
+        if (err < 0) {
+            std::cerr << "Failed to set buffer size: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        err = snd_pcm_hw_params(pcm_, hw_params);
+        if (err < 0) {
+            std::cerr << "Failed to apply hw params: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        snd_pcm_hw_params_get_period_size(hw_params, &period_size_, nullptr);
+        snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_size_);
+        
+        // Wake once per period
+        snd_pcm_sw_params_t* sw_params;
+        snd_pcm_sw_params_alloca(&sw_params);
+        snd_pcm_sw_params_current(pcm_, sw_params);
+        snd_pcm_sw_params_set_avail_min(pcm_, sw_params, period_size_);
+        snd_pcm_sw_params_set_start_threshold(pcm_, sw_params, 1);
+        err = snd_pcm_sw_params(pcm_, sw_params);
+        if (err < 0) {
+            std::cerr << "Failed to apply sw params: " << snd_strerror(err) << std::endl;
+            return false;
+        }
+        
+        return true;
+    }
+    
+    void close_device() {
+        if (pcm_) {
+            snd_pcm_close(pcm_);
+            pcm_ = nullptr;
+        }
+        for (int& fd : wake_pipe_) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        is_initialized_ = false;
+    }
+
+public:
+    ~LinuxAudioInterface() override {
+        stop_capture();
+    }
+    
+    std::vector<AudioDevice> list_input_devices() override {
+        std::vector<AudioDevice> devices;
+        
+        void** hints = nullptr;
+        if (snd_device_name_hint(-1, "pcm", &hints) < 0) return devices;
+        
+        for (void** hint = hints; *hint; hint++) {
+            char* name = snd_device_name_get_hint(*hint, "NAME");
+            char* desc = snd_device_name_get_hint(*hint, "DESC");
+            char* ioid = snd_device_name_get_hint(*hint, "IOID");
+            
+            // IOID is absent for devices that do both directions
+            if (name && (!ioid || std::strcmp(ioid, "Input") == 0)) {
+                AudioDevice device;
+                device.id = name;
+                device.name = desc ? desc : name;
+                std::replace(device.name.begin(), device.name.end(), '\n', ' ');
+                device.channels = 0;
+                device.sample_rate = 0;
+                
+                snd_pcm_t* pcm = nullptr;
+                if (snd_pcm_open(&pcm, name, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK) == 0) {
+                    snd_pcm_hw_params_t* params;
+                    snd_pcm_hw_params_alloca(&params);
+                    if (snd_pcm_hw_params_any(pcm, params) >= 0) {
+                        unsigned int max_channels = 0;
+                        unsigned int max_rate = 0;
+                        snd_pcm_hw_params_get_channels_max(params, &max_channels);
+                        snd_pcm_hw_params_get_rate_max(params, &max_rate, nullptr);
+                        device.channels = static_cast<int>(std::min(max_channels, 32u));
+                        device.sample_rate = static_cast<int>(std::min(max_rate, 48000u));
+                    }
+                    snd_pcm_close(pcm);
+                }
+                
+                devices.push_back(device);
+            }
+            
+            free(name);
+            free(desc);
+            free(ioid);
+        }
+        
+        snd_device_name_free_hint(hints);
+        return devices;
+    }
+    
+    bool initialize(const AudioConfig& config) override {
+        close_device();
+        current_config_ = config;
+        
+        std::string device = resolve_device(config.device_name);
+        if (device.empty()) {
+            // Match part of the description, as on the other platforms
+            for (const auto& candidate : list_input_devices()) {
+                if (candidate.name.find(config.device_name) != std::string::npos ||
+                    candidate.id.find(config.device_name) != std::string::npos) {
+                    device = candidate.id;
+                    current_device_name_ = candidate.name;
+                    break;
+                }
+            }
+            if (device.empty()) {
+                std::cerr << "No input device matching: " << config.device_name << std::endl;
+                return false;
+            }
+        } else {
+            current_device_name_ = device;
+        }
+        
+        int err = snd_pcm_open(&pcm_, device.c_str(), SND_PCM_STREAM_CAPTURE, 0);
+        if (err < 0) {
+            std::cerr << "Failed to open ALSA device " << device << ": " << snd_strerror(err) << std::endl;
+            pcm_ = nullptr;
+            return false;
+        }
+        
+        if (!configure(config)) {
+            close_device();
+            return false;
+        }
+        
+        if (pipe(wake_pipe_) < 0) {
+            std::cerr << "Failed to create wake pipe" << std::endl;
+            close_device();
+            return false;
+        }
+        fcntl(wake_pipe_[0], F_SETFL, O_NONBLOCK);
+        
+        // Wake pipe first, then the PCM descriptors
+        int count = snd_pcm_poll_descriptors_count(pcm_);
+        poll_fds_.assign(1 + std::max(count, 0), pollfd{});
+        poll_fds_[0].fd = wake_pipe_[0];
+        poll_fds_[0].events = POLLIN;
+        snd_pcm_poll_descriptors(pcm_, poll_fds_.data() + 1, count);
+        
+        convert_buffer_.assign(static_cast<size_t>(period_size_) * config.channels, 0.0f);
+        captured_frames_ = 0;
+        is_initialized_ = true;
+        
+        return true;
+    }
+    
+    bool start_capture(AudioCallback callback) override {
+        if (!is_initialized_ || is_capturing_) return false;
+        
+        audio_callback_ = callback;
+        is_capturing_ = true;
+        capture_thread_ = std::thread(&LinuxAudioInterface::capture_loop, this);
+        
+        return true;
+    }
+    
+    void stop_capture() override {
+        if (is_capturing_.exchange(false)) {
+            char wake = 1;
+            if (write(wake_pipe_[1], &wake, 1) < 0) {
+                // Poll times out after a second anyway
+            }
+        }
+        if (capture_thread_.joinable()) {
+            capture_thread_.join();
+        }
+        
+        if (xruns_ > 0) {
+            std::cerr << "ALSA xruns recovered: " << xruns_ << std::endl;
+        }
+        close_device();
+    }
+    
+    std::string get_device_name() const override {
+        return current_device_name_;
+    }
+};
+
+std::unique_ptr<AudioInterface> AudioInterface::create() {
+    return std::make_unique<LinuxAudioInterface>();
+}
+
+#endif // __linux__
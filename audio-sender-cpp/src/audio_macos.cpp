@@ -7,6 +7,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 
 class MacOSAudioInterface : public AudioInterface {
 private:
@@ -14,6 +15,11 @@ private:
     bool is_initialized_ = false;
     bool is_capturing_ = false;
     
+    // Preallocated in initialize(); the render callback never allocates
+    std::vector<float> capture_buffer_;
+    UInt32 max_frames_ = 0;
+    uint64_t captured_frames_ = 0;
+    
     static OSStatus AudioInputCallback(void* inRefCon,
                                      AudioUnitRenderActionFlags* ioActionFlags,
                                      const AudioTimeStamp* inTimeStamp,
@@ -23,14 +29,16 @@ private:
         
         MacOSAudioInterface* self = static_cast<MacOSAudioInterface*>(inRefCon);
         
-        // Create buffer for audio data
+        if (inNumberFrames > self->max_frames_) {
+            return kAudioUnitErr_TooManyFramesToProcess;
+        }
+        
+        // Render into the preallocated buffer
         AudioBufferList bufferList;
         bufferList.mNumberBuffers = 1;
         bufferList.mBuffers[0].mNumberChannels = self->current_config_.channels;
         bufferList.mBuffers[0].mDataByteSize = inNumberFrames * sizeof(float) * self->current_config_.channels;
-        
-        std::vector<float> audioData(inNumberFrames * self->current_config_.channels);
-        bufferList.mBuffers[0].mData = audioData.data();
+        bufferList.mBuffers[0].mData = self->capture_buffer_.data();
         
         // Render audio data
         OSStatus status = AudioUnitRender(self->audio_unit_,
@@ -41,8 +49,15 @@ private:
                                         &bufferList);
         
         if (status == noErr && self->audio_callback_) {
-            self->audio_callback_(audioData);
+            AudioBlock block;
+            block.data = self->capture_buffer_.data();
+            block.frames = inNumberFrames;
+            block.channels = self->current_config_.channels;
+            block.sample_time = self->captured_frames_;
+            block.host_time_ns = host_time_ns();
+            self->audio_callback_(block);
         }
+        self->captured_frames_ += inNumberFrames;
         
         return status;
     }
@@ -209,6 +224,21 @@ public:
             return false;
         }
         
+        // Size the capture buffer for the largest slice the unit may render
+        UInt32 maxFrames = 0;
+        UInt32 maxFramesSize = sizeof(maxFrames);
+        status = AudioUnitGetProperty(audio_unit_,
+                                    kAudioUnitProperty_MaximumFramesPerSlice,
+                                    kAudioUnitScope_Global,
+                                    0,
+                                    &maxFrames,
+                                    &maxFramesSize);
+        if (status != noErr) maxFrames = 0;
+        
+        max_frames_ = std::max<UInt32>(maxFrames, static_cast<UInt32>(config.buffer_size));
+        capture_buffer_.assign(static_cast<size_t>(max_frames_) * config.channels, 0.0f);
+        captured_frames_ = 0;
+        
         // Initialize audio unit
         status = AudioUnitInitialize(audio_unit_);
         if (status != noErr) {
@@ -0,0 +1,291 @@
+#include "audio_base.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+class SyntheticAudioInterface;
+
+// One timer thread drives every synthetic source in the process, so hundreds
+// of instances cost one OS thread instead of hundreds
+class SynthScheduler {
+public:
+    static SynthScheduler& instance() {
+        static SynthScheduler scheduler;
+        return scheduler;
+    }
+    
+    ~SynthScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+    
+    void add(SyntheticAudioInterface* source);
+    void remove(SyntheticAudioInterface* source);
+
+private:
+    SynthScheduler() = default;
+    void run();
+    
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<SyntheticAudioInterface*> sources_;
+    SyntheticAudioInterface* running_source_ = nullptr;
+    std::thread thread_;
+    bool stopping_ = false;
+};
+
+class SyntheticAudioInterface : public AudioInterface {
+private:
+    SyntheticOptions options_;
+    std::vector<float> buffer_;
+    
+    // Owned by the scheduler thread while registered
+    std::chrono::steady_clock::time_point start_;
+    uint64_t sample_time_ = 0;
+    double phase_ = 0.0;
+    uint32_t noise_state_ = 0x12345678u;
+    size_t burst_remaining_ = 0;
+    bool burst_on_ = false;
+    double burst_pitch_ = 150.0;
+    bool is_capturing_ = false;
+    
+    float next_noise() {
+        // xorshift32
+        noise_state_ ^= noise_state_ << 13;
+        noise_state_ ^= noise_state_ >> 17;
+        noise_state_ ^= noise_state_ << 5;
+        return static_cast<float>(noise_state_) / 2147483648.0f - 1.0f;
+    }
+    
+    float next_sample() {
+        double rate = current_config_.sample_rate;
+        float value = 0.0f;
+        
+        switch (options_.signal) {
+        case SyntheticOptions::Signal::Sine:
+            value = static_cast<float>(std::sin(phase_));
+            phase_ += 2.0 * kPi * options_.frequency / rate;
+            break;
+        case SyntheticOptions::Signal::Noise:
+            value = next_noise();
+            break;
+        case SyntheticOptions::Signal::Chirp: {
+            // Linear sweep from frequency to Nyquist/2 once per second
+            double t = static_cast<double>(sample_time_ % current_config_.sample_rate) / rate;
+            double f0 = options_.frequency;
+            double f1 = rate / 4.0;
+            value = static_cast<float>(std::sin(2.0 * kPi * (f0 * t + 0.5 * (f1 - f0) * t * t)));
+            break;
+        }
+        case SyntheticOptions::Signal::Speech:
+            // Syllable-length voiced bursts separated by pauses
+            if (burst_remaining_ == 0) {
+                burst_on_ = !burst_on_;
+                double seconds = burst_on_ ? 0.15 + 0.25 * (next_noise() + 1.0f) / 2.0
+                                           : 0.10 + 0.50 * (next_noise() + 1.0f) / 2.0;
+                burst_remaining_ = static_cast<size_t>(seconds * rate);
+                burst_pitch_ = 110.0 + 90.0 * (next_noise() + 1.0f) / 2.0;
+            }
+            burst_remaining_--;
+            if (burst_on_) {
+                double harmonics = 0.0;
+                for (int h = 1; h <= 8; h++) {
+                    harmonics += std::sin(phase_ * h) / h;
+                }
+                value = static_cast<float>(harmonics * 0.5) + 0.05f * next_noise();
+                phase_ += 2.0 * kPi * burst_pitch_ / rate;
+            } else {
+                value = 0.001f * next_noise();
+            }
+            break;
+        }
+        
+        if (phase_ > 2.0 * kPi * 1024.0) phase_ = std::fmod(phase_, 2.0 * kPi);
+        return value * options_.amplitude;
+    }
+
+public:
+    explicit SyntheticAudioInterface(const SyntheticOptions& options) : options_(options) {
+        // Distinct noise per instance
+        static std::atomic<uint32_t> seed{1};
+        noise_state_ = (0x9E3779B9u * seed++) | 1u;
+    }
+    
+    ~SyntheticAudioInterface() override {
+        stop_capture();
+    }
+    
+    std::vector<AudioDevice> list_input_devices() override {
+        return {};
+    }
+    
+    bool initialize(const AudioConfig& config) override {
+        current_config_ = config;
+        current_device_name_ = "Synthetic Signal";
+        buffer_.assign(static_cast<size_t>(config.buffer_size) * config.channels, 0.0f);
+        return config.sample_rate > 0 && config.buffer_size > 0;
+    }
+    
+    bool start_capture(AudioCallback callback) override {
+        if (buffer_.empty() || is_capturing_) return false;
+        
+        audio_callback_ = callback;
+        start_ = std::chrono::steady_clock::now();
+        sample_time_ = 0;
+        is_capturing_ = true;
+        SynthScheduler::instance().add(this);
+        return true;
+    }
+    
+    void stop_capture() override {
+        if (is_capturing_) {
+            SynthScheduler::instance().remove(this);
+            is_capturing_ = false;
+        }
+    }
+    
+    std::string get_device_name() const override {
+        return current_device_name_;
+    }
+    
+    // Deadline for the next block, on the sample clock so it never drifts
+    std::chrono::steady_clock::time_point next_due() const {
+        auto offset = std::chrono::duration<double>(static_cast<double>(sample_time_) / current_config_.sample_rate);
+        return start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+    }
+    
+    void render() {
+        size_t frames = static_cast<size_t>(current_config_.buffer_size);
+        int channels = current_config_.channels;
+        
+        for (size_t i = 0; i < frames; i++) {
+            float value = next_sample();
+            for (int ch = 0; ch < channels; ch++) {
+                buffer_[i * channels + ch] = value;
+            }
+        }
+        
+        if (options_.stamp_counter && buffer_.size() >= kSyntheticStampSamples) {
+            write_synthetic_stamp(sample_time_, buffer_.data());
+        }
+        
+        AudioBlock block;
+        block.data = buffer_.data();
+        block.frames = frames;
+        block.channels = channels;
+        block.sample_time = sample_time_;
+        block.host_time_ns = host_time_ns();
+        audio_callback_(block);
+        
+        sample_time_ += frames;
+    }
+};
+
+void SynthScheduler::add(SyntheticAudioInterface* source) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sources_.push_back(source);
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&SynthScheduler::run, this);
+        }
+    }
+    cv_.notify_all();
+}
+
+void SynthScheduler::remove(SyntheticAudioInterface* source) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    sources_.erase(std::remove(sources_.begin(), sources_.end(), source), sources_.end());
+    
+    // Don't return while the scheduler is inside this source's callback,
+    // unless we are that callback: waiting on ourselves would never end
+    if (std::this_thread::get_id() == thread_.get_id()) return;
+    cv_.wait(lock, [this, source] { return running_source_ != source; });
+}
+
+void SynthScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    
+    while (!stopping_) {
+        if (sources_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        auto earliest = std::chrono::steady_clock::time_point::max();
+        SyntheticAudioInterface* due = nullptr;
+        
+        for (SyntheticAudioInterface* source : sources_) {
+            auto when = source->next_due();
+            if (when < earliest) {
+                earliest = when;
+                due = source;
+            }
+        }
+        
+        if (earliest > now) {
+            cv_.wait_until(lock, earliest);
+            continue;
+        }
+        
+        // Render outside the lock so add/remove from other threads never wait on a callback
+        running_source_ = due;
+        lock.unlock();
+        due->render();
+        lock.lock();
+        running_source_ = nullptr;
+        cv_.notify_all();
+    }
+}
+
+} // namespace
+
+void write_synthetic_stamp(uint64_t sample_time, float* samples) {
+    for (size_t i = 0; i < kSyntheticStampSamples; i++) {
+        auto byte = static_cast<int8_t>((sample_time >> (8 * i)) & 0xFF);
+        samples[i] = byte / 128.0f;
+    }
+}
+
+uint64_t read_synthetic_stamp(const float* samples) {
+    uint64_t sample_time = 0;
+    for (size_t i = 0; i < kSyntheticStampSamples; i++) {
+        long byte = std::lround(samples[i] * 128.0f);
+        byte = std::min(127L, std::max(-128L, byte));
+        sample_time |= static_cast<uint64_t>(byte & 0xFF) << (8 * i);
+    }
+    return sample_time;
+}
+
+bool SyntheticOptions::parse_signal(const std::string& name, Signal& signal) {
+    if (name == "sine") {
+        signal = Signal::Sine;
+    } else if (name == "noise") {
+        signal = Signal::Noise;
+    } else if (name == "chirp") {
+        signal = Signal::Chirp;
+    } else if (name == "speech") {
+        signal = Signal::Speech;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<AudioInterface> AudioInterface::create_synthetic(const SyntheticOptions& options) {
+    return std::make_unique<SyntheticAudioInterface>(options);
+}
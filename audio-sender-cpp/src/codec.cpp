@@ -0,0 +1,201 @@
+#include "codec.h"
+#include <iostream>
+#include <algorithm>
+
+#ifdef HAVE_OPUS
+#include <opus.h>
+#endif
+
+namespace {
+
+constexpr int kMinOpusBitrate = 6000;
+constexpr int kMaxOpusBitrate = 510000;
+
+class PcmEncoder : public AudioEncoder {
+public:
+    explicit PcmEncoder(const CodecConfig& config)
+        : AudioEncoder(config), converter_(config.format, config.dither), full_format_(config.format) {
+        converter_.set_big_endian(config.big_endian);
+    }
+    
+    // Float and 24-bit streams can fall back to 16-bit
+    int max_downgrade() const override { return full_format_ == SampleFormat::S16 ? 0 : 1; }
+    
+    void set_downgrade(int level) override {
+        SampleFormat format = level > 0 ? SampleFormat::S16 : full_format_;
+        if (format != config_.format) {
+            config_.format = format;
+            converter_ = SampleConverter(format, config_.dither);
+            converter_.set_big_endian(config_.big_endian);
+        }
+    }
+    
+    size_t frame_size() const override { return 0; }
+    
+    size_t max_payload_bytes(size_t frames) const override {
+        return frames * config_.channels * bytes_per_sample(config_.format);
+    }
+    
+    size_t bytes_per_frame() const override {
+        return config_.channels * bytes_per_sample(config_.format);
+    }
+    
+    size_t estimated_bytes(size_t frames) const override {
+        return max_payload_bytes(frames);
+    }
+    
+    size_t encode(const float* samples, size_t frames, uint8_t* out, size_t capacity) override {
+        if (max_payload_bytes(frames) > capacity) return 0;
+        return converter_.convert(samples, frames * config_.channels, out);
+    }
+
+private:
+    SampleConverter converter_;
+    SampleFormat full_format_;
+};
+
+#ifdef HAVE_OPUS
+
+// Opus never needs more than this per frame at the bitrates we allow
+constexpr size_t kMaxOpusPacket = 1275 * 3;
+
+class OpusAudioEncoder : public AudioEncoder {
+public:
+    explicit OpusAudioEncoder(const CodecConfig& config) : AudioEncoder(config), full_bitrate_(config.bitrate) {}
+    
+    ~OpusAudioEncoder() override {
+        if (encoder_) {
+            opus_encoder_destroy(encoder_);
+        }
+    }
+    
+    bool open() {
+        int error = OPUS_OK;
+        encoder_ = opus_encoder_create(config_.sample_rate, config_.channels, OPUS_APPLICATION_VOIP, &error);
+        if (error != OPUS_OK || !encoder_) {
+            std::cerr << "Failed to create Opus encoder: " << opus_strerror(error) << std::endl;
+            encoder_ = nullptr;
+            return false;
+        }
+        
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(config_.bitrate));
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(config_.complexity));
+        opus_encoder_ctl(encoder_, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+        return true;
+    }
+    
+    size_t frame_size() const override {
+        return static_cast<size_t>(config_.sample_rate) * config_.frame_ms / 1000;
+    }
+    
+    // Each level halves the bitrate, down to the Opus minimum
+    int max_downgrade() const override { return 3; }
+    
+    void set_downgrade(int level) override {
+        level_ = level;
+        int bitrate = std::max(kMinOpusBitrate, full_bitrate_ >> level);
+        if (bitrate != config_.bitrate) {
+            config_.bitrate = bitrate;
+            opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate));
+        }
+    }
+    
+    bool set_bitrate(int bitrate) override {
+        full_bitrate_ = std::clamp(bitrate, kMinOpusBitrate, kMaxOpusBitrate);
+        set_downgrade(level_);
+        return true;
+    }
+    
+    // The encoder takes any valid duration per call; the pipeline switches between codec frames
+    bool set_frame_ms(int frame_ms) override {
+        if (frame_ms != 10 && frame_ms != 20 && frame_ms != 40) return false;
+        config_.frame_ms = frame_ms;
+        return true;
+    }
+    
+    size_t max_payload_bytes(size_t) const override { return kMaxOpusPacket; }
+    
+    size_t bytes_per_frame() const override { return 0; }
+    
+    size_t estimated_bytes(size_t frames) const override {
+        return static_cast<size_t>(static_cast<uint64_t>(config_.bitrate) * frames / 8 / config_.sample_rate);
+    }
+    
+    size_t encode(const float* samples, size_t frames, uint8_t* out, size_t capacity) override {
+        if (frames != frame_size()) return 0;
+        
+        opus_int32 bytes = opus_encode_float(encoder_, samples, static_cast<int>(frames), out,
+                                             static_cast<opus_int32>(capacity));
+        if (bytes < 0) {
+            std::cerr << "Opus encode failed: " << opus_strerror(bytes) << std::endl;
+            return 0;
+        }
+        return static_cast<size_t>(bytes);
+    }
+
+private:
+    OpusEncoder* encoder_ = nullptr;
+    int full_bitrate_;
+    int level_ = 0;
+};
+
+#endif // HAVE_OPUS
+
+} // namespace
+
+bool parse_codec(const std::string& name, Codec& codec) {
+    if (name == "pcm") {
+        codec = Codec::PCM;
+    } else if (name == "opus") {
+        codec = Codec::Opus;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* codec_name(Codec codec) {
+    switch (codec) {
+    case Codec::PCM: return "pcm";
+    case Codec::Opus: return "opus";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<AudioEncoder> AudioEncoder::create(const CodecConfig& config) {
+    if (config.codec == Codec::PCM) {
+        return std::make_unique<PcmEncoder>(config);
+    }
+    
+    // Opus only runs at these rates, with up to two channels
+    int rate = config.sample_rate;
+    if (rate != 8000 && rate != 12000 && rate != 16000 && rate != 24000 && rate != 48000) {
+        std::cerr << "Opus needs a sample rate of 8000, 12000, 16000, 24000 or 48000 Hz" << std::endl;
+        return nullptr;
+    }
+    if (config.channels < 1 || config.channels > 2) {
+        std::cerr << "Opus supports 1 or 2 channels" << std::endl;
+        return nullptr;
+    }
+    if (config.frame_ms != 10 && config.frame_ms != 20 && config.frame_ms != 40) {
+        std::cerr << "Opus frame duration must be 10, 20 or 40 ms" << std::endl;
+        return nullptr;
+    }
+    if (config.bitrate < kMinOpusBitrate || config.bitrate > kMaxOpusBitrate) {
+        std::cerr << "Opus bitrate must be between 6000 and 510000 bit/s" << std::endl;
+        return nullptr;
+    }
+    if (config.complexity < 0 || config.complexity > 10) {
+        std::cerr << "Opus complexity must be between 0 and 10" << std::endl;
+        return nullptr;
+    }
+    
+#ifdef HAVE_OPUS
+    auto encoder = std::make_unique<OpusAudioEncoder>(config);
+    if (!encoder->open()) return nullptr;
+    return encoder;
+#else
+    std::cerr << "This build has no Opus support (libopus was not found at configure time)" << std::endl;
+    return nullptr;
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include "sample_format.h"
+
+enum class Codec {
+    PCM,
+    Opus
+};
+
+bool parse_codec(const std::string& name, Codec& codec);
+const char* codec_name(Codec codec);
+
+struct CodecConfig {
+    Codec codec = Codec::PCM;
+    int sample_rate = 16000;
+    int channels = 1;
+    
+    // PCM
+    SampleFormat format = SampleFormat::F32;
+    bool dither = false;
+    bool big_endian = false;    // network byte order, as RTP L16/L24 require
+    
+    // Opus
+    int bitrate = 24000;        // bits per second
+    int complexity = 5;         // 0..10
+    int frame_ms = 20;          // 10, 20 or 40
+};
+
+// Turns interleaved float frames into wire payloads. Codecs with a fixed
+// frame size (Opus) must be fed exactly frame_size() frames per call; the
+// send pipeline reframes captured audio to that boundary.
+class AudioEncoder {
+public:
+    virtual ~AudioEncoder() = default;
+    
+    // Returns nullptr (and prints why) if the codec is unavailable or the config is invalid
+    static std::unique_ptr<AudioEncoder> create(const CodecConfig& config);
+    
+    // Frames per encode() call; 0 means any size
+    virtual size_t frame_size() const = 0;
+    
+    // Largest payload encode() can produce for frames of input
+    virtual size_t max_payload_bytes(size_t frames) const = 0;
+    
+    // Bytes per frame for codecs whose payload can be cut at any frame; 0 otherwise
+    virtual size_t bytes_per_frame() const = 0;
+    
+    // Typical payload size, used to account for bytes DTX did not send
+    virtual size_t estimated_bytes(size_t frames) const = 0;
+    
+    // Cheaper encodings for congestion; level 0 is the configured quality
+    virtual int max_downgrade() const { return 0; }
+    virtual void set_downgrade(int level) { (void)level; }
+    
+    // Rate control targets; false if the codec has no such setting. The
+    // bitrate becomes the new full quality that downgrade levels halve.
+    virtual bool set_bitrate(int bitrate) { (void)bitrate; return false; }
+    virtual bool set_frame_ms(int frame_ms) { (void)frame_ms; return false; }
+    
+    // Returns bytes written to out, or 0 on error
+    virtual size_t encode(const float* samples, size_t frames, uint8_t* out, size_t capacity) = 0;
+    
+    const CodecConfig& config() const { return config_; }
+
+protected:
+    explicit AudioEncoder(const CodecConfig& config) : config_(config) {}
+    CodecConfig config_;
+};
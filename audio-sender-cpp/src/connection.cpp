@@ -0,0 +1,263 @@
+#include "connection.h"
+#include <iostream>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// Smallest message we budget held slots for (a DTX keepalive)
+constexpr uint64_t kMinMessageFrames = 16;
+
+} // namespace
+
+bool parse_outage_policy(const std::string& name, OutagePolicy& policy) {
+    if (name == "replay") {
+        policy = OutagePolicy::Replay;
+    } else if (name == "drop") {
+        policy = OutagePolicy::Drop;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* outage_policy_name(OutagePolicy policy) {
+    switch (policy) {
+    case OutagePolicy::Replay: return "replay";
+    case OutagePolicy::Drop: return "drop";
+    }
+    return "unknown";
+}
+
+Connection::Connection(Network& network, const std::string& host, int port, const ReconnectConfig& config)
+    : network_(network), host_(host), port_(port), config_(config) {
+    if (config.policy == OutagePolicy::Replay) {
+        limit_frames_ = static_cast<uint64_t>(config.replay_ms) * config.sample_rate / 1000;
+    }
+    if (limit_frames_ > 0) {
+        held_.resize(static_cast<size_t>(std::max<uint64_t>(64, limit_frames_ / kMinMessageFrames + 1)));
+    }
+    message_limit_ = network_.max_message_size();
+}
+
+Connection::~Connection() {
+    close(std::chrono::milliseconds(0));
+}
+
+bool Connection::open(NetworkEngine* engine) {
+    engine_ = engine;
+    
+    bool ok = network_.connect(host_, port_);
+    if (ok && engine_ && !engine_->start()) {
+        network_.disconnect();
+        ok = false;
+    }
+    if (ok) {
+        message_limit_ = network_.max_message_size();
+        state_ = State::Up;
+    } else if (!config_.enabled) {
+        return false;
+    } else {
+        state_ = State::Down;
+        stats_.outages++;
+    }
+    
+    if (config_.enabled) {
+        thread_ = std::thread(&Connection::run, this);
+    }
+    return true;
+}
+
+void Connection::close(std::chrono::milliseconds drain_timeout) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    
+    if (engine_) {
+        if (state_ == State::Up) {
+            engine_->drain(drain_timeout);
+        }
+        engine_->stop();
+    }
+    network_.disconnect();
+    state_ = State::Down;
+}
+
+void Connection::submit(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload) {
+    if (state_ == State::Ready) {
+        replay();
+    }
+    if (state_ == State::Up && engine_ && !engine_->healthy()) {
+        fail();
+    }
+    
+    if (state_ != State::Up) {
+        hold(parts, count, frames, payload);
+    } else if (!forward(parts, count, frames, payload, false)) {
+        fail();
+        hold(parts, count, frames, payload);
+    }
+}
+
+void Connection::flush() {
+    if (state_ == State::Up && !engine_ && !network_.flush()) {
+        // Whatever the batch still held is lost with the socket
+        fail();
+    }
+}
+
+size_t Connection::max_message_size() {
+    if (state_ == State::Up) {
+        message_limit_ = network_.max_message_size();
+    }
+    return message_limit_;
+}
+
+int Connection::receive(uint8_t* buffer, size_t size) {
+    if (state_ != State::Up) return 0;
+    
+    int received = network_.receive(buffer, size);
+    if (received < 0) {
+        fail();
+        return 0;
+    }
+    return received;
+}
+
+bool Connection::forward(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload,
+                         bool wait) {
+    if (engine_) {
+        // A refused message is an overflow drop, not a failure; healthy() tells the two apart
+        engine_->submit(parts, count, frames, payload, wait);
+        return engine_->healthy();
+    }
+    return network_.queue(parts, count);
+}
+
+void Connection::fail() {
+    std::cerr << "Connection to " << host_ << ":" << port_ << " lost; reconnecting" << std::endl;
+    stats_.outages++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_ = State::Down;
+    }
+    changed_.notify_all();
+}
+
+void Connection::hold(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload) {
+    if (held_.empty()) {
+        stats_.discarded++;
+        return;
+    }
+    
+    // Keep the newest replay_ms; a single message larger than that is still kept
+    while (size_ > 0 && (held_frames_ + frames > limit_frames_ || size_ == held_.size())) {
+        drop_held_front();
+    }
+    
+    Held& slot = held_[(head_ + size_) % held_.size()];
+    slot.body = copy_message_head(parts, count, payload, slot.bytes);
+    slot.payload = slot.body.data ? payload : SharedBuffer();
+    slot.frames = frames;
+    size_++;
+    held_frames_ += frames;
+}
+
+void Connection::drop_held_front() {
+    held_frames_ -= held_[head_].frames;
+    held_[head_].payload.reset();
+    head_ = (head_ + 1) % held_.size();
+    size_--;
+    stats_.discarded++;
+}
+
+void Connection::replay() {
+    message_limit_ = network_.max_message_size();
+    state_ = State::Up;
+    
+    // Datagrams sized for the old path may no longer fit; drop those rather than fail again
+    size_t replayed = 0;
+    while (size_ > 0) {
+        Held& slot = held_[head_];
+        if (message_limit_ > 0 && slot.bytes.size() + slot.body.size > message_limit_) {
+            drop_held_front();
+            continue;
+        }
+        
+        // Replay waits for queue room: the point is to deliver what was held
+        ConstBuffer parts[2] = {{slot.bytes.data(), slot.bytes.size()}, slot.body};
+        if (!forward(parts, slot.body.data ? 2 : 1, slot.frames, slot.payload, true)) {
+            fail();
+            return;
+        }
+        held_frames_ -= slot.frames;
+        head_ = (head_ + 1) % held_.size();
+        size_--;
+        replayed++;
+    }
+    if (!engine_ && !network_.flush()) {
+        fail();
+        return;
+    }
+    
+    // Without an engine the batch pointed into the held slots until flush()
+    for (size_t i = 1; i <= replayed; i++) {
+        held_[(head_ + held_.size() - i) % held_.size()].payload.reset();
+    }
+    
+    stats_.replayed += replayed;
+    if (replayed > 0) {
+        std::cout << "Replayed " << replayed << " held messages" << std::endl;
+    }
+}
+
+bool Connection::reconnect() {
+    if (engine_) {
+        engine_->stop();
+    }
+    network_.disconnect();
+    
+    if (!network_.connect(host_, port_)) return false;
+    if (engine_ && !engine_->start()) {
+        network_.disconnect();
+        return false;
+    }
+    return true;
+}
+
+void Connection::run() {
+    std::mt19937 random(std::random_device{}());
+    auto backoff = config_.min_backoff;
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        changed_.wait(lock, [this] { return stopping_ || state_ == State::Down; });
+        if (stopping_) break;
+        
+        // Equal jitter: half the backoff is fixed, half random, so senders
+        // that lost the same relay do not all come back in the same instant
+        auto half = backoff / 2;
+        std::uniform_int_distribution<long long> jitter(0, std::max<long long>(0, half.count()));
+        auto delay = half + std::chrono::milliseconds(jitter(random));
+        if (changed_.wait_for(lock, delay, [this] { return stopping_; })) break;
+        
+        lock.unlock();
+        bool ok = reconnect();
+        lock.lock();
+        
+        if (ok) {
+            std::cout << "Reconnected to " << host_ << " (" << network_.remote_address() << ")" << std::endl;
+            stats_.reconnects++;
+            backoff = config_.min_backoff;
+            state_ = State::Ready;
+        } else {
+            stats_.failed_attempts++;
+            backoff = std::min(backoff * 2, config_.max_backoff);
+        }
+    }
+}
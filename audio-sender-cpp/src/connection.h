@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "network.h"
+#include "net_engine.h"
+
+// What happens to audio captured while the connection is down
+enum class OutagePolicy {
+    Replay,     // send the last replay_ms of it once reconnected
+    Drop        // resume with live audio only
+};
+
+bool parse_outage_policy(const std::string& name, OutagePolicy& policy);
+const char* outage_policy_name(OutagePolicy policy);
+
+struct ReconnectConfig {
+    bool enabled = true;
+    int sample_rate = 16000;        // wire rate, to turn frames into milliseconds
+    int replay_ms = 1000;           // audio held during an outage
+    OutagePolicy policy = OutagePolicy::Replay;
+    std::chrono::milliseconds min_backoff{250};
+    std::chrono::milliseconds max_backoff{10000};
+};
+
+struct ConnectionStats {
+    std::atomic<uint64_t> outages{0};
+    std::atomic<uint64_t> reconnects{0};
+    std::atomic<uint64_t> failed_attempts{0};
+    std::atomic<uint64_t> replayed{0};      // held messages sent after reconnecting
+    std::atomic<uint64_t> discarded{0};     // messages lost to outages
+};
+
+// Keeps one destination connected. Only the sender thread sends: while the
+// link is up, submit() forwards to the engine or the socket; while it is
+// down, messages go into a pre-roll ring bounded to replay_ms of audio, and
+// a background thread reconnects with jittered exponential backoff. Capture
+// never waits for the network, and a relay restart does not need a sender
+// restart.
+class Connection {
+public:
+    Connection(Network& network, const std::string& host, int port, const ReconnectConfig& config);
+    ~Connection();
+    
+    // First connection attempt. With reconnection enabled a failure is not
+    // fatal: the stream starts in the outage state. The engine, if any, is
+    // (re)started on every connect.
+    bool open(NetworkEngine* engine);
+    
+    // Stops reconnecting, drains the engine for up to drain_timeout and disconnects
+    void close(std::chrono::milliseconds drain_timeout);
+    
+    // Sender thread only: one message (header and payload parts) covering
+    // frames of audio. Queues keep a reference to payload instead of copying
+    // a last part that lies inside it.
+    void submit(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload = SharedBuffer());
+    
+    // Sender thread only: ends a batch of submit() calls
+    void flush();
+    
+    // Sender thread only: datagram limit of the current connection, 0 for streams
+    size_t max_message_size();
+    
+    // Sender thread only: reads what the relay sent back without blocking.
+    // Returns 0 while disconnected or when nothing is waiting; a read error
+    // starts reconnecting like a failed send.
+    int receive(uint8_t* buffer, size_t size);
+    
+    bool connected() const { return state_ == State::Up; }
+    const ConnectionStats& stats() const { return stats_; }
+
+private:
+    enum class State {
+        Up,         // the sender thread owns the socket
+        Down,       // the reconnect thread owns the socket
+        Ready       // reconnected; the sender thread replays held audio first
+    };
+    
+    struct Held {
+        std::vector<uint8_t> bytes;
+        SharedBuffer payload;
+        ConstBuffer body{nullptr, 0};
+        uint32_t frames = 0;
+    };
+    
+    void run();
+    bool reconnect();
+    void fail();
+    void hold(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload);
+    void drop_held_front();
+    void replay();
+    
+    // Sends one message on the live connection; false if the connection failed
+    bool forward(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload, bool wait);
+    
+    Network& network_;
+    std::string host_;
+    int port_;
+    ReconnectConfig config_;
+    ConnectionStats stats_;
+    NetworkEngine* engine_ = nullptr;
+    size_t message_limit_ = 0;
+    
+    // Held messages in held_[head_ .. head_ + size_), modulo capacity; sender thread only
+    std::vector<Held> held_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    uint64_t held_frames_ = 0;
+    uint64_t limit_frames_ = 0;
+    
+    std::atomic<State> state_{State::Down};
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,225 @@
+#include "destination.h"
+#include <iostream>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// Only UDP destinations carry FEC, so only their controllers steer it
+RateControlConfig rate_config_for(const DestinationSpec& spec, const DestinationConfig& config) {
+    RateControlConfig rate = config.rate;
+    rate.fec = config.fec != FecScheme::None && spec.protocol == "udp";
+    return rate;
+}
+
+} // namespace
+
+bool DestinationSpec::parse(const std::string& text, DestinationSpec& spec) {
+    std::string rest = text;
+    size_t scheme = rest.find("://");
+    if (scheme != std::string::npos) {
+        spec.protocol = rest.substr(0, scheme);
+        rest = rest.substr(scheme + 3);
+    }
+    if (rest.empty()) return false;
+    
+    try {
+        size_t colon_pos = rest.rfind(':');
+        if (rest[0] == '[') {
+            // [IPv6]:port or [IPv6]
+            size_t close_pos = rest.find(']');
+            spec.host = rest.substr(1, close_pos == std::string::npos ? std::string::npos : close_pos - 1);
+            if (close_pos != std::string::npos && colon_pos == close_pos + 1) {
+                spec.port = std::stoi(rest.substr(colon_pos + 1));
+            }
+        } else if (colon_pos != std::string::npos && rest.find(':') == colon_pos) {
+            spec.host = rest.substr(0, colon_pos);
+            spec.port = std::stoi(rest.substr(colon_pos + 1));
+        } else {
+            // A bare IPv6 address has several colons and no port
+            spec.host = rest;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return !spec.host.empty();
+}
+
+std::string DestinationSpec::to_string() const {
+    bool ipv6 = host.find(':') != std::string::npos;
+    return protocol + "://" + (ipv6 ? "[" + host + "]" : host) + ":" + std::to_string(port);
+}
+
+Destination::Destination(const DestinationSpec& spec, const DestinationConfig& config)
+    : spec_(spec), config_(config),
+      feedback_(config.stream_id, config.sample_rate, spec.protocol == "tcp"),
+      controller_(rate_config_for(spec, config)) {
+}
+
+Destination::~Destination() {
+    close(std::chrono::milliseconds(0));
+}
+
+bool Destination::open(const SendPipeline& pipeline) {
+    if (spec_.protocol == "tcp") {
+        network_ = std::make_unique<TCPNetwork>();
+    } else if (spec_.protocol == "udp" || rtp()) {
+        network_ = std::make_unique<UDPNetwork>(config_.mtu, config_.udp_send);
+    } else {
+        std::cerr << "Invalid protocol " << spec_.protocol << " for " << spec_.host << std::endl;
+        return false;
+    }
+    
+    if (config_.event_loop) {
+        EngineConfig engine_config = config_.engine;
+        if (spec_.protocol == "tcp") {
+            // Keep the kernel's share of the backlog to about half the budget
+            engine_config.send_buffer = std::max<size_t>(4096, config_.bytes_per_second * engine_config.queue_ms / 2000);
+        }
+        if (rtp() && pipeline.encoder().config().codec == Codec::PCM) {
+            // The payload type in the SDP names the sample format; it cannot change
+            engine_config.max_downgrade = 0;
+        }
+        if (config_.raw && pipeline.encoder().config().codec == Codec::PCM) {
+            // Bare samples carry no encoding field, so a receiver could not follow a switch to s16
+            engine_config.max_downgrade = 0;
+        }
+        engine_ = std::make_unique<NetworkEngine>(*network_, engine_config);
+    }
+    
+    connection_ = std::make_unique<Connection>(*network_, spec_.host, spec_.port, config_.reconnect);
+    if (!connection_->open(engine_.get())) {
+        std::cerr << "Failed to connect to " << spec_.to_string() << std::endl;
+        return false;
+    }
+    
+    header_.stream_id = config_.stream_id;
+    header_.sample_rate = static_cast<uint32_t>(config_.sample_rate);
+    header_.encoding = payload_encoding_for(pipeline.encoder().config());
+    header_.channels = static_cast<uint8_t>(config_.channels);
+    
+    // RTP: the stream id is the SSRC; sequence and timestamp start at random values (RFC 3550 5.1)
+    if (rtp()) {
+        if (!RtpFormat::for_codec(pipeline.encoder().config(), config_.rtp_payload_type, rtp_format_)) {
+            std::cerr << "No RTP payload format for " << payload_encoding_name(header_.encoding) << std::endl;
+            return false;
+        }
+        std::random_device random;
+        header_.sequence = random() & 0xffff;
+        packetizer_.set_rtp(rtp_format_.payload_type,
+                            rtp_format_.clock_rate / static_cast<uint32_t>(config_.sample_rate), random());
+        
+        // RTCP runs next to RTP on port + 1; its receiver reports replace the relay's
+        rtcp_network_ = std::make_unique<UDPNetwork>(config_.mtu, UDPNetwork::SendMode::Single);
+        if (!rtcp_network_->connect(spec_.host, spec_.port + 1)) {
+            std::cerr << "Failed to open the RTCP socket for " << spec_.to_string() << std::endl;
+            return false;
+        }
+        rtcp_ = std::make_unique<RtcpSession>(*rtcp_network_, header_.stream_id, rtp_format_.clock_rate);
+    }
+    
+    // Repair datagrams carry the longest source plus their own headers, so sources leave room
+    if (config_.fec != FecScheme::None && spec_.protocol == "udp") {
+        if (!fec_.configure(config_.fec, config_.fec_overhead, config_.fec_group)) {
+            std::cerr << "Invalid FEC settings (overhead 1-100%, group 2-64)" << std::endl;
+            return false;
+        }
+        fec_enabled_ = true;
+    }
+    return true;
+}
+
+size_t Destination::payload_limit() {
+    size_t limit = connection_->max_message_size();
+    return rtp() && limit > RtpHeader::kSize ? limit - RtpHeader::kSize : 0;
+}
+
+bool Destination::configure_framing(const SendPipeline& pipeline) {
+    Framing framing = rtp() ? Framing::Rtp : (config_.raw ? Framing::Raw : Framing::Native);
+    message_limit_ = connection_->max_message_size();
+    frame_bytes_ = pipeline.encoder().bytes_per_frame();
+    max_payload_ = pipeline.max_payload_bytes();
+    fec_reserve_ = fec_.repair_overhead();
+    if (message_limit_ > 0 && fec_reserve_ >= message_limit_) return false;
+    return packetizer_.configure(message_limit_ > 0 ? message_limit_ - fec_reserve_ : 0, frame_bytes_, max_payload_,
+                                 pipeline.max_packets(), framing);
+}
+
+void Destination::send(const SendPipeline& pipeline, size_t count, bool silence_started) {
+    // Follow path MTU, payload format and FEC group changes
+    if (connection_->max_message_size() != message_limit_ || pipeline.encoder().bytes_per_frame() != frame_bytes_ ||
+        pipeline.max_payload_bytes() != max_payload_ || fec_.repair_overhead() != fec_reserve_) {
+        bool framed = configure_framing(pipeline);
+        if (framed != framed_) {
+            std::cerr << "[" << spec_.to_string() << "] " << (framed ? "Packets fit again" :
+                         "Packets no longer fit the path MTU; dropping them until they do") << std::endl;
+        }
+        framed_ = framed;
+    }
+    
+    // Until then nothing is queued; the receiver sees the gap in sequence numbers
+    if (!framed_) {
+        dropped_ += count;
+        return;
+    }
+    header_.encoding = payload_encoding_for(pipeline.encoder().config());
+    
+    // Everything one captured frame produced leaves in a single flush
+    uint32_t first_sequence = header_.sequence;
+    packetizer_.clear();
+    for (size_t i = 0; i < count; i++) {
+        const EncodedPacket& packet = pipeline.packet(i);
+        header_.flags = packet.keepalive ? PacketHeader::kFlagComfortNoise : 0;
+        packetizer_.add(header_, packet);
+    }
+    for (size_t m = 0; m < packetizer_.message_count(); m++) {
+        connection_->submit(packetizer_.parts(m), packetizer_.part_count(), packetizer_.message_frames(m),
+                            packetizer_.message_payload(m));
+        if (rtcp_) {
+            rtcp_->sent(packetizer_.parts(m), packetizer_.part_count());
+        }
+        if (fec_enabled_) {
+            submit_repairs(fec_.add(packetizer_.parts(m), packetizer_.part_count()));
+        }
+    }
+    
+    // Silence would hold a partial FEC group back until speech resumes
+    if (fec_enabled_ && silence_started) {
+        submit_repairs(fec_.finish_group());
+    }
+    connection_->flush();
+    feedback_.sent(first_sequence, header_.sequence);
+}
+
+void Destination::submit_repairs(size_t repairs) {
+    for (size_t r = 0; r < repairs; r++) {
+        ConstBuffer repair = fec_.repair(r);
+        connection_->submit(&repair, 1, 0);
+    }
+}
+
+bool Destination::poll(bool adapt) {
+    bool reported = rtcp_ ? rtcp_->poll() : feedback_.poll(*connection_);
+    if (!reported || !adapt || !controller_.update(last_report())) return false;
+    
+    if (controller_.decision().fec_overhead > 0 && fec_enabled_) {
+        fec_.set_overhead(controller_.decision().fec_overhead);
+    }
+    return true;
+}
+
+const PathFeedback& Destination::last_report() const {
+    return rtcp_ ? rtcp_->feedback() : feedback_.feedback();
+}
+
+void Destination::close(std::chrono::milliseconds drain_timeout) {
+    if (closed_) return;
+    closed_ = true;
+    
+    if (rtcp_) {
+        rtcp_->send_bye();
+    }
+    if (connection_) {
+        connection_->close(drain_timeout);
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "network.h"
+#include "net_engine.h"
+#include "connection.h"
+#include "packet.h"
+#include "pipeline.h"
+#include "fec.h"
+#include "feedback.h"
+#include "rate_control.h"
+#include "rtp.h"
+
+// Where one copy of the stream goes: [tcp|udp|rtp://]host[:port], with
+// IPv6 literals in brackets. Empty protocol and port 0 take the defaults.
+struct DestinationSpec {
+    std::string protocol;
+    std::string host;
+    int port = 0;
+    
+    static bool parse(const std::string& text, DestinationSpec& spec);
+    std::string to_string() const;
+};
+
+// Settings every destination shares
+struct DestinationConfig {
+    int sample_rate = 16000;        // wire rate
+    int channels = 1;
+    uint32_t stream_id = 0;
+    bool raw = false;
+    size_t mtu = UDPNetwork::kDefaultMtu;
+    UDPNetwork::SendMode udp_send = UDPNetwork::SendMode::Segment;
+    bool event_loop = false;        // send through a NetworkEngine, with engine.backend
+    EngineConfig engine;
+    size_t bytes_per_second = 0;    // estimated stream rate, to size TCP send buffers
+    ReconnectConfig reconnect;
+    FecScheme fec = FecScheme::None;    // UDP destinations only
+    int fec_overhead = 25;
+    int fec_group = 8;
+    RateControlConfig rate;
+    int rtp_payload_type = -1;
+};
+
+// Everything that is per receiver: socket, send queue, reconnect thread,
+// framing and sequence numbers, FEC and receiver reports. The capture,
+// pipeline and encoder run once; every destination packetizes the same
+// encoded packets and queues references to their shared payloads, so a
+// stalled or reconnecting destination costs the others nothing.
+class Destination {
+public:
+    Destination(const DestinationSpec& spec, const DestinationConfig& config);
+    ~Destination();
+    
+    // Creates the socket and send queue and makes the first connection
+    // attempt; false only if it failed and reconnecting is off
+    bool open(const SendPipeline& pipeline);
+    
+    // Sizes the framing for the current path MTU and payload format; false if they do not fit
+    bool configure_framing(const SendPipeline& pipeline);
+    
+    // Queues the packets of the last pipeline.process(). silence_started
+    // closes a partial FEC group, which would otherwise wait for speech.
+    void send(const SendPipeline& pipeline, size_t count, bool silence_started);
+    
+    // Reads receiver reports; with adapt, feeds them to rate control and
+    // returns true if its decision changed. FEC follows it here; codec
+    // settings are the caller's, as the encoder is shared.
+    bool poll(bool adapt);
+    
+    // Sends the RTCP BYE, drains the queue for up to drain_timeout and disconnects
+    void close(std::chrono::milliseconds drain_timeout);
+    
+    // Largest codec packet that fits one datagram when the framing cannot fragment; 0 if unlimited
+    size_t payload_limit();
+    
+    // Audio this destination's send queue can hold, in wire-rate frames; 0 without one
+    uint64_t queue_frames() const { return engine_ ? engine_->limit_frames() : 0; }
+    
+    // Quality level this destination's send queue asks for
+    int downgrade_level() const { return engine_ ? engine_->downgrade_level() : 0; }
+    
+    const DestinationSpec& spec() const { return spec_; }
+    bool rtp() const { return spec_.protocol == "rtp"; }
+    Network& network() { return *network_; }
+    const NetworkEngine* engine() const { return engine_.get(); }
+    const Connection& connection() const { return *connection_; }
+    const Packetizer& packetizer() const { return packetizer_; }
+    const PacketHeader& header() const { return header_; }
+    const FecEncoder& fec() const { return fec_; }
+    bool fec_enabled() const { return fec_enabled_; }
+    const FeedbackReceiver& feedback() const { return feedback_; }
+    const RtcpSession* rtcp() const { return rtcp_.get(); }
+    const RtpFormat& rtp_format() const { return rtp_format_; }
+    const RateController& controller() const { return controller_; }
+    
+    // Packets lost because they did not fit the current framing
+    uint64_t dropped() const { return dropped_; }
+    
+    // Path feedback from the latest report
+    const PathFeedback& last_report() const;
+
+private:
+    void submit_repairs(size_t repairs);
+    
+    DestinationSpec spec_;
+    DestinationConfig config_;
+    
+    std::unique_ptr<Network> network_;
+    std::unique_ptr<NetworkEngine> engine_;
+    std::unique_ptr<Connection> connection_;
+    
+    Packetizer packetizer_;
+    PacketHeader header_;
+    size_t message_limit_ = 0;
+    size_t frame_bytes_ = 0;
+    size_t max_payload_ = 0;
+    size_t fec_reserve_ = 0;
+    bool framed_ = true;
+    uint64_t dropped_ = 0;
+    
+    FecEncoder fec_;
+    bool fec_enabled_ = false;
+    FeedbackReceiver feedback_;
+    RateController controller_;
+    
+    RtpFormat rtp_format_;
+    std::unique_ptr<UDPNetwork> rtcp_network_;
+    std::unique_ptr<RtcpSession> rtcp_;
+    bool closed_ = false;
+};
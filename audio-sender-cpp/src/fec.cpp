@@ -0,0 +1,621 @@
+#include "fec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FEC_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FEC_X86_DISPATCH 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FEC_NEON 1
+#endif
+
+namespace {
+
+// GF(2^8) with the usual 0x11D polynomial, as log/exp tables
+struct GaloisField {
+    uint8_t exp[512];
+    uint8_t log[256];
+    
+    GaloisField() {
+        unsigned x = 1;
+        for (int i = 0; i < 255; i++) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11D;
+        }
+        for (int i = 255; i < 512; i++) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+    
+    uint8_t mul(uint8_t a, uint8_t b) const {
+        return (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+    }
+    
+    uint8_t inv(uint8_t a) const { return exp[255 - log[a]]; }
+};
+
+const GaloisField& gf() {
+    static const GaloisField field;
+    return field;
+}
+
+// Cauchy matrix entry for repair j and source i: 1 / (x_i + y_j) with
+// x_i = i and y_j = kMaxSources + j. The two sets never overlap, so every
+// square submatrix is invertible and any M losses can be rebuilt. The
+// entries do not depend on K, so a partial group needs no special case.
+uint8_t coefficient(size_t repair, size_t source) {
+    return gf().inv(static_cast<uint8_t>(source ^ (FecHeader::kMaxSources + repair)));
+}
+
+// dst ^= src and dst ^= c * src; the SIMD versions return how many bytes they covered
+using XorRegion = size_t (*)(uint8_t* dst, const uint8_t* src, size_t size);
+using MulAddRegion = size_t (*)(uint8_t* dst, const uint8_t* src, const uint8_t* low, const uint8_t* high,
+                                size_t size);
+                                
+#ifdef FEC_SSE2
+size_t xor_region_sse2(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t done = size / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, s));
+    }
+    return done;
+}
+#endif
+
+#ifdef FEC_X86_DISPATCH
+// Multiplication by a constant is a lookup of each nibble in a 16-entry table,
+// which PSHUFB does for 16 (or 32) bytes at once
+__attribute__((target("ssse3")))
+size_t mul_add_region_ssse3(uint8_t* dst, const uint8_t* src, const uint8_t* low, const uint8_t* high,
+                            size_t size) {
+    const __m128i table_low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(low));
+    const __m128i table_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    
+    size_t done = size / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_and_si128(s, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(table_low, lo), _mm_shuffle_epi8(table_high, hi));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, product));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+size_t mul_add_region_avx2(uint8_t* dst, const uint8_t* src, const uint8_t* low, const uint8_t* high,
+                           size_t size) {
+    const __m256i table_low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low)));
+    const __m256i table_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high)));
+    const __m256i mask = _mm256_set1_epi8(0x0F);
+    
+    size_t done = size / 32 * 32;
+    for (size_t i = 0; i < done; i += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i lo = _mm256_and_si256(s, mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+        __m256i product = _mm256_xor_si256(_mm256_shuffle_epi8(table_low, lo), _mm256_shuffle_epi8(table_high, hi));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, product));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+size_t xor_region_avx2(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t done = size / 32 * 32;
+    for (size_t i = 0; i < done; i += 32) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, s));
+    }
+    return done;
+}
+#endif
+
+#ifdef FEC_NEON
+size_t xor_region_neon(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t done = size / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+    return done;
+}
+
+size_t mul_add_region_neon(uint8_t* dst, const uint8_t* src, const uint8_t* low, const uint8_t* high,
+                           size_t size) {
+    const uint8x16_t table_low = vld1q_u8(low);
+    const uint8x16_t table_high = vld1q_u8(high);
+    const uint8x16_t mask = vdupq_n_u8(0x0F);
+    
+    size_t done = size / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x16_t product = veorq_u8(vqtbl1q_u8(table_low, vandq_u8(s, mask)),
+                                      vqtbl1q_u8(table_high, vshrq_n_u8(s, 4)));
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), product));
+    }
+    return done;
+}
+#endif
+
+struct Kernels {
+    XorRegion xor_region = nullptr;
+    MulAddRegion mul_add = nullptr;
+    const char* name = "scalar";
+};
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+        Kernels k;
+#ifdef FEC_SSE2
+        k.xor_region = xor_region_sse2;
+        k.name = "sse2";
+#endif
+#ifdef FEC_X86_DISPATCH
+        if (__builtin_cpu_supports("avx2")) {
+            k.xor_region = xor_region_avx2;
+            k.mul_add = mul_add_region_avx2;
+            k.name = "avx2";
+        } else if (__builtin_cpu_supports("ssse3")) {
+            k.mul_add = mul_add_region_ssse3;
+            k.name = "ssse3";
+        }
+#endif
+#ifdef FEC_NEON
+        k.xor_region = xor_region_neon;
+        k.mul_add = mul_add_region_neon;
+        k.name = "neon";
+#endif
+        return k;
+    }();
+    return selected;
+}
+
+void xor_region(uint8_t* dst, const uint8_t* src, size_t size) {
+    size_t done = kernels().xor_region ? kernels().xor_region(dst, src, size) : 0;
+    for (size_t i = done; i < size; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+void mul_add_region(uint8_t* dst, const uint8_t* src, uint8_t c, size_t size) {
+    if (c == 0) return;
+    if (c == 1) {
+        xor_region(dst, src, size);
+        return;
+    }
+    
+    // Products of c with every low and every high nibble
+    alignas(16) uint8_t low[16];
+    alignas(16) uint8_t high[16];
+    for (int i = 0; i < 16; i++) {
+        low[i] = gf().mul(c, static_cast<uint8_t>(i));
+        high[i] = gf().mul(c, static_cast<uint8_t>(i << 4));
+    }
+    
+    size_t done = kernels().mul_add ? kernels().mul_add(dst, src, low, high, size) : 0;
+    for (size_t i = done; i < size; i++) {
+        dst[i] ^= low[src[i] & 0x0F] ^ high[src[i] >> 4];
+    }
+}
+
+// Inverts the n x n matrix in place (row-major); false if it is singular
+bool invert_matrix(uint8_t* matrix, size_t n) {
+    std::vector<uint8_t> inverse(n * n, 0);
+    for (size_t i = 0; i < n; i++) {
+        inverse[i * n + i] = 1;
+    }
+    
+    for (size_t column = 0; column < n; column++) {
+        size_t pivot = column;
+        while (pivot < n && matrix[pivot * n + column] == 0) pivot++;
+        if (pivot == n) return false;
+        if (pivot != column) {
+            for (size_t k = 0; k < n; k++) {
+                std::swap(matrix[pivot * n + k], matrix[column * n + k]);
+                std::swap(inverse[pivot * n + k], inverse[column * n + k]);
+            }
+        }
+        
+        uint8_t scale = gf().inv(matrix[column * n + column]);
+        for (size_t k = 0; k < n; k++) {
+            matrix[column * n + k] = gf().mul(matrix[column * n + k], scale);
+            inverse[column * n + k] = gf().mul(inverse[column * n + k], scale);
+        }
+        for (size_t row = 0; row < n; row++) {
+            uint8_t factor = matrix[row * n + column];
+            if (row == column || factor == 0) continue;
+            for (size_t k = 0; k < n; k++) {
+                matrix[row * n + k] ^= gf().mul(factor, matrix[column * n + k]);
+                inverse[row * n + k] ^= gf().mul(factor, inverse[column * n + k]);
+            }
+        }
+    }
+    
+    std::memcpy(matrix, inverse.data(), n * n);
+    return true;
+}
+
+void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, static_cast<uint16_t>(value >> 16));
+    put_u16(out + 2, static_cast<uint16_t>(value));
+}
+
+uint16_t get_u16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(get_u16(in)) << 16) | get_u16(in + 2);
+}
+
+} // namespace
+
+bool parse_fec_scheme(const std::string& name, FecScheme& scheme) {
+    if (name == "off") {
+        scheme = FecScheme::None;
+    } else if (name == "xor") {
+        scheme = FecScheme::Xor;
+    } else if (name == "rs") {
+        scheme = FecScheme::ReedSolomon;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* fec_scheme_name(FecScheme scheme) {
+    switch (scheme) {
+    case FecScheme::None: return "off";
+    case FecScheme::Xor: return "xor";
+    case FecScheme::ReedSolomon: return "rs";
+    }
+    return "unknown";
+}
+
+void FecHeader::serialize(uint8_t* out) const {
+    put_u32(out, base_sequence);
+    out[4] = static_cast<uint8_t>(scheme);
+    out[5] = sources;
+    out[6] = repairs;
+    out[7] = index;
+    put_u16(out + 8, length);
+    put_u16(out + 10, 0);
+    for (size_t i = 0; i < sources; i++) {
+        out[kFixedSize + 2 * i] = offsets[i];
+        out[kFixedSize + 2 * i + 1] = fragments[i];
+    }
+}
+
+bool FecHeader::parse(const uint8_t* in, size_t size, FecHeader& header) {
+    if (size < kFixedSize) return false;
+    
+    header.base_sequence = get_u32(in);
+    header.scheme = static_cast<FecScheme>(in[4]);
+    header.sources = in[5];
+    header.repairs = in[6];
+    header.index = in[7];
+    header.length = get_u16(in + 8);
+    
+    if (header.scheme != FecScheme::Xor && header.scheme != FecScheme::ReedSolomon) return false;
+    if (header.sources == 0 || header.sources > kMaxSources) return false;
+    if (header.repairs == 0 || header.repairs > kMaxRepairs || header.index >= header.repairs) return false;
+    if (header.scheme == FecScheme::Xor && header.repairs != 1) return false;
+    if (size < header.size()) return false;
+    
+    for (size_t i = 0; i < header.sources; i++) {
+        header.offsets[i] = in[kFixedSize + 2 * i];
+        header.fragments[i] = in[kFixedSize + 2 * i + 1];
+    }
+    return true;
+}
+
+const char* FecEncoder::kernel_name() {
+    return kernels().name;
+}
+
+bool FecEncoder::configure(FecScheme scheme, int overhead_percent, int group_size) {
+    if (scheme == FecScheme::None) {
+        scheme_ = scheme;
+        return true;
+    }
+    if (overhead_percent < 1 || overhead_percent > 100) return false;
+    if (group_size < 2 || group_size > static_cast<int>(FecHeader::kMaxSources)) return false;
+    
+    scheme_ = scheme;
+    overhead_percent_ = overhead_percent;
+    group_size_ = group_size;
+    apply_overhead();
+    
+    parity_.resize(FecHeader::kMaxRepairs);
+    output_.resize(FecHeader::kMaxRepairs);
+    filled_ = 0;
+    ready_ = 0;
+    return true;
+}
+
+void FecEncoder::set_overhead(int overhead_percent) {
+    overhead_percent_ = std::max(1, std::min(100, overhead_percent));
+    if (filled_ == 0) {
+        apply_overhead();
+    }
+}
+
+void FecEncoder::apply_overhead() {
+    if (scheme_ == FecScheme::Xor) {
+        int sources = (100 + overhead_percent_ / 2) / overhead_percent_;
+        sources_ = static_cast<uint8_t>(std::max(2, std::min(sources, static_cast<int>(FecHeader::kMaxSources))));
+        repairs_ = 1;
+    } else {
+        int repairs = (group_size_ * overhead_percent_ + 99) / 100;
+        sources_ = static_cast<uint8_t>(group_size_);
+        repairs_ = static_cast<uint8_t>(std::max(1, std::min(repairs, static_cast<int>(FecHeader::kMaxRepairs))));
+    }
+}
+
+size_t FecEncoder::repair_overhead() const {
+    if (scheme_ == FecScheme::None) return 0;
+    return PacketHeader::kSize + FecHeader::kFixedSize + 2 * static_cast<size_t>(sources_);
+}
+
+size_t FecEncoder::add(const ConstBuffer* parts, size_t count) {
+    if (scheme_ == FecScheme::None || count == 0) return 0;
+    
+    PacketHeader source;
+    if (!PacketHeader::parse(parts[0].data, parts[0].size, source)) return 0;
+    
+    // Sequence offsets are one byte; a stream that jumped closes the group early
+    size_t ready = 0;
+    if (filled_ > 0 && source.sequence - header_.base_sequence > 255) {
+        ready = finish_group();
+    }
+    
+    if (filled_ == 0) {
+        apply_overhead();
+        header_.base_sequence = source.sequence;
+        header_.scheme = scheme_;
+        header_.sources = 0;
+        header_.repairs = repairs_;
+        header_.length = 0;
+        first_ = source;
+        for (size_t j = 0; j < repairs_; j++) {
+            parity_[j].clear();
+        }
+    }
+    
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += parts[i].size;
+    }
+    if (total > 0xFFFF) return ready;
+    
+    // Shorter datagrams count as zero-padded to the longest in the group
+    if (total > header_.length) {
+        header_.length = static_cast<uint16_t>(total);
+        for (size_t j = 0; j < repairs_; j++) {
+            parity_[j].resize(total, 0);
+        }
+    }
+    
+    size_t position = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < repairs_; j++) {
+            if (scheme_ == FecScheme::Xor) {
+                xor_region(parity_[j].data() + position, parts[i].data, parts[i].size);
+            } else {
+                mul_add_region(parity_[j].data() + position, parts[i].data, coefficient(j, filled_), parts[i].size);
+            }
+        }
+        position += parts[i].size;
+    }
+    
+    header_.offsets[filled_] = static_cast<uint8_t>(source.sequence - header_.base_sequence);
+    header_.fragments[filled_] = source.fragment;
+    filled_++;
+    header_.sources = static_cast<uint8_t>(filled_);
+    
+    if (filled_ == sources_) {
+        ready += emit();
+    }
+    return ready;
+}
+
+size_t FecEncoder::finish_group() {
+    return filled_ > 0 ? emit() : 0;
+}
+
+size_t FecEncoder::emit() {
+    PacketHeader header = first_;
+    header.flags = PacketHeader::kFlagFec;
+    header.fragment = 0;
+    header.fragment_count = 1;
+    header.payload_length = static_cast<uint32_t>(header_.size() + header_.length);
+    
+    for (size_t j = 0; j < repairs_; j++) {
+        std::vector<uint8_t>& out = output_[j];
+        out.resize(PacketHeader::kSize + header.payload_length);
+        header.serialize(out.data());
+        header_.index = static_cast<uint8_t>(j);
+        header_.serialize(out.data() + PacketHeader::kSize);
+        std::memcpy(out.data() + PacketHeader::kSize + header_.size(), parity_[j].data(), header_.length);
+    }
+    
+    ready_ = repairs_;
+    repairs_sent_ += repairs_;
+    filled_ = 0;
+    return ready_;
+}
+
+ConstBuffer FecEncoder::repair(size_t index) const {
+    return ConstBuffer{output_[index].data(), output_[index].size()};
+}
+
+FecDecoder::FecDecoder(size_t window) : window_(window) {}
+
+size_t FecDecoder::receive(const uint8_t* datagram, size_t size) {
+    recovered_count_ = 0;
+    
+    PacketHeader header;
+    if (!PacketHeader::parse(datagram, size, header)) return 0;
+    
+    if (header.flags & PacketHeader::kFlagFec) {
+        FecHeader fec;
+        const uint8_t* payload = datagram + PacketHeader::kSize;
+        size_t payload_size = size - PacketHeader::kSize;
+        if (!FecHeader::parse(payload, payload_size, fec) || payload_size < fec.size() + fec.length) return 0;
+        stats_.repairs++;
+        
+        Group& group = groups_[key(fec.base_sequence, fec.fragments[0])];
+        if (group.repairs.empty()) {
+            group.header = fec;
+            group.repairs.resize(fec.repairs);
+            group.have_repair.assign(fec.repairs, 0);
+        }
+        if (!group.done && fec.index < group.repairs.size() && !group.have_repair[fec.index]) {
+            group.repairs[fec.index].assign(payload + fec.size(), payload + fec.size() + fec.length);
+            group.have_repair[fec.index] = 1;
+            try_recover(group);
+        }
+    } else {
+        remember(key(header.sequence, header.fragment), datagram, size);
+        
+        // The new source may complete a group that was waiting on it
+        for (auto& entry : groups_) {
+            Group& group = entry.second;
+            uint32_t distance = header.sequence - group.header.base_sequence;
+            if (!group.done && distance <= 255) {
+                try_recover(group);
+            }
+        }
+    }
+    
+    expire(header.sequence);
+    return recovered_count_;
+}
+
+void FecDecoder::remember(uint64_t id, const uint8_t* datagram, size_t size) {
+    if (sources_.count(id)) return;
+    
+    sources_[id].assign(datagram, datagram + size);
+    order_.push_back(id);
+    if (order_.size() > window_) {
+        sources_.erase(order_.front());
+        order_.pop_front();
+    }
+}
+
+bool FecDecoder::try_recover(Group& group) {
+    const FecHeader& fec = group.header;
+    
+    size_t missing[FecHeader::kMaxSources];
+    size_t missing_count = 0;
+    for (size_t i = 0; i < fec.sources; i++) {
+        if (!sources_.count(key(fec.base_sequence + fec.offsets[i], fec.fragments[i]))) {
+            missing[missing_count++] = i;
+        }
+    }
+    if (missing_count == 0) {
+        group.done = true;
+        return false;
+    }
+    
+    size_t used[FecHeader::kMaxRepairs];
+    size_t used_count = 0;
+    for (size_t j = 0; j < group.repairs.size() && used_count < missing_count; j++) {
+        if (group.have_repair[j]) used[used_count++] = j;
+    }
+    if (used_count < missing_count) return false;
+    
+    // Syndromes: each repair with the known sources' contribution removed
+    std::vector<std::vector<uint8_t>> syndromes(missing_count);
+    for (size_t a = 0; a < missing_count; a++) {
+        syndromes[a] = group.repairs[used[a]];
+        for (size_t i = 0; i < fec.sources; i++) {
+            auto found = sources_.find(key(fec.base_sequence + fec.offsets[i], fec.fragments[i]));
+            if (found == sources_.end()) continue;
+            size_t length = std::min(found->second.size(), syndromes[a].size());
+            if (fec.scheme == FecScheme::Xor) {
+                xor_region(syndromes[a].data(), found->second.data(), length);
+            } else {
+                mul_add_region(syndromes[a].data(), found->second.data(), coefficient(used[a], i), length);
+            }
+        }
+    }
+    
+    // XOR leaves the lost datagram itself; Reed-Solomon needs the inverse of
+    // the Cauchy submatrix for the lost sources and the repairs used
+    std::vector<std::vector<uint8_t>> rebuilt(missing_count);
+    if (fec.scheme == FecScheme::Xor) {
+        rebuilt[0] = std::move(syndromes[0]);
+    } else {
+        std::vector<uint8_t> matrix(missing_count * missing_count);
+        for (size_t a = 0; a < missing_count; a++) {
+            for (size_t b = 0; b < missing_count; b++) {
+                matrix[a * missing_count + b] = coefficient(used[a], missing[b]);
+            }
+        }
+        if (!invert_matrix(matrix.data(), missing_count)) return false;
+        
+        for (size_t b = 0; b < missing_count; b++) {
+            rebuilt[b].assign(fec.length, 0);
+            for (size_t a = 0; a < missing_count; a++) {
+                mul_add_region(rebuilt[b].data(), syndromes[a].data(), matrix[b * missing_count + a], fec.length);
+            }
+        }
+    }
+    
+    group.done = true;
+    for (size_t b = 0; b < missing_count; b++) {
+        // The rebuilt header says how much of the zero-padded block is real
+        PacketHeader header;
+        std::vector<uint8_t>& datagram = rebuilt[b];
+        if (!PacketHeader::parse(datagram.data(), datagram.size(), header) ||
+            PacketHeader::kSize + header.payload_length > datagram.size()) {
+            continue;
+        }
+        datagram.resize(PacketHeader::kSize + header.payload_length);
+        remember(key(header.sequence, header.fragment), datagram.data(), datagram.size());
+        
+        if (recovered_.size() <= recovered_count_) {
+            recovered_.resize(recovered_count_ + 1);
+        }
+        recovered_[recovered_count_++] = std::move(datagram);
+        stats_.recovered++;
+    }
+    return true;
+}
+
+void FecDecoder::expire(uint32_t newest) {
+    for (auto it = groups_.begin(); it != groups_.end();) {
+        int32_t age = static_cast<int32_t>(newest - it->second.header.base_sequence);
+        if (age > static_cast<int32_t>(window_)) {
+            if (!it->second.done) {
+                stats_.unrecoverable++;
+            }
+            it = groups_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
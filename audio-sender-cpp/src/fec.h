@@ -0,0 +1,153 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+#include "network.h"
+#include "packet.h"
+
+// Forward error correction for datagram streams. Every K source datagrams
+// (header included) form a group, and M repair datagrams let a receiver
+// rebuild up to M lost ones without a retransmission round trip.
+//
+// A repair datagram is a PacketHeader with kFlagFec set, the sequence and
+// timestamp of the group's first datagram, and this payload (big-endian):
+//
+//   0  u32  sequence of the first protected datagram
+//   4  u8   scheme (FecScheme)
+//   5  u8   source count K
+//   6  u8   repair count M
+//   7  u8   repair index, 0 .. M-1
+//   8  u16  protected length: the longest source datagram
+//  10  u16  reserved
+//  12  K x (u8 sequence offset, u8 fragment) identifying the sources
+//  ..   parity, protected length bytes
+enum class FecScheme : uint8_t {
+    None = 0,
+    Xor = 1,            // one parity datagram per group; recovers a single loss
+    ReedSolomon = 2     // Cauchy Reed-Solomon over GF(2^8); recovers up to M losses
+};
+
+bool parse_fec_scheme(const std::string& name, FecScheme& scheme);
+const char* fec_scheme_name(FecScheme scheme);
+
+struct FecHeader {
+    static constexpr size_t kFixedSize = 12;
+    static constexpr size_t kMaxSources = 64;
+    static constexpr size_t kMaxRepairs = 16;
+    
+    uint32_t base_sequence = 0;
+    FecScheme scheme = FecScheme::Xor;
+    uint8_t sources = 0;
+    uint8_t repairs = 0;
+    uint8_t index = 0;
+    uint16_t length = 0;
+    uint8_t offsets[kMaxSources] = {};
+    uint8_t fragments[kMaxSources] = {};
+    
+    size_t size() const { return kFixedSize + 2 * static_cast<size_t>(sources); }
+    void serialize(uint8_t* out) const;
+    static bool parse(const uint8_t* in, size_t size, FecHeader& header);
+};
+
+class FecEncoder {
+public:
+    // SIMD kernel the GF(2^8) and XOR loops use, for benchmarks
+    static const char* kernel_name();
+    
+    // overhead_percent is repair datagrams per 100 source datagrams. XOR
+    // turns it into the group size (25% = one parity per 4); Reed-Solomon
+    // keeps group_size sources and adds enough repairs to match it.
+    bool configure(FecScheme scheme, int overhead_percent, int group_size);
+    
+    // Takes effect at the next group
+    void set_overhead(int overhead_percent);
+    int overhead_percent() const { return overhead_percent_; }
+    
+    // Bytes a repair datagram adds on top of the longest source datagram;
+    // sources must be this much smaller than the path allows
+    size_t repair_overhead() const;
+    
+    // Protects one outgoing datagram given as its header and payload parts.
+    // Returns how many repair datagrams became ready (0 until the group is full).
+    size_t add(const ConstBuffer* parts, size_t count);
+    
+    // Closes a partial group, e.g. when DTX stops the stream; returns repairs ready
+    size_t finish_group();
+    
+    // Repair datagram i of the group that just completed
+    ConstBuffer repair(size_t index) const;
+    
+    uint8_t sources() const { return sources_; }
+    uint8_t repairs() const { return repairs_; }
+    uint64_t repairs_sent() const { return repairs_sent_; }
+
+private:
+    // Group size and repair count for the current overhead
+    void apply_overhead();
+    size_t emit();
+    
+    FecScheme scheme_ = FecScheme::None;
+    int overhead_percent_ = 0;
+    int group_size_ = 8;
+    uint8_t sources_ = 0;
+    uint8_t repairs_ = 0;
+    
+    // Group being built: sources so far, their ids, the first one's header and the running parity
+    FecHeader header_;
+    size_t filled_ = 0;
+    PacketHeader first_;
+    std::vector<std::vector<uint8_t>> parity_;
+    std::vector<std::vector<uint8_t>> output_;
+    size_t ready_ = 0;
+    uint64_t repairs_sent_ = 0;
+};
+
+struct FecDecoderStats {
+    uint64_t repairs = 0;           // repair datagrams received
+    uint64_t recovered = 0;         // source datagrams rebuilt
+    uint64_t unrecoverable = 0;     // groups that lost more than they could repair
+};
+
+// Receive side: feed every datagram as it arrives. Lost sources that a
+// group's repairs can rebuild come back from recovered() in full, header
+// included, exactly as the sender sent them. A late original may still
+// arrive after its recovered copy; receivers drop duplicates by sequence.
+class FecDecoder {
+public:
+    explicit FecDecoder(size_t window = 512);
+    
+    // Returns how many datagrams this one allowed to recover
+    size_t receive(const uint8_t* datagram, size_t size);
+    
+    const std::vector<uint8_t>& recovered(size_t index) const { return recovered_[index]; }
+    const FecDecoderStats& stats() const { return stats_; }
+
+private:
+    struct Group {
+        FecHeader header;
+        std::vector<std::vector<uint8_t>> repairs;
+        std::vector<uint8_t> have_repair;
+        bool done = false;
+    };
+    
+    static uint64_t key(uint32_t sequence, uint8_t fragment) {
+        return (static_cast<uint64_t>(sequence) << 8) | fragment;
+    }
+    
+    void remember(uint64_t id, const uint8_t* datagram, size_t size);
+    bool try_recover(Group& group);
+    void expire(uint32_t newest);
+    
+    size_t window_;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> sources_;
+    std::deque<uint64_t> order_;
+    std::unordered_map<uint64_t, Group> groups_;    // keyed by first source id
+    std::vector<std::vector<uint8_t>> recovered_;
+    size_t recovered_count_ = 0;
+    FecDecoderStats stats_;
+};
@@ -0,0 +1,262 @@
+#include "feedback.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Reads per poll(), so a flood of relayed audio cannot hold up the sender thread
+constexpr int kMaxReadsPerPoll = 64;
+
+// Largest report payload accepted; later versions may append fields
+constexpr size_t kMaxReportPayload = 256;
+
+void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+// Rounds into a report field, saturating instead of wrapping
+uint32_t saturate_u32(double value) {
+    return static_cast<uint32_t>(std::min(std::round(value), 4294967295.0));
+}
+
+} // namespace
+
+void ReceiverReport::serialize(uint8_t* out) const {
+    put_u32(out, highest_sequence);
+    put_u32(out + 4, cumulative_lost);
+    out[8] = fraction_lost;
+    out[9] = out[10] = out[11] = 0;
+    put_u32(out + 12, jitter);
+    put_u32(out + 16, echo_sequence);
+    put_u32(out + 20, echo_delay_us);
+    put_u32(out + 24, queue_ms);
+}
+
+bool ReceiverReport::parse(const uint8_t* in, size_t size, ReceiverReport& report) {
+    if (size < kSize) return false;
+    
+    report.highest_sequence = get_u32(in);
+    report.cumulative_lost = get_u32(in + 4);
+    report.fraction_lost = in[8];
+    report.jitter = get_u32(in + 12);
+    report.echo_sequence = get_u32(in + 16);
+    report.echo_delay_us = get_u32(in + 20);
+    report.queue_ms = get_u32(in + 24);
+    return true;
+}
+
+FeedbackReceiver::FeedbackReceiver(uint32_t stream_id, int sample_rate, bool stream)
+    : stream_id_(stream_id), sample_rate_(sample_rate), stream_(stream),
+      sent_(kSentHistory), buffer_(65536), last_poll_(std::chrono::steady_clock::now()) {
+    pending_.reserve(PacketHeader::kSize + kMaxReportPayload);
+}
+
+void FeedbackReceiver::sent(uint32_t first, uint32_t end) {
+    auto now = std::chrono::steady_clock::now();
+    for (uint32_t sequence = first; sequence != end; sequence++) {
+        Sent& slot = sent_[sequence & (kSentHistory - 1)];
+        slot.sequence = sequence;
+        slot.time = now;
+        slot.valid = true;
+    }
+}
+
+bool FeedbackReceiver::poll(Connection& connection) {
+    // A new connection is a new byte stream
+    if (connection.stats().reconnects != reconnects_) {
+        reconnects_ = connection.stats().reconnects;
+        pending_.clear();
+        skip_ = 0;
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    arrival_ = last_poll_ + (now - last_poll_) / 2;
+    last_poll_ = now;
+    
+    bool reported = false;
+    for (int reads = 0; reads < kMaxReadsPerPoll; reads++) {
+        int received = connection.receive(buffer_.data(), buffer_.size());
+        if (received <= 0) break;
+        
+        size_t size = static_cast<size_t>(received);
+        bool report = stream_ ? parse_stream(buffer_.data(), size) : parse_message(buffer_.data(), size);
+        reported = reported || report;
+    }
+    return reported;
+}
+
+bool FeedbackReceiver::parse_message(const uint8_t* data, size_t size) {
+    PacketHeader header;
+    if (!PacketHeader::parse(data, size, header) || !(header.flags & PacketHeader::kFlagReport)) {
+        return false;
+    }
+    size_t payload = std::min<size_t>(header.payload_length, size - PacketHeader::kSize);
+    return handle_report(header, data + PacketHeader::kSize, payload);
+}
+
+bool FeedbackReceiver::parse_stream(const uint8_t* data, size_t size) {
+    bool reported = false;
+    
+    while (size > 0) {
+        if (skip_ > 0) {
+            size_t skipped = std::min(skip_, size);
+            skip_ -= skipped;
+            data += skipped;
+            size -= skipped;
+            continue;
+        }
+        
+        // pending_ holds a partial header, or the header of a report and part of its payload
+        PacketHeader header;
+        bool have_header = pending_.size() >= PacketHeader::kSize &&
+                           PacketHeader::parse(pending_.data(), pending_.size(), header);
+        size_t want = PacketHeader::kSize + (have_header ? header.payload_length : 0);
+        size_t take = std::min(want - pending_.size(), size);
+        pending_.insert(pending_.end(), data, data + take);
+        data += take;
+        size -= take;
+        if (pending_.size() < want) break;
+        
+        if (!have_header) {
+            if (!PacketHeader::parse(pending_.data(), pending_.size(), header)) {
+                // Out of sync, e.g. a headerless sender's bytes relayed to us: slide to the next byte
+                pending_.erase(pending_.begin());
+                continue;
+            }
+            if (!(header.flags & PacketHeader::kFlagReport) || header.payload_length > kMaxReportPayload) {
+                skip_ = header.payload_length;
+                pending_.clear();
+                continue;
+            }
+            if (header.payload_length > 0) continue;
+        }
+        
+        bool report = handle_report(header, pending_.data() + PacketHeader::kSize, header.payload_length);
+        reported = reported || report;
+        pending_.clear();
+    }
+    return reported;
+}
+
+bool FeedbackReceiver::handle_report(const PacketHeader& header, const uint8_t* payload, size_t size) {
+    ReceiverReport report;
+    if (header.stream_id != stream_id_ || !ReceiverReport::parse(payload, size, report)) return false;
+    
+    feedback_.loss = report.fraction_lost / 256.0;
+    feedback_.jitter_ms = report.jitter * 1000.0 / sample_rate_;
+    feedback_.queue_ms = report.queue_ms;
+    
+    // RTT from the echoed packet, if it is still in the history
+    const Sent& slot = sent_[report.echo_sequence & (kSentHistory - 1)];
+    if (slot.valid && slot.sequence == report.echo_sequence) {
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::max(arrival_, slot.time) - slot.time).count();
+        double rtt_ms = elapsed_ms - report.echo_delay_us / 1000.0;
+        if (rtt_ms >= 0.0) {
+            feedback_.rtt_ms = rtt_ms;
+        }
+    }
+    
+    stats_.reports++;
+    stats_.cumulative_lost = report.cumulative_lost;
+    stats_.last_loss = feedback_.loss;
+    stats_.last_jitter_ms = feedback_.jitter_ms;
+    stats_.last_rtt_ms = feedback_.rtt_ms;
+    return true;
+}
+
+void ReceptionStats::reset(const PacketHeader& header, Clock::time_point now) {
+    started_ = true;
+    stream_id_ = header.stream_id;
+    sample_rate_ = header.sample_rate;
+    max_sequence_ = header.sequence;
+    extended_max_ = 0;
+    received_ = 0;
+    expected_prior_ = 0;
+    received_prior_ = 0;
+    bytes_ = 0;
+    reports_ = 0;
+    jitter_ = 0.0;
+    have_transit_ = false;
+    epoch_ = now;
+    last_report_ = now;
+}
+
+void ReceptionStats::on_packet(const PacketHeader& header, size_t size, Clock::time_point now) {
+    // Repairs reuse their group's sequence number; fragments share one
+    const uint8_t skipped = PacketHeader::kFlagFec | PacketHeader::kFlagReport;
+    if ((header.flags & skipped) || header.fragment != 0 || header.sample_rate == 0) return;
+    
+    if (!started_ || header.stream_id != stream_id_) {
+        reset(header, now);
+    }
+    
+    int32_t delta = static_cast<int32_t>(header.sequence - max_sequence_);
+    if (delta > 0) {
+        max_sequence_ = header.sequence;
+        extended_max_ += static_cast<uint64_t>(delta);
+    }
+    received_++;
+    bytes_ += size;
+    last_sequence_ = header.sequence;
+    last_arrival_ = now;
+    
+    // Interarrival jitter in samples; DTX gaps move both clocks alike
+    double arrival = std::chrono::duration<double>(now - epoch_).count() * sample_rate_;
+    double transit = arrival - static_cast<double>(header.timestamp);
+    if (have_transit_) {
+        jitter_ += (std::abs(transit - transit_) - jitter_) / 16.0;
+    }
+    transit_ = transit;
+    have_transit_ = true;
+}
+
+bool ReceptionStats::build_report(Clock::time_point now, size_t backlog_bytes, uint8_t* out) {
+    if (!started_ || received_ == received_prior_) return false;
+    
+    uint64_t expected = extended_max_ + 1;
+    uint64_t lost = expected > received_ ? expected - received_ : 0;
+    uint64_t expected_interval = expected - expected_prior_;
+    uint64_t received_interval = received_ - received_prior_;
+    expected_prior_ = expected;
+    received_prior_ = received_;
+    uint8_t fraction = 0;
+    if (expected_interval > received_interval) {
+        fraction = static_cast<uint8_t>(std::min<uint64_t>(255, (expected_interval - received_interval) * 256 /
+                                                                     expected_interval));
+    }
+    
+    // Backlog in milliseconds of this sender's own byte rate
+    double interval_ms = std::chrono::duration<double, std::milli>(now - last_report_).count();
+    double bytes_per_ms = interval_ms > 0.0 ? bytes_ / interval_ms : 0.0;
+    bytes_ = 0;
+    last_report_ = now;
+    double queue_ms = bytes_per_ms > 0.0 ? backlog_bytes / bytes_per_ms : 0.0;
+    double delay_us = std::chrono::duration<double, std::micro>(now - last_arrival_).count();
+    
+    PacketHeader header;
+    header.flags = PacketHeader::kFlagReport;
+    header.stream_id = stream_id_;
+    header.sequence = reports_++;
+    header.sample_rate = sample_rate_;
+    header.payload_length = ReceiverReport::kSize;
+    header.serialize(out);
+    
+    ReceiverReport report;
+    report.highest_sequence = max_sequence_;
+    report.cumulative_lost = static_cast<uint32_t>(std::min<uint64_t>(lost, 0xffffffff));
+    report.fraction_lost = fraction;
+    report.jitter = saturate_u32(jitter_);
+    report.echo_sequence = last_sequence_;
+    report.echo_delay_us = saturate_u32(delay_us);
+    report.queue_ms = saturate_u32(queue_ms);
+    report.serialize(out + PacketHeader::kSize);
+    return true;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "connection.h"
+#include "packet.h"
+
+// Receiver report the relay sends back about one stream, modelled on the
+// RTCP receiver report block. It travels as a PacketHeader with
+// kFlagReport set and the reported stream's id, followed by this payload
+// (big-endian):
+//
+//   0  u32  highest sequence number received
+//   4  u32  cumulative packets lost
+//   8  u8   fraction lost since the previous report, out of 256
+//   9  u8   reserved (3 bytes)
+//  12  u32  interarrival jitter, in samples at the stream's rate (RFC 3550)
+//  16  u32  sequence of the packet received last
+//  20  u32  microseconds between receiving that packet and sending the report
+//  24  u32  audio waiting in the relay toward its listeners, in ms
+struct ReceiverReport {
+    static constexpr size_t kSize = 28;
+    
+    uint32_t highest_sequence = 0;
+    uint32_t cumulative_lost = 0;
+    uint8_t fraction_lost = 0;
+    uint32_t jitter = 0;
+    uint32_t echo_sequence = 0;
+    uint32_t echo_delay_us = 0;
+    uint32_t queue_ms = 0;
+    
+    void serialize(uint8_t* out) const;
+    static bool parse(const uint8_t* in, size_t size, ReceiverReport& report);
+};
+
+// What one report says about the path, in units the controller uses
+struct PathFeedback {
+    double loss = 0.0;          // fraction lost since the previous report, 0..1
+    double jitter_ms = 0.0;
+    double rtt_ms = -1.0;       // negative until a report echoes a packet we still remember
+    double queue_ms = 0.0;      // relay backlog
+};
+
+struct FeedbackStats {
+    uint64_t reports = 0;
+    uint64_t cumulative_lost = 0;
+    double last_loss = 0.0;
+    double last_jitter_ms = 0.0;
+    double last_rtt_ms = -1.0;
+};
+
+// Sender-thread side of the report channel. Remembers when each sequence
+// number went out, drains whatever the relay sent back, and turns reports
+// for our stream into PathFeedback with a round-trip time: the send time of
+// the echoed packet, minus the time the relay held it, subtracted from now.
+// Everything else on the socket (other senders' audio relayed to us) is
+// skipped without copying its payload.
+class FeedbackReceiver {
+public:
+    FeedbackReceiver(uint32_t stream_id, int sample_rate, bool stream);
+    
+    // Sequences [first, end) were just submitted
+    void sent(uint32_t first, uint32_t end);
+    
+    // Reads until the socket is empty; true if a report for our stream arrived
+    bool poll(Connection& connection);
+    
+    // Path state from the newest report
+    const PathFeedback& feedback() const { return feedback_; }
+    const FeedbackStats& stats() const { return stats_; }
+
+private:
+    static constexpr size_t kSentHistory = 1024;    // power of two
+    
+    struct Sent {
+        uint32_t sequence = 0;
+        std::chrono::steady_clock::time_point time;
+        bool valid = false;
+    };
+    
+    // Datagrams carry one message each; streams are reassembled here
+    bool parse_message(const uint8_t* data, size_t size);
+    bool parse_stream(const uint8_t* data, size_t size);
+    bool handle_report(const PacketHeader& header, const uint8_t* payload, size_t size);
+    
+    uint32_t stream_id_;
+    int sample_rate_;
+    bool stream_;
+    uint64_t reconnects_ = 0;
+    
+    std::vector<Sent> sent_;
+    std::vector<uint8_t> buffer_;
+    
+    // Stream reassembly: a partial header or report in pending_, or payload bytes to skip
+    std::vector<uint8_t> pending_;
+    size_t skip_ = 0;
+    
+    // A report read now arrived at some point since the previous poll; the
+    // midpoint halves the error the sender thread's frame cadence adds to RTT
+    std::chrono::steady_clock::time_point arrival_;
+    std::chrono::steady_clock::time_point last_poll_;
+    
+    PathFeedback feedback_;
+    FeedbackStats stats_;
+};
+
+// Relay side of the report channel: reception statistics for one sender,
+// kept like an RTCP receiver (RFC 3550 A.1, A.3 and A.8), and the report
+// that goes back to it. Matches the ReceiverStats of linux-cli-server.js.
+class ReceptionStats {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    // A whole report: PacketHeader plus ReceiverReport
+    static constexpr size_t kReportSize = PacketHeader::kSize + ReceiverReport::kSize;
+    
+    // A header-framed packet of size bytes arrived at now. Repairs, reports
+    // and fragments after the first are not counted.
+    void on_packet(const PacketHeader& header, size_t size, Clock::time_point now);
+    
+    // Writes the report for the packets since the previous one into out;
+    // false if none arrived. backlog_bytes is relay output still queued
+    // toward listeners, reported in ms of this sender's own byte rate.
+    bool build_report(Clock::time_point now, size_t backlog_bytes, uint8_t* out);
+    
+    bool active() const { return started_; }
+
+private:
+    void reset(const PacketHeader& header, Clock::time_point now);
+    
+    bool started_ = false;
+    uint32_t stream_id_ = 0;
+    uint32_t sample_rate_ = 0;
+    uint32_t max_sequence_ = 0;
+    uint32_t last_sequence_ = 0;
+    uint64_t extended_max_ = 0;
+    uint64_t received_ = 0;
+    uint64_t expected_prior_ = 0;
+    uint64_t received_prior_ = 0;
+    uint64_t bytes_ = 0;
+    uint32_t reports_ = 0;
+    double jitter_ = 0.0;
+    double transit_ = 0.0;
+    bool have_transit_ = false;
+    Clock::time_point epoch_;
+    Clock::time_point last_arrival_;
+    Clock::time_point last_report_;
+};
@@ -7,6 +7,9 @@
 #include <chrono>
 #include <cstring>
 #include <csignal>
+#include <algorithm>
+#include <random>
+#include <fstream>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -22,15 +25,61 @@
 
 #include "audio_base.h"
 #include "network.h"
+#include "ring_buffer.h"
+#include "pipeline.h"
+#include "codec.h"
+#include "packet.h"
+#include "net_engine.h"
+#include "connection.h"
+#include "resolver.h"
+#include "fec.h"
+#include "feedback.h"
+#include "rate_control.h"
+#include "rtp.h"
+#include "destination.h"
+#include "uring.h"
 
 struct Config {
-    std::string server_addr = "localhost";
+    std::vector<DestinationSpec> servers;   // --server, once per destination
     int server_port = 8080;
     std::string protocol = "tcp";
     std::string device_name;
     int sample_rate = 16000;
+    int capture_rate = 0;
     int channels = 1;
     int buffer_size = 1024;
+    int queue_ms = 200;
+    SampleFormat format = SampleFormat::F32;
+    bool dither = false;
+    Codec codec = Codec::PCM;
+    int opus_bitrate = 24000;
+    int opus_complexity = 5;
+    int opus_frame_ms = 20;
+    bool dtx = false;
+    int vad_hangover_ms = 300;
+    int keepalive_ms = 500;
+    bool raw = false;
+    int mtu = static_cast<int>(UDPNetwork::kDefaultMtu);
+    UDPNetwork::SendMode udp_send = UDPNetwork::SendMode::Segment;
+    std::string io = NetworkEngine::supported() ? "epoll" : "blocking";
+    int net_queue_ms = 150;
+    OverflowPolicy overflow = OverflowPolicy::DropOldest;
+    bool reconnect = true;
+    int reconnect_max_ms = 10000;
+    int replay_ms = 1000;
+    OutagePolicy outage = OutagePolicy::Replay;
+    FecScheme fec = FecScheme::None;
+    int fec_overhead = 25;
+    int fec_group = 8;
+    bool adapt = true;
+    int rtp_payload_type = -1;
+    std::string sdp_file;
+    uint32_t stream_id = 0;
+    std::string input_file;
+    bool fast = false;
+    bool loop = false;
+    std::string synth;
+    double synth_freq = 440.0;
     bool list_devices = false;
 };
 
@@ -38,18 +87,53 @@ void print_usage(const char* program_name) {
     std::cout << "🎤 Audio Sender v1.0\n";
     std::cout << "Usage: " << program_name << " [OPTIONS]\n\n";
     std::cout << "Options:\n";
-    std::cout << "  -s, --server ADDR      Server address (default: localhost)\n";
-    std::cout << "  -p, --port PORT        Server port (default: 8080)\n";
-    std::cout << "  --protocol PROTO       Protocol tcp/udp (default: tcp)\n";
+    std::cout << "  -s, --server ADDR      Server [tcp|udp|rtp://]host[:port]; repeat to fan out (default: localhost)\n";
+    std::cout << "  -p, --port PORT        Server port when ADDR has none (default: 8080)\n";
+    std::cout << "  --protocol PROTO       Protocol tcp/udp/rtp when ADDR has none (default: tcp)\n";
     std::cout << "  -d, --device NAME      Microphone device name\n";
     std::cout << "  -r, --sample-rate RATE Sample rate in Hz (default: 16000)\n";
+    std::cout << "  --capture-rate RATE    Device capture rate; 0 = device native (default: 0)\n";
     std::cout << "  -c, --channels NUM     Number of channels (default: 1)\n";
+    std::cout << "  -f, --format FMT       Wire format f32/s16/s24 (default: f32)\n";
+    std::cout << "  --dither               Apply TPDF dither when converting to s16/s24\n";
+    std::cout << "  --codec CODEC          Payload codec pcm/opus (default: pcm)\n";
+    std::cout << "  --bitrate BPS          Opus bitrate in bit/s (default: 24000)\n";
+    std::cout << "  --complexity N         Opus complexity 0-10 (default: 5)\n";
+    std::cout << "  --frame-ms MS          Opus frame duration 10/20/40 (default: 20)\n";
+    std::cout << "  --dtx                  Suppress silent frames (voice activity detection)\n";
+    std::cout << "  --vad-hangover MS      Keep sending this long after speech ends (default: 300)\n";
+    std::cout << "  --dtx-keepalive MS     Comfort-noise packet interval in silence (default: 500)\n";
+    std::cout << "  --stream-id ID         Stream ID in packet headers (default: random)\n";
+    std::cout << "  --raw                  Send bare payloads without packet headers (legacy)\n";
+    std::cout << "  --rtp-pt N             RTP payload type (default: 10/11 for 44.1 kHz L16, 96, opus 111)\n";
+    std::cout << "  --sdp FILE             Write the RTP session description to FILE\n";
+    std::cout << "  --mtu BYTES            Cap on the UDP path MTU (default: 1500)\n";
+    std::cout << "  --udp-send MODE        UDP batching gso/mmsg/single (default: gso)\n";
+    std::cout << "  --fec SCHEME           UDP forward error correction off/xor/rs (default: off)\n";
+    std::cout << "  --fec-overhead PCT     Repair datagrams per 100 sent (default: 25)\n";
+    std::cout << "  --fec-group N          Datagrams per Reed-Solomon group (default: 8)\n";
+    std::cout << "  --no-adapt             Ignore receiver reports; keep bitrate, frames, FEC and DTX fixed\n";
+    std::cout << "  --io MODE              Network I/O epoll/uring/blocking (default: epoll on Linux)\n";
+    std::cout << "  --net-queue-ms MS      Outbound queue budget for epoll/uring I/O (default: 150)\n";
+    std::cout << "  --overflow POLICY      drop-oldest/drop-newest/downgrade (default: drop-oldest)\n";
+    std::cout << "  --no-reconnect         Exit when the connection fails instead of retrying\n";
+    std::cout << "  --reconnect-max-ms MS  Longest wait between reconnect attempts (default: 10000)\n";
+    std::cout << "  --outage POLICY        Audio captured while disconnected replay/drop (default: replay)\n";
+    std::cout << "  --replay-ms MS         Audio held for replay after an outage (default: 1000)\n";
+    std::cout << "  -q, --queue-ms MS      Capture-to-sender queue depth (default: 200)\n";
+    std::cout << "  -i, --input-file PATH  Replay a WAV or raw float32 file instead of a device\n";
+    std::cout << "  --fast                 Replay the file as fast as possible (benchmarks)\n";
+    std::cout << "  --loop                 Restart the file at the end\n";
+    std::cout << "  --synth SIGNAL         Generate sine/noise/chirp/speech instead of capturing\n";
+    std::cout << "  --synth-freq HZ        Sine frequency / chirp start (default: 440)\n";
     std::cout << "  -l, --list-devices     List available audio devices\n";
     std::cout << "  -h, --help             Show this help\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << program_name << " -l                    # List devices\n";
     std::cout << "  " << program_name << " -s 192.168.1.100     # Connect to remote server\n";
     std::cout << "  " << program_name << " --protocol udp       # Use UDP\n";
+    std::cout << "  " << program_name << " --protocol rtp --sdp stream.sdp # RTP for ffplay/GStreamer\n";
+    std::cout << "  " << program_name << " -s tcp://relay:8080 -s udp://standby:8081 # Two relays, one capture\n";
     std::cout << "  " << program_name << " -d \"USB Microphone\" # Use specific mic\n";
 }
 
@@ -65,14 +149,12 @@ Config parse_args(int argc, char* argv[]) {
         } else if (arg == "-l" || arg == "--list-devices") {
             config.list_devices = true;
         } else if ((arg == "-s" || arg == "--server") && i + 1 < argc) {
-            std::string server_full = argv[++i];
-            size_t colon_pos = server_full.find(':');
-            if (colon_pos != std::string::npos) {
-                config.server_addr = server_full.substr(0, colon_pos);
-                config.server_port = std::stoi(server_full.substr(colon_pos + 1));
-            } else {
-                config.server_addr = server_full;
+            DestinationSpec spec;
+            if (!DestinationSpec::parse(argv[++i], spec)) {
+                std::cerr << "Invalid server: " << argv[i] << std::endl;
+                exit(1);
             }
+            config.servers.push_back(spec);
         } else if ((arg == "-p" || arg == "--port") && i + 1 < argc) {
             config.server_port = std::stoi(argv[++i]);
         } else if (arg == "--protocol" && i + 1 < argc) {
@@ -81,8 +163,103 @@ Config parse_args(int argc, char* argv[]) {
             config.device_name = argv[++i];
         } else if ((arg == "-r" || arg == "--sample-rate") && i + 1 < argc) {
             config.sample_rate = std::stoi(argv[++i]);
+        } else if (arg == "--capture-rate" && i + 1 < argc) {
+            config.capture_rate = std::stoi(argv[++i]);
         } else if ((arg == "-c" || arg == "--channels") && i + 1 < argc) {
             config.channels = std::stoi(argv[++i]);
+        } else if ((arg == "-f" || arg == "--format") && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parse_sample_format(name, config.format)) {
+                std::cerr << "Invalid format: " << name << " (use f32, s16 or s24)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--dither") {
+            config.dither = true;
+        } else if (arg == "--codec" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parse_codec(name, config.codec)) {
+                std::cerr << "Invalid codec: " << name << " (use pcm or opus)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--bitrate" && i + 1 < argc) {
+            config.opus_bitrate = std::stoi(argv[++i]);
+        } else if (arg == "--complexity" && i + 1 < argc) {
+            config.opus_complexity = std::stoi(argv[++i]);
+        } else if (arg == "--frame-ms" && i + 1 < argc) {
+            config.opus_frame_ms = std::stoi(argv[++i]);
+        } else if (arg == "--dtx") {
+            config.dtx = true;
+        } else if (arg == "--vad-hangover" && i + 1 < argc) {
+            config.vad_hangover_ms = std::stoi(argv[++i]);
+        } else if (arg == "--dtx-keepalive" && i + 1 < argc) {
+            config.keepalive_ms = std::stoi(argv[++i]);
+        } else if (arg == "--stream-id" && i + 1 < argc) {
+            config.stream_id = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--raw") {
+            config.raw = true;
+        } else if (arg == "--rtp-pt" && i + 1 < argc) {
+            config.rtp_payload_type = std::stoi(argv[++i]);
+            if (config.rtp_payload_type < 0 || config.rtp_payload_type > 127) {
+                std::cerr << "Invalid RTP payload type: " << config.rtp_payload_type << " (use 0-127)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--sdp" && i + 1 < argc) {
+            config.sdp_file = argv[++i];
+        } else if (arg == "--mtu" && i + 1 < argc) {
+            config.mtu = std::stoi(argv[++i]);
+        } else if (arg == "--io" && i + 1 < argc) {
+            config.io = argv[++i];
+        } else if (arg == "--net-queue-ms" && i + 1 < argc) {
+            config.net_queue_ms = std::stoi(argv[++i]);
+        } else if (arg == "--overflow" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parse_overflow_policy(name, config.overflow)) {
+                std::cerr << "Invalid overflow policy: " << name
+                          << " (use drop-oldest, drop-newest or downgrade)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--fec" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parse_fec_scheme(name, config.fec)) {
+                std::cerr << "Invalid FEC scheme: " << name << " (use off, xor or rs)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--fec-overhead" && i + 1 < argc) {
+            config.fec_overhead = std::stoi(argv[++i]);
+        } else if (arg == "--fec-group" && i + 1 < argc) {
+            config.fec_group = std::stoi(argv[++i]);
+        } else if (arg == "--no-adapt") {
+            config.adapt = false;
+        } else if (arg == "--no-reconnect") {
+            config.reconnect = false;
+        } else if (arg == "--reconnect-max-ms" && i + 1 < argc) {
+            config.reconnect_max_ms = std::stoi(argv[++i]);
+        } else if (arg == "--replay-ms" && i + 1 < argc) {
+            config.replay_ms = std::stoi(argv[++i]);
+        } else if (arg == "--outage" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parse_outage_policy(name, config.outage)) {
+                std::cerr << "Invalid outage policy: " << name << " (use replay or drop)" << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--udp-send" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!UDPNetwork::parse_send_mode(name, config.udp_send)) {
+                std::cerr << "Invalid UDP send mode: " << name << " (use gso, mmsg or single)" << std::endl;
+                exit(1);
+            }
+        } else if ((arg == "-q" || arg == "--queue-ms") && i + 1 < argc) {
+            config.queue_ms = std::stoi(argv[++i]);
+        } else if ((arg == "-i" || arg == "--input-file") && i + 1 < argc) {
+            config.input_file = argv[++i];
+        } else if (arg == "--fast") {
+            config.fast = true;
+        } else if (arg == "--loop") {
+            config.loop = true;
+        } else if (arg == "--synth" && i + 1 < argc) {
+            config.synth = argv[++i];
+        } else if (arg == "--synth-freq" && i + 1 < argc) {
+            config.synth_freq = std::stod(argv[++i]);
         } else {
             std::cerr << "Unknown argument: " << arg << std::endl;
             print_usage(argv[0]);
@@ -90,11 +267,144 @@ Config parse_args(int argc, char* argv[]) {
         }
     }
     
+    // Destinations without their own protocol or port take --protocol and --port
+    if (config.servers.empty()) {
+        DestinationSpec spec;
+        spec.host = "localhost";
+        config.servers.push_back(spec);
+    }
+    for (DestinationSpec& spec : config.servers) {
+        if (spec.protocol.empty()) {
+            spec.protocol = config.protocol;
+        }
+        if (spec.port == 0) {
+            spec.port = config.server_port;
+        }
+        if (spec.protocol != "tcp" && spec.protocol != "udp" && spec.protocol != "rtp") {
+            std::cerr << "Invalid protocol for " << spec.to_string() << ". Use 'tcp', 'udp' or 'rtp'" << std::endl;
+            exit(1);
+        }
+    }
+    
     return config;
 }
 
 std::atomic<bool> running{true};
 
+void print_dtx_stats(const PipelineStats& stats) {
+    uint64_t frames = stats.frames_in;
+    uint64_t suppressed = stats.frames_suppressed;
+    double talk_ratio = frames > 0 ? 100.0 * (frames - suppressed) / frames : 0.0;
+    std::cout << "🤫 DTX: " << suppressed << "/" << frames << " frames suppressed, "
+              << stats.keepalives << " keepalives, " << stats.bytes_saved << " bytes saved (talk "
+              << talk_ratio << "%)\n";
+}
+
+void print_network_stats(const NetworkStats& stats, double elapsed) {
+    uint64_t messages = stats.messages;
+    uint64_t bytes = stats.bytes;
+    uint64_t syscalls = stats.syscalls;
+    std::cout << "📊 Sent " << messages << " packets, " << bytes << " bytes in " << elapsed << " s ("
+              << (elapsed > 0 ? bytes * 8 / elapsed / 1000 : 0) << " kbit/s, "
+              << (messages > 0 ? static_cast<double>(syscalls) / messages : 0.0) << " syscalls/packet)\n";
+}
+
+void print_engine_stats(const NetworkEngine& engine, int sample_rate) {
+    const EngineStats& stats = engine.stats();
+    std::cout << "🚦 Send queue: peak " << stats.peak_queue_frames * 1000 / sample_rate << " ms, dropped "
+              << stats.dropped_oldest << " oldest / " << stats.dropped_newest << " newest, "
+              << stats.downgrades << " downgrades\n";
+    if (stats.zerocopy_sends > 0) {
+        std::cout << "📎 Zero-copy sends: " << stats.zerocopy_sends << "\n";
+    }
+}
+
+void print_connection_stats(const ConnectionStats& stats) {
+    std::cout << "🔌 Outages: " << stats.outages << ", reconnects " << stats.reconnects
+              << " (" << stats.failed_attempts << " failed attempts), replayed "
+              << stats.replayed << " / discarded " << stats.discarded << " messages\n";
+}
+
+void print_adaptation(const std::string& name, const PathFeedback& feedback, const RateDecision& decision,
+                      bool congested) {
+    std::cout << "📶 " << (name.empty() ? "" : name + " ") << (congested ? "Congested" : "Clear") << ": loss "
+              << feedback.loss * 100.0
+              << "%, jitter " << feedback.jitter_ms << " ms";
+    if (feedback.rtt_ms >= 0.0) {
+        std::cout << ", RTT " << feedback.rtt_ms << " ms";
+    }
+    std::cout << " ->";
+    if (decision.bitrate > 0) {
+        std::cout << " " << decision.bitrate / 1000.0 << " kbit/s, " << decision.frame_ms << " ms frames";
+    }
+    if (decision.fec_overhead > 0) {
+        std::cout << " FEC " << decision.fec_overhead << "%";
+    }
+    if (decision.hangover_ms > 0) {
+        std::cout << " hangover " << decision.hangover_ms << " ms";
+    }
+    std::cout << "\n";
+}
+
+void print_feedback_stats(const FeedbackStats& stats) {
+    std::cout << "📶 Feedback: " << stats.reports << " reports, " << stats.cumulative_lost
+              << " packets lost, last loss " << stats.last_loss * 100.0 << "%, jitter "
+              << stats.last_jitter_ms << " ms";
+    if (stats.last_rtt_ms >= 0.0) {
+        std::cout << ", RTT " << stats.last_rtt_ms << " ms";
+    }
+    std::cout << "\n";
+}
+
+void print_rtcp_stats(const RtcpStats& stats) {
+    std::cout << "📶 RTCP: " << stats.sender_reports << " sender reports, " << stats.receiver_reports
+              << " receiver reports";
+    if (stats.receiver_reports > 0) {
+        std::cout << ", " << stats.cumulative_lost << " packets lost, last loss " << stats.last_loss * 100.0
+                  << "%, jitter " << stats.last_jitter_ms << " ms";
+        if (stats.last_rtt_ms >= 0.0) {
+            std::cout << ", RTT " << stats.last_rtt_ms << " ms";
+        }
+    }
+    std::cout << "\n";
+}
+
+// RTP cannot fragment, so codec packets must fit the smallest RTP datagram
+size_t rtp_payload_limit(std::vector<std::unique_ptr<Destination>>& destinations) {
+    size_t limit = 0;
+    for (auto& destination : destinations) {
+        size_t destination_limit = destination->payload_limit();
+        if (destination_limit > 0) {
+            limit = limit == 0 ? destination_limit : std::min(limit, destination_limit);
+        }
+    }
+    return limit;
+}
+
+// The encoder is shared, so it follows the most constrained destination
+void apply_rate_decisions(SendPipeline& pipeline, const std::vector<std::unique_ptr<Destination>>& destinations) {
+    int bitrate = 0;
+    int frame_ms = 0;
+    int hangover_ms = 0;
+    for (const auto& destination : destinations) {
+        const RateDecision& decision = destination->controller().decision();
+        if (decision.bitrate > 0) {
+            bitrate = bitrate == 0 ? decision.bitrate : std::min(bitrate, decision.bitrate);
+            frame_ms = std::max(frame_ms, decision.frame_ms);
+        }
+        if (decision.hangover_ms > 0) {
+            hangover_ms = hangover_ms == 0 ? decision.hangover_ms : std::min(hangover_ms, decision.hangover_ms);
+        }
+    }
+    if (bitrate > 0) {
+        pipeline.set_bitrate(bitrate);
+        pipeline.set_frame_ms(frame_ms);
+    }
+    if (hangover_ms > 0) {
+        pipeline.set_vad_hangover(hangover_ms);
+    }
+}
+
 void signal_handler(int) {
     std::cout << "\n🛑 Stopping audio sender...\n";
     running = false;
@@ -107,8 +417,30 @@ int main(int argc, char* argv[]) {
         // Initialize platform-specific networking
         Network::initialize();
         
+        // Look the servers up while the audio device opens
+        for (const DestinationSpec& spec : config.servers) {
+            Resolver::instance().prefetch(spec.host);
+        }
+        
         // Create audio interface
-        auto audio = AudioInterface::create();
+        std::unique_ptr<AudioInterface> audio;
+        if (!config.input_file.empty()) {
+            FileSourceOptions file_options;
+            file_options.path = config.input_file;
+            file_options.realtime = !config.fast;
+            file_options.loop = config.loop;
+            audio = AudioInterface::create_file(file_options);
+        } else if (!config.synth.empty()) {
+            SyntheticOptions synth_options;
+            if (!SyntheticOptions::parse_signal(config.synth, synth_options.signal)) {
+                std::cerr << "❌ Invalid signal. Use 'sine', 'noise', 'chirp' or 'speech'\n";
+                return 1;
+            }
+            synth_options.frequency = config.synth_freq;
+            audio = AudioInterface::create_synthetic(synth_options);
+        } else {
+            audio = AudioInterface::create();
+        }
         if (!audio) {
             std::cerr << "❌ Failed to create audio interface\n";
             return 1;
@@ -133,15 +465,67 @@ int main(int argc, char* argv[]) {
             return 0;
         }
         
+        // RTP carries L16/L24 or Opus; there is no float payload format
+        size_t rtp_destinations = 0;
+        size_t udp_destinations = 0;
+        for (const DestinationSpec& spec : config.servers) {
+            rtp_destinations += spec.protocol == "rtp";
+            udp_destinations += spec.protocol == "udp";
+        }
+        bool rtp = rtp_destinations > 0;
+        if (rtp && config.raw) {
+            std::cerr << "❌ --raw cannot be combined with --protocol rtp\n";
+            return 1;
+        }
+        if (rtp && config.codec == Codec::PCM && rtp_destinations < config.servers.size()) {
+            // One encode serves everyone, and RTP's PCM is big-endian while the native framing's is not
+            std::cerr << "❌ PCM cannot go to RTP and tcp/udp destinations at once; use --codec opus\n";
+            return 1;
+        }
+        if (config.fec != FecScheme::None && (udp_destinations == 0 || config.raw)) {
+            std::cerr << "❌ FEC needs a udp destination with packet headers\n";
+            return 1;
+        }
+        if (udp_destinations + rtp_destinations > 0 && config.mtu < 576) {
+            std::cerr << "❌ MTU must be at least 576 bytes\n";
+            return 1;
+        }
+        if (rtp && config.codec == Codec::PCM && config.format == SampleFormat::F32) {
+            std::cout << "ℹ️  RTP has no f32 payload format; sending s16 (L16)\n";
+            config.format = SampleFormat::S16;
+        }
+        
         std::cout << "🎤 Audio Sender starting...\n";
-        std::cout << "📡 Server: " << config.server_addr << ":" << config.server_port << "\n";
-        std::cout << "🔗 Protocol: " << config.protocol << "\n";
+        for (const DestinationSpec& spec : config.servers) {
+            std::cout << "📡 Server: " << spec.to_string() << "\n";
+        }
         std::cout << "⚙️  Sample rate: " << config.sample_rate << "Hz, " << config.channels << " channels\n";
+        if (config.codec == Codec::Opus) {
+            std::cout << "🗜️  Codec: opus " << config.opus_bitrate / 1000 << " kbit/s, "
+                      << config.opus_frame_ms << " ms frames, complexity " << config.opus_complexity << "\n";
+        } else {
+            std::cout << "🎚️  Format: " << sample_format_name(config.format)
+                      << (config.dither ? " (dithered)" : "") << "\n";
+        }
+        
+        // Capture at the device's native rate when it is known; the pipeline resamples
+        int capture_rate = config.capture_rate;
+        if (capture_rate <= 0 && !config.device_name.empty()) {
+            for (const auto& device : audio->list_input_devices()) {
+                if (device.name.find(config.device_name) != std::string::npos && device.sample_rate > 0) {
+                    capture_rate = device.sample_rate;
+                    break;
+                }
+            }
+        }
+        if (capture_rate <= 0) {
+            capture_rate = config.sample_rate;
+        }
         
         // Configure audio
         AudioConfig audio_config;
         audio_config.device_name = config.device_name;
-        audio_config.sample_rate = config.sample_rate;
+        audio_config.sample_rate = capture_rate;
         audio_config.channels = config.channels;
         audio_config.buffer_size = config.buffer_size;
         
@@ -152,65 +536,319 @@ int main(int argc, char* argv[]) {
         
         std::cout << "🎯 Using device: " << audio->get_device_name() << "\n";
         
-        // Create network connection
-        std::unique_ptr<Network> network;
-        if (config.protocol == "tcp") {
-            network = std::make_unique<TCPNetwork>();
-        } else if (config.protocol == "udp") {
-            network = std::make_unique<UDPNetwork>();
-        } else {
-            std::cerr << "❌ Invalid protocol. Use 'tcp' or 'udp'\n";
+        // The device or file may have overridden the requested format
+        const AudioConfig& capture_config = audio->get_config();
+        capture_rate = capture_config.sample_rate;
+        config.channels = capture_config.channels;
+        if (capture_rate != config.sample_rate) {
+            std::cout << "🔁 Capturing at " << capture_rate << "Hz, resampling to " << config.sample_rate << "Hz\n";
+        }
+        
+        PipelineConfig pipeline_config;
+        pipeline_config.capture_rate = capture_rate;
+        pipeline_config.wire_rate = config.sample_rate;
+        pipeline_config.channels = config.channels;
+        pipeline_config.max_frames = config.buffer_size;
+        pipeline_config.codec.codec = config.codec;
+        pipeline_config.codec.format = config.format;
+        pipeline_config.codec.dither = config.dither;
+        pipeline_config.codec.bitrate = config.opus_bitrate;
+        pipeline_config.codec.complexity = config.opus_complexity;
+        pipeline_config.codec.frame_ms = config.opus_frame_ms;
+        pipeline_config.codec.big_endian = rtp;
+        pipeline_config.dtx = config.dtx;
+        pipeline_config.vad_hangover_ms = config.vad_hangover_ms;
+        pipeline_config.keepalive_ms = config.keepalive_ms;
+        
+        SendPipeline pipeline;
+        if (!pipeline.configure(pipeline_config)) {
+            std::cerr << "❌ Failed to configure send pipeline\n";
             return 1;
         }
         
-        if (!network->connect(config.server_addr, config.server_port)) {
-            std::cerr << "❌ Failed to connect to server\n";
+        // Every destination carries the same stream: one stream id, one encode
+        uint32_t stream_id = config.stream_id;
+        while (stream_id == 0) {
+            stream_id = std::random_device()();
+        }
+        
+        DestinationConfig destination_config;
+        destination_config.sample_rate = config.sample_rate;
+        destination_config.channels = config.channels;
+        destination_config.stream_id = stream_id;
+        destination_config.raw = config.raw;
+        destination_config.mtu = static_cast<size_t>(config.mtu);
+        destination_config.udp_send = config.udp_send;
+        
+        // The event loop keeps a stalled receiver from blocking the sender thread
+        if (config.io == "epoll" || config.io == "uring") {
+            if (!NetworkEngine::supported()) {
+                std::cerr << "❌ " << config.io << " I/O is only available on Linux\n";
+                return 1;
+            }
+            destination_config.event_loop = true;
+            destination_config.engine.backend = IoBackend::Epoll;
+            if (config.io == "uring") {
+                if (IoUring::available()) {
+                    destination_config.engine.backend = IoBackend::Uring;
+                } else {
+                    std::cout << "⚠️  io_uring is unavailable here (old kernel or seccomp); using epoll\n";
+                }
+            }
+            destination_config.engine.sample_rate = config.sample_rate;
+            destination_config.engine.queue_ms = config.net_queue_ms;
+            destination_config.engine.policy = config.overflow;
+            destination_config.engine.max_downgrade = pipeline.max_downgrade();
+            destination_config.engine.wait_when_full = !audio->is_realtime();
+            destination_config.bytes_per_second = pipeline.encoder().estimated_bytes(config.sample_rate);
+            std::cout << "🚦 I/O: " << io_backend_name(destination_config.engine.backend) << ", "
+                      << config.net_queue_ms << " ms send queue per destination, "
+                      << overflow_policy_name(config.overflow) << "\n";
+        } else if (config.io != "blocking") {
+            std::cerr << "❌ Invalid I/O mode. Use 'epoll', 'uring' or 'blocking'\n";
             return 1;
         }
         
-        std::cout << "🔗 Connection established\n";
+        // Outages are ridden out in the background, per destination; capture keeps running
+        destination_config.reconnect.enabled = config.reconnect;
+        destination_config.reconnect.sample_rate = config.sample_rate;
+        destination_config.reconnect.replay_ms = config.replay_ms;
+        destination_config.reconnect.policy = config.outage;
+        destination_config.reconnect.max_backoff = std::chrono::milliseconds(config.reconnect_max_ms);
+        
+        destination_config.fec = config.fec;
+        destination_config.fec_overhead = config.fec_overhead;
+        destination_config.fec_group = config.fec_group;
+        destination_config.rtp_payload_type = config.rtp_payload_type;
+        
+        // Receiver reports from the relay retune bitrate, frame size, FEC and DTX
+        if (config.codec == Codec::Opus) {
+            destination_config.rate.max_bitrate = config.opus_bitrate;
+            destination_config.rate.frame_ms = config.opus_frame_ms;
+        }
+        destination_config.rate.fec_overhead = config.fec_overhead;
+        destination_config.rate.dtx = config.dtx;
+        destination_config.rate.hangover_ms = config.vad_hangover_ms;
+        
+        std::vector<std::unique_ptr<Destination>> destinations;
+        for (const DestinationSpec& spec : config.servers) {
+            auto destination = std::make_unique<Destination>(spec, destination_config);
+            if (!destination->open(pipeline)) {
+                std::cerr << "❌ Failed to connect to " << spec.to_string() << "\n";
+                return 1;
+            }
+            if (destination->connection().connected()) {
+                std::cout << "🔗 Connection established to " << spec.to_string() << " ("
+                          << destination->network().remote_address() << ")\n";
+            } else {
+                std::cout << "🔌 " << spec.to_string() << " unreachable; retrying in the background\n";
+            }
+            destinations.push_back(std::move(destination));
+        }
+        
+        // Full send queues are paid for now rather than while streaming
+        uint64_t queued_frames = 0;
+        for (auto& destination : destinations) {
+            queued_frames += destination->queue_frames();
+        }
+        pipeline.reserve_payloads(queued_frames);
+        
+        // UDP payloads are split to fit the path MTU, each piece with its own header
+        pipeline.limit_payload(rtp_payload_limit(destinations));
+        for (auto& destination : destinations) {
+            if (!destination->configure_framing(pipeline)) {
+                std::cerr << "❌ MTU too small for the codec payload (" << destination->spec().to_string() << ")\n";
+                return 1;
+            }
+        }
+        
+        // Every packet gets a header unless the receiver expects bare samples
+        bool sdp_written = false;
+        for (auto& destination : destinations) {
+            const std::string name = destinations.size() > 1 ? destination->spec().to_string() + ": " : "";
+            if (destination->rtp()) {
+                const RtpFormat& format = destination->rtp_format();
+                std::cout << "🏷️  " << name << "SSRC " << stream_id << " (" << format.encoding_name << "/"
+                          << format.clock_rate << ", payload type " << int(format.payload_type) << ")\n";
+                
+                std::string sdp = format.sdp(destination->spec().host, destination->spec().port, stream_id);
+                std::cout << "📄 SDP:\n" << sdp;
+                if (!config.sdp_file.empty() && !sdp_written) {
+                    std::ofstream file(config.sdp_file, std::ios::binary);
+                    if (!(file << sdp)) {
+                        std::cerr << "❌ Failed to write " << config.sdp_file << "\n";
+                        return 1;
+                    }
+                    sdp_written = true;
+                    std::cout << "📄 Session description written to " << config.sdp_file << "\n";
+                }
+            } else if (!config.raw) {
+                std::cout << "🏷️  " << name << "Stream ID " << stream_id << " ("
+                          << payload_encoding_name(destination->header().encoding) << " framing v"
+                          << int(PacketHeader::kVersion) << ")\n";
+            }
+            
+            size_t message_limit = destination->network().max_message_size();
+            if (message_limit > 0) {
+                std::cout << "📏 " << name << "Datagrams up to " << message_limit << " bytes, "
+                          << destination->packetizer().max_chunk() << " payload bytes each\n";
+            }
+            if (auto* udp = dynamic_cast<UDPNetwork*>(&destination->network())) {
+                std::cout << "📦 " << name << "UDP send mode " << UDPNetwork::send_mode_name(udp->send_mode()) << "\n";
+            }
+            if (destination->fec_enabled()) {
+                const FecEncoder& fec = destination->fec();
+                std::cout << "🛡️  " << name << "FEC " << fec_scheme_name(config.fec) << ", " << int(fec.repairs())
+                          << (fec.repairs() == 1 ? " repair" : " repairs") << " per " << int(fec.sources())
+                          << " datagrams (" << FecEncoder::kernel_name() << ")\n";
+            }
+        }
         
         // Set up signal handling
         std::signal(SIGINT, signal_handler);
         
-        // Start audio capture
-        audio->start_capture([&network](const std::vector<float>& audio_data) {
-            if (running) {
-                // Convert float to bytes (little-endian)
-                std::vector<uint8_t> byte_data;
-                byte_data.reserve(audio_data.size() * sizeof(float));
+        // Capture thread only copies into the ring; the sender thread does the I/O
+        size_t frame_samples = static_cast<size_t>(config.buffer_size) * config.channels;
+        FrameRingBuffer ring(FrameRingBuffer::frames_for_depth(config.queue_ms, capture_rate,
+                                                               config.channels, frame_samples),
+                             frame_samples);
+        
+        std::thread sender([&destinations, &ring, &pipeline, &config]() {
+            int downgrade = 0;
+            uint64_t suppressed = 0;
+            bool labelled = destinations.size() > 1;
+            
+            while (running) {
+                const FrameRingBuffer::Frame* frame = ring.wait_front(std::chrono::milliseconds(config.queue_ms));
+                if (!frame) continue;
                 
-                for (float sample : audio_data) {
-                    auto bytes = reinterpret_cast<const uint8_t*>(&sample);
-                    for (size_t i = 0; i < sizeof(float); i++) {
-                        byte_data.push_back(bytes[i]);
-                    }
+                // Follow the deepest congestion level any send queue asks for
+                int level = 0;
+                for (auto& destination : destinations) {
+                    level = std::max(level, destination->downgrade_level());
+                }
+                if (level != downgrade) {
+                    downgrade = level;
+                    pipeline.set_downgrade(downgrade);
                 }
                 
-                network->send(byte_data);
+                size_t count = pipeline.process(*frame);
+                ring.pop();
+                
+                // Encoded once; every destination queues references to the same payloads
+                bool silence_started = count == 0 && pipeline.stats().frames_suppressed != suppressed;
+                suppressed = pipeline.stats().frames_suppressed;
+                for (auto& destination : destinations) {
+                    destination->send(pipeline, count, silence_started);
+                }
+                pipeline.limit_payload(rtp_payload_limit(destinations));
+                
+                bool changed = false;
+                for (auto& destination : destinations) {
+                    if (destination->poll(config.adapt)) {
+                        changed = true;
+                        print_adaptation(labelled ? destination->spec().to_string() : "", destination->last_report(),
+                                         destination->controller().decision(), destination->controller().congested());
+                    }
+                }
+                if (changed) {
+                    apply_rate_decisions(pipeline, destinations);
+                }
+            }
+        });
+        
+        // Offline sources wait for room instead of overrunning the ring
+        bool realtime = audio->is_realtime();
+        audio->start_capture([&ring, realtime](const AudioBlock& block) {
+            while (!realtime && running && !ring.has_room(block)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            if (running) {
+                ring.push(block);
             }
         });
         
         std::cout << "🎙️  Recording started! Press Ctrl+C to stop.\n";
+        std::cout << "🧺 Queue: " << ring.capacity() << " frames (" << config.queue_ms << " ms)\n";
         
-        // Keep running until signal
-        int packet_count = 0;
+        // Keep running until signal, or until a finite source has been sent
+        auto started = std::chrono::steady_clock::now();
+        int tick_count = 0;
         while (running) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            packet_count++;
+            tick_count++;
             
-            if (packet_count % 100 == 0) {
-                std::cout << "📡 Audio streaming... (packets: " << packet_count << ")\n";
+            if (audio->is_finished() && ring.size() == 0) {
+                running = false;
+                break;
+            }
+            
+            if (tick_count % 100 == 0) {
+                uint64_t packets = 0;
+                uint64_t send_queue_ms = 0;
+                size_t reconnecting = 0;
+                for (auto& destination : destinations) {
+                    packets += destination->network().stats().messages;
+                    if (destination->engine()) {
+                        send_queue_ms = std::max(send_queue_ms, destination->engine()->queued_ms());
+                    }
+                    reconnecting += !destination->connection().connected();
+                }
+                std::cout << "📡 Audio streaming... (packets: " << packets
+                         << ", queued: " << ring.size()
+                         << ", send queue: " << send_queue_ms << " ms"
+                         << (reconnecting > 0 ? ", reconnecting " + std::to_string(reconnecting) : "")
+                         << ", overruns: " << ring.overruns()
+                         << ", underruns: " << ring.underruns() << ")\n";
+                if (config.dtx) {
+                    print_dtx_stats(pipeline.stats());
+                }
             }
         }
         
         // Cleanup
         audio->stop_capture();
-        network->disconnect();
+        sender.join();
+        for (auto& destination : destinations) {
+            destination->close(std::chrono::milliseconds(config.net_queue_ms));
+        }
         Network::cleanup();
         
-        std::cout << "✅ Audio sender stopped.\n";
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        for (auto& destination : destinations) {
+            if (destinations.size() > 1) {
+                std::cout << "📡 " << destination->spec().to_string() << ":\n";
+            }
+            print_network_stats(destination->network().stats(), elapsed);
+            if (destination->engine()) {
+                print_engine_stats(*destination->engine(), config.sample_rate);
+            }
+            if (destination->connection().stats().outages > 0) {
+                print_connection_stats(destination->connection().stats());
+            }
+            if (destination->fec_enabled()) {
+                std::cout << "🛡️  FEC: " << destination->fec().repairs_sent() << " repair datagrams\n";
+            }
+            if (destination->dropped() > 0) {
+                std::cout << "✂️  " << destination->dropped() << " packets dropped while they did not fit the MTU\n";
+            }
+            if (destination->feedback().stats().reports > 0) {
+                print_feedback_stats(destination->feedback().stats());
+            }
+            if (destination->rtcp()) {
+                print_rtcp_stats(destination->rtcp()->stats());
+            }
+        }
+        if (destinations.size() > 1) {
+            std::cout << "♻️  Shared payload buffers: " << pipeline.payload_blocks() << " allocated for "
+                      << destinations.size() << " destinations\n";
+        }
+        if (config.dtx) {
+            print_dtx_stats(pipeline.stats());
+        }
         
+        std::cout << "✅ Audio sender stopped.\n";
+    
     } catch (const std::exception& e) {
         std::cerr << "❌ Error: " << e.what() << std::endl;
         return 1;
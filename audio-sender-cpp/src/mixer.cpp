@@ -0,0 +1,470 @@
+#include "mixer.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIXER_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MIXER_AVX2 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIXER_NEON 1
+#endif
+
+namespace {
+
+// Input is decoded and converted this many frames at a time
+constexpr size_t kChunkFrames = 1024;
+
+// A stream that sends nothing for this long leaves the mix
+constexpr int kStreamTimeoutMs = 2000;
+
+// A timestamp this far from the expected one restarts the stream instead of leaving a gap
+constexpr int kMaxGapMs = 1000;
+
+inline int16_t saturate_i16(int32_t value) {
+    return static_cast<int16_t>(std::min<int32_t>(32767, std::max<int32_t>(-32768, value)));
+}
+
+using Accumulate = size_t (*)(int32_t* acc, const int16_t* in, size_t count);
+using Subtract = size_t (*)(const int32_t* acc, const int16_t* own, int16_t* out, size_t count);
+
+// SIMD kernels handle whole vectors and return how many samples they did
+
+#ifdef MIXER_SSE2
+// Sign-extends the halves of eight int16 to two vectors of int32
+inline void widen_sse2(__m128i v, __m128i& low, __m128i& high) {
+    low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+size_t accumulate_sse2(int32_t* acc, const int16_t* in, size_t count) {
+    size_t done = count / 8 * 8;
+    for (size_t i = 0; i < done; i += 8) {
+        __m128i low, high;
+        widen_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), low, high);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), low));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), high));
+    }
+    return done;
+}
+
+size_t subtract_sse2(const int32_t* acc, const int16_t* own, int16_t* out, size_t count) {
+    size_t done = count / 8 * 8;
+    for (size_t i = 0; i < done; i += 8) {
+        __m128i low, high;
+        widen_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(own + i)), low, high);
+        const __m128i* a = reinterpret_cast<const __m128i*>(acc + i);
+        low = _mm_sub_epi32(_mm_loadu_si128(a), low);
+        high = _mm_sub_epi32(_mm_loadu_si128(a + 1), high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(low, high));
+    }
+    return done;
+}
+#endif
+
+#ifdef MIXER_AVX2
+__attribute__((target("avx2")))
+size_t accumulate_avx2(int32_t* acc, const int16_t* in, size_t count) {
+    size_t done = count / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        __m256i low = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8)));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), low));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), high));
+    }
+    return done;
+}
+
+__attribute__((target("avx2")))
+size_t subtract_avx2(const int32_t* acc, const int16_t* own, int16_t* out, size_t count) {
+    size_t done = count / 16 * 16;
+    for (size_t i = 0; i < done; i += 16) {
+        __m256i low = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(own + i)));
+        __m256i high = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(own + i + 8)));
+        const __m256i* a = reinterpret_cast<const __m256i*>(acc + i);
+        low = _mm256_sub_epi32(_mm256_loadu_si256(a), low);
+        high = _mm256_sub_epi32(_mm256_loadu_si256(a + 1), high);
+        // packs works within 128-bit lanes; put the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    return done;
+}
+#endif
+
+#ifdef MIXER_NEON
+size_t accumulate_neon(int32_t* acc, const int16_t* in, size_t count) {
+    size_t done = count / 8 * 8;
+    for (size_t i = 0; i < done; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vget_low_s16(v)));
+        vst1q_s32(acc + i + 4, vaddw_s16(vld1q_s32(acc + i + 4), vget_high_s16(v)));
+    }
+    return done;
+}
+
+size_t subtract_neon(const int32_t* acc, const int16_t* own, int16_t* out, size_t count) {
+    size_t done = count / 8 * 8;
+    for (size_t i = 0; i < done; i += 8) {
+        int16x8_t v = vld1q_s16(own + i);
+        int32x4_t low = vsubw_s16(vld1q_s32(acc + i), vget_low_s16(v));
+        int32x4_t high = vsubw_s16(vld1q_s32(acc + i + 4), vget_high_s16(v));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+    return done;
+}
+#endif
+
+struct Kernels {
+    Accumulate accumulate = nullptr;
+    Subtract subtract = nullptr;
+    const char* name = "scalar";
+};
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+        Kernels k;
+#ifdef MIXER_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            k.accumulate = accumulate_avx2;
+            k.subtract = subtract_avx2;
+            k.name = "avx2";
+            return k;
+        }
+#endif
+#ifdef MIXER_SSE2
+        k.accumulate = accumulate_sse2;
+        k.subtract = subtract_sse2;
+        k.name = "sse2";
+#endif
+#ifdef MIXER_NEON
+        k.accumulate = accumulate_neon;
+        k.subtract = subtract_neon;
+        k.name = "neon";
+#endif
+        return k;
+    }();
+    return selected;
+}
+
+inline size_t pcm_sample_bytes(PayloadEncoding encoding) {
+    return encoding == PayloadEncoding::F32 ? 4 : encoding == PayloadEncoding::S16 ? 2 : 3;
+}
+
+// Little-endian PCM to float, one input frame at a time; out gets out_channels
+// per frame. Mono output averages the input channels, more channels reuse
+// input channels in turn.
+void decode_pcm(PayloadEncoding encoding, const uint8_t* in, size_t frames, size_t in_channels,
+                size_t out_channels, float* out) {
+    size_t sample_bytes = pcm_sample_bytes(encoding);
+    float frame[256];
+    for (size_t f = 0; f < frames; f++) {
+        for (size_t c = 0; c < in_channels; c++) {
+            const uint8_t* p = in + (f * in_channels + c) * sample_bytes;
+            if (encoding == PayloadEncoding::F32) {
+                std::memcpy(&frame[c], p, sizeof(float));
+            } else if (encoding == PayloadEncoding::S16) {
+                frame[c] = static_cast<float>(static_cast<int16_t>(p[0] | (p[1] << 8))) / 32768.0f;
+            } else {
+                int32_t v = static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16 |
+                                                 static_cast<uint32_t>(p[2]) << 24) >> 8;
+                frame[c] = static_cast<float>(v) / 8388608.0f;
+            }
+        }
+        
+        if (out_channels == 1 && in_channels > 1) {
+            float sum = 0.0f;
+            for (size_t c = 0; c < in_channels; c++) {
+                sum += frame[c];
+            }
+            out[f] = sum / static_cast<float>(in_channels);
+        } else {
+            for (size_t c = 0; c < out_channels; c++) {
+                out[f * out_channels + c] = frame[c % in_channels];
+            }
+        }
+    }
+}
+
+// S16 samples as little-endian wire bytes
+void store_s16(const int16_t* samples, size_t count, uint8_t* out) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < count; i++) {
+        auto v = static_cast<uint16_t>(samples[i]);
+        out[i * 2] = static_cast<uint8_t>(v);
+        out[i * 2 + 1] = static_cast<uint8_t>(v >> 8);
+    }
+#else
+    std::memcpy(out, samples, count * sizeof(int16_t));
+#endif
+}
+
+} // namespace
+
+Mixer::Mixer(const MixerConfig& config) : config_(config), converter_(SampleFormat::S16) {
+    config_.channels = std::max(1, std::min(config_.channels, 8));
+    frame_frames_ = static_cast<size_t>(std::max(1, config_.sample_rate * config_.frame_ms / 1000));
+    delay_frames_ = static_cast<size_t>(std::max(0, config_.sample_rate * config_.delay_ms / 1000));
+    
+    // Room for the delay, a frame in flight and a burst as long as the delay
+    ring_frames_ = 1;
+    while (ring_frames_ < 2 * delay_frames_ + 2 * frame_frames_) {
+        ring_frames_ *= 2;
+    }
+    
+    // The SampleConverter writes little-endian bytes; on a big-endian host that is the reverse
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    converter_.set_big_endian(true);
+#endif
+    
+    accumulator_.resize(frame_samples());
+    mix_.resize(frame_samples());
+    silence_.resize(frame_samples());
+    decoded_.resize(kChunkFrames * static_cast<size_t>(config_.channels));
+    samples_.resize(decoded_.size());
+}
+
+bool Mixer::push(uint64_t participant, const PacketHeader& header, const uint8_t* payload) {
+    // Repair, reports, keepalives and fragments carry no whole frame of audio
+    if ((header.flags & (PacketHeader::kFlagComfortNoise | PacketHeader::kFlagFec | PacketHeader::kFlagReport)) ||
+        header.fragment_count > 1) {
+        return false;
+    }
+    if (header.encoding != PayloadEncoding::F32 && header.encoding != PayloadEncoding::S16 &&
+        header.encoding != PayloadEncoding::S24) {
+        stats_.unmixable++;
+        return false;
+    }
+    if (header.channels == 0 || header.sample_rate < 8000 || header.sample_rate > 384000) return false;
+    
+    size_t frames = header.payload_length / (pcm_sample_bytes(header.encoding) * header.channels);
+    
+    auto found = streams_.find(participant);
+    bool fresh = found == streams_.end();
+    Stream& stream = fresh ? streams_[participant] : found->second;
+    if (fresh || stream.stream_id != header.stream_id || stream.sample_rate != header.sample_rate ||
+        stream.channels != header.channels || stream.encoding != header.encoding) {
+        restart(stream, header);
+        if (stream.sample_rate == 0) {
+            streams_.erase(participant);
+            return false;
+        }
+    } else if (header.timestamp != stream.next_timestamp) {
+        // Late audio fills its gap if it can; a gap is left silent until then
+        int64_t gap = static_cast<int64_t>(header.timestamp - stream.next_timestamp);
+        int64_t max_gap = static_cast<int64_t>(header.sample_rate) * kMaxGapMs / 1000;
+        if (gap < 0 && gap > -max_gap) {
+            stats_.late++;
+            if (fill_gap(stream, header, payload, frames)) {
+                stats_.filled++;
+            }
+            return true;
+        }
+        if (gap < 0 || gap > max_gap) {
+            restart(stream, header);
+        } else {
+            stream.write_position += static_cast<uint64_t>(gap) * static_cast<uint64_t>(config_.sample_rate) /
+                                     header.sample_rate;
+            stream.resampler.reset();
+        }
+    }
+    
+    // Behind the mix or so far ahead the ring would wrap: back to the nominal delay
+    if (stream.write_position < position_ || stream.write_position + frames * static_cast<size_t>(config_.sample_rate) /
+                                                 header.sample_rate > position_ + ring_frames_ - frame_frames_) {
+        stream.write_position = position_ + delay_frames_;
+        stream.started = stream.write_position;
+        stream.resampler.reset();
+        stats_.slips++;
+    }
+    stream.next_timestamp = header.timestamp + frames;
+    stream.last_push = position_;
+    stats_.packets++;
+    place(stream, stream.resampler, header, payload, frames);
+    return true;
+}
+
+bool Mixer::fill_gap(Stream& stream, const PacketHeader& header, const uint8_t* payload, size_t frames) {
+    // Where the packet's audio goes: as far behind the write position as it is behind next_timestamp
+    uint64_t rate = static_cast<uint64_t>(config_.sample_rate);
+    uint64_t behind = (stream.next_timestamp - header.timestamp) * rate / header.sample_rate;
+    uint64_t length = static_cast<uint64_t>(frames) * rate / header.sample_rate;
+    if (behind > stream.write_position || behind < length) return false;
+    uint64_t position = stream.write_position - behind;
+    if (position < position_ || position < stream.started) return false;
+    
+    // Written where it belongs through a fresh filter, as after a gap; a
+    // duplicate only rewrites the same samples
+    uint64_t write_position = stream.write_position;
+    stream.write_position = position;
+    stream.backfill.reset();
+    place(stream, stream.backfill, header, payload, frames);
+    stream.write_position = write_position;
+    stream.last_push = position_;
+    return true;
+}
+
+void Mixer::place(Stream& stream, Resampler& resampler, const PacketHeader& header, const uint8_t* payload,
+                  size_t frames) {
+    size_t frame_size = pcm_sample_bytes(header.encoding) * header.channels;
+    size_t channels = static_cast<size_t>(config_.channels);
+    for (size_t done = 0; done < frames;) {
+        size_t chunk = std::min(kChunkFrames, frames - done);
+        decode_pcm(header.encoding, payload + done * frame_size, chunk, header.channels, channels, decoded_.data());
+        done += chunk;
+        
+        const float* audio = decoded_.data();
+        size_t out_frames = chunk;
+        if (!resampler.is_passthrough()) {
+            out_frames = resampler.process(decoded_.data(), chunk, resampled_.data());
+            audio = resampled_.data();
+        }
+        converter_.convert(audio, out_frames * channels, reinterpret_cast<uint8_t*>(samples_.data()));
+        write(stream, samples_.data(), out_frames);
+    }
+}
+
+void Mixer::restart(Stream& stream, const PacketHeader& header) {
+    stream.stream_id = header.stream_id;
+    stream.sample_rate = header.sample_rate;
+    stream.channels = header.channels;
+    stream.encoding = header.encoding;
+    if (!stream.resampler.configure(static_cast<int>(header.sample_rate), config_.sample_rate, config_.channels,
+                                    kChunkFrames) ||
+        !stream.backfill.configure(static_cast<int>(header.sample_rate), config_.sample_rate, config_.channels,
+                                   kChunkFrames)) {
+        stream.sample_rate = 0;
+        return;
+    }
+    
+    // Scratch for the largest chunk this stream's ratio can produce
+    size_t most = stream.resampler.max_output_frames(kChunkFrames) * static_cast<size_t>(config_.channels);
+    if (most > resampled_.size()) {
+        resampled_.resize(most);
+        samples_.resize(most);
+    }
+    
+    stream.write_position = position_ + delay_frames_;
+    stream.started = stream.write_position;
+    if (stream.ring.empty()) {
+        stream.ring.assign(ring_frames_ * static_cast<size_t>(config_.channels), 0);
+        stream.frame.assign(frame_samples(), 0);
+    }
+}
+
+void Mixer::write(Stream& stream, const int16_t* samples, size_t frames) {
+    size_t channels = static_cast<size_t>(config_.channels);
+    while (frames > 0) {
+        size_t slot = static_cast<size_t>(stream.write_position & (ring_frames_ - 1));
+        size_t run = std::min(frames, ring_frames_ - slot);
+        std::memcpy(stream.ring.data() + slot * channels, samples, run * channels * sizeof(int16_t));
+        samples += run * channels;
+        frames -= run;
+        stream.write_position += run;
+    }
+}
+
+size_t Mixer::mix() {
+    std::fill(accumulator_.begin(), accumulator_.end(), 0);
+    size_t channels = static_cast<size_t>(config_.channels);
+    uint64_t end = position_ + frame_frames_;
+    uint64_t timeout = static_cast<uint64_t>(config_.sample_rate) * kStreamTimeoutMs / 1000;
+    
+    size_t heard = 0;
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        Stream& stream = it->second;
+        if (position_ > stream.last_push + timeout) {
+            it = streams_.erase(it);
+            continue;
+        }
+        
+        // Audio that reaches into this frame; the slots are cleared for the next lap
+        stream.in_mix = stream.write_position > position_ && stream.started < end;
+        if (stream.in_mix) {
+            size_t slot = static_cast<size_t>(position_ & (ring_frames_ - 1));
+            size_t first = std::min(frame_frames_, ring_frames_ - slot);
+            int16_t* ring = stream.ring.data();
+            std::memcpy(stream.frame.data(), ring + slot * channels, first * channels * sizeof(int16_t));
+            std::memset(ring + slot * channels, 0, first * channels * sizeof(int16_t));
+            if (first < frame_frames_) {
+                size_t rest = (frame_frames_ - first) * channels;
+                std::memcpy(stream.frame.data() + first * channels, ring, rest * sizeof(int16_t));
+                std::memset(ring, 0, rest * sizeof(int16_t));
+            }
+            accumulate(accumulator_.data(), stream.frame.data(), frame_samples());
+            heard++;
+        }
+        ++it;
+    }
+    
+    subtract(accumulator_.data(), silence_.data(), mix_.data(), frame_samples());
+    position_ = end;
+    if (heard > 0) {
+        stats_.frames++;
+    }
+    return heard;
+}
+
+bool Mixer::contributed(uint64_t participant) const {
+    auto found = streams_.find(participant);
+    return found != streams_.end() && found->second.in_mix;
+}
+
+void Mixer::write_mix(uint8_t* out) const {
+    store_s16(mix_.data(), frame_samples(), out);
+}
+
+void Mixer::write_mix_minus(uint64_t participant, uint8_t* out) const {
+    auto found = streams_.find(participant);
+    if (found == streams_.end() || !found->second.in_mix) {
+        write_mix(out);
+        return;
+    }
+    
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::vector<int16_t> samples(frame_samples());
+    subtract(accumulator_.data(), found->second.frame.data(), samples.data(), frame_samples());
+    store_s16(samples.data(), frame_samples(), out);
+#else
+    subtract(accumulator_.data(), found->second.frame.data(), reinterpret_cast<int16_t*>(out), frame_samples());
+#endif
+}
+
+void Mixer::remove(uint64_t participant) {
+    streams_.erase(participant);
+}
+
+void Mixer::accumulate(int32_t* acc, const int16_t* in, size_t count) {
+    size_t done = kernels().accumulate ? kernels().accumulate(acc, in, count) : 0;
+    accumulate_scalar(acc + done, in + done, count - done);
+}
+
+void Mixer::subtract(const int32_t* acc, const int16_t* own, int16_t* out, size_t count) {
+    size_t done = kernels().subtract ? kernels().subtract(acc, own, out, count) : 0;
+    subtract_scalar(acc + done, own + done, out + done, count - done);
+}
+
+void Mixer::accumulate_scalar(int32_t* acc, const int16_t* in, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        acc[i] += in[i];
+    }
+}
+
+void Mixer::subtract_scalar(const int32_t* acc, const int16_t* own, int16_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = saturate_i16(acc[i] - own[i]);
+    }
+}
+
+const char* Mixer::kernel_name() {
+    return kernels().name;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "packet.h"
+#include "resampler.h"
+#include "sample_format.h"
+
+struct MixerConfig {
+    int sample_rate = 16000;
+    int channels = 1;
+    int frame_ms = 20;          // audio per mix() call
+    int delay_ms = 60;          // streams are mixed this far behind their first packet, for jitter
+};
+
+struct MixerStats {
+    uint64_t frames = 0;        // mix() calls that had audio
+    uint64_t packets = 0;       // packets placed on the timeline
+    uint64_t late = 0;          // packets older than what a stream already had
+    uint64_t filled = 0;        // of those, packets that filled their gap before it was mixed
+    uint64_t slips = 0;         // streams moved back to delay_ms after running dry or too far ahead
+    uint64_t unmixable = 0;     // packets of encodings the mixer cannot decode (Opus)
+};
+
+// Mix-minus mixer: every participant hears everyone but themselves. PCM
+// packets are decoded, converted to the mix rate and channel count, and
+// placed on a common timeline by their timestamps; each stream starts
+// delay_ms behind the mix so late packets still make it. A packet that
+// arrives after later ones (reordered, or rebuilt by FEC) fills the gap it
+// left if the mix has not reached it yet. mix() sums every
+// stream's next frame once into 32-bit accumulators, and each participant's
+// output is that sum minus their own frame, saturated to 16 bits, so the
+// cost grows with the number of streams rather than with its square.
+// Output is S16 little-endian at the mix rate. Not thread-safe.
+class Mixer {
+public:
+    explicit Mixer(const MixerConfig& config);
+    
+    Mixer(const Mixer&) = delete;
+    Mixer& operator=(const Mixer&) = delete;
+    
+    // Samples (all channels) and wire bytes of one mixed frame
+    size_t frame_samples() const { return frame_frames_ * static_cast<size_t>(config_.channels); }
+    size_t frame_bytes() const { return frame_samples() * sizeof(int16_t); }
+    
+    // Places a packet of participant's audio; false if it cannot be mixed
+    bool push(uint64_t participant, const PacketHeader& header, const uint8_t* payload);
+    
+    // Mixes the next frame and drops streams that have gone quiet; returns
+    // how many streams had audio in it
+    size_t mix();
+    
+    // After mix(): whether participant was heard in this frame, so needs
+    // an output of its own, and the outputs, frame_bytes() each
+    bool contributed(uint64_t participant) const;
+    void write_mix(uint8_t* out) const;
+    void write_mix_minus(uint64_t participant, uint8_t* out) const;
+    
+    void remove(uint64_t participant);
+    
+    // Timeline position of the frame the last mix() produced, in frames at the mix rate
+    uint64_t timestamp() const { return position_ - frame_frames_; }
+    
+    const MixerConfig& config() const { return config_; }
+    const MixerStats& stats() const { return stats_; }
+    
+    // Kernels: acc += in, and out = saturate(acc - own); the SIMD versions
+    // and the scalar reference give identical results
+    static void accumulate(int32_t* acc, const int16_t* in, size_t count);
+    static void subtract(const int32_t* acc, const int16_t* own, int16_t* out, size_t count);
+    static void accumulate_scalar(int32_t* acc, const int16_t* in, size_t count);
+    static void subtract_scalar(const int32_t* acc, const int16_t* own, int16_t* out, size_t count);
+    
+    // Name of the kernel accumulate() and subtract() dispatch to on this CPU
+    static const char* kernel_name();
+
+private:
+    struct Stream {
+        // Input format; a change restarts the stream
+        uint32_t stream_id = 0;
+        uint32_t sample_rate = 0;
+        uint8_t channels = 0;
+        PayloadEncoding encoding = PayloadEncoding::F32;
+        Resampler resampler;
+        Resampler backfill;                 // for late packets, so the stream's filter state is kept
+        
+        // Input timestamp expected next, and where its audio goes on the timeline
+        uint64_t next_timestamp = 0;
+        uint64_t write_position = 0;
+        uint64_t started = 0;               // timeline position of the first sample since (re)starting
+        uint64_t last_push = 0;             // mix position when the last packet came
+        
+        // Timeline audio ahead of the mix; slots are cleared once mixed
+        std::vector<int16_t> ring;
+        
+        // This stream's audio in the last mix, for subtracting
+        std::vector<int16_t> frame;
+        bool in_mix = false;
+    };
+    
+    void restart(Stream& stream, const PacketHeader& header);
+    bool fill_gap(Stream& stream, const PacketHeader& header, const uint8_t* payload, size_t frames);
+    void place(Stream& stream, Resampler& resampler, const PacketHeader& header, const uint8_t* payload,
+               size_t frames);
+    void write(Stream& stream, const int16_t* samples, size_t frames);
+    
+    MixerConfig config_;
+    MixerStats stats_;
+    size_t frame_frames_;
+    size_t delay_frames_;
+    size_t ring_frames_;                    // power of two, past the delay plus a frame
+    
+    std::unordered_map<uint64_t, Stream> streams_;
+    uint64_t position_ = 0;                 // timeline position of the next frame to mix
+    
+    std::vector<int32_t> accumulator_;
+    std::vector<int16_t> mix_;              // accumulator_ saturated
+    std::vector<int16_t> silence_;
+    
+    // Decoding scratch
+    std::vector<float> decoded_;
+    std::vector<float> resampled_;
+    std::vector<int16_t> samples_;
+    SampleConverter converter_;
+};
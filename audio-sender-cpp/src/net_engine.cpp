@@ -0,0 +1,844 @@
+#include "net_engine.h"
+#include "uring.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Downgrade hysteresis: step down fast when the queue backs up, recover slowly
+constexpr double kDowngradeFill = 0.5;
+constexpr double kRecoverFill = 0.1;
+constexpr auto kDowngradeInterval = std::chrono::milliseconds(250);
+constexpr auto kRecoverInterval = std::chrono::seconds(3);
+
+// Smallest message we budget slots for (a DTX keepalive)
+constexpr uint64_t kMinMessageFrames = 16;
+
+// Room reserved for each slot's copied headers (RTP, packet and fragment
+// headers are well under this), so queuing a message does not allocate
+constexpr size_t kSlotHeadBytes = 64;
+
+// io_uring: room for a full batch of sends, the wake-up and error watches,
+// and a cancel for each at shutdown
+constexpr unsigned kUringEntries = 256;
+
+// Zero-copy costs page pinning and a second completion; it pays off from
+// about 10 KB per send, so only large stream writes use it
+constexpr size_t kZeroCopyBytes = 16384;
+constexpr size_t kMaxPinnedSends = 8;
+
+// io_uring user data: small values tag control requests, sends carry
+// their batch generation above the index within the batch
+constexpr uint64_t kWakeRequest = 1;
+constexpr uint64_t kErrorRequest = 2;
+constexpr uint64_t kCancelRequest = 3;
+constexpr unsigned kGenerationShift = 8;
+
+uint64_t send_request(uint64_t generation, size_t index) {
+    return (generation << kGenerationShift) | index;
+}
+
+bool is_send_request(uint64_t user_data) {
+    return (user_data >> kGenerationShift) != 0;
+}
+
+} // namespace
+
+#ifdef __linux__
+// One batch of sends in flight at a time, like one send_some() call. The
+// network builds the msghdrs (a stream gets one write over every message,
+// datagrams their GSO runs); they go as linked SENDMSGs so they leave in order.
+struct NetworkEngine::Uring {
+    IoUring ring;
+    int fd = -1;
+    bool stream = false;
+    
+    uint64_t wake_value = 0;
+    bool wake_armed = false;
+    bool error_armed = false;
+    size_t outstanding = 0;     // completions still due, zero-copy notifications aside
+    bool unaccounted = false;   // sends prepared since the last enter()
+    
+    uint64_t generation = 0;
+    size_t count = 0;           // messages in the batch
+    size_t requests = 0;        // sends submitted for them
+    size_t completed = 0;
+    size_t offset = 0;
+    bool zerocopy = false;
+    MessageView batch[Network::kMaxSendSome];
+    size_t slots[Network::kMaxSendSome];
+    struct msghdr* headers[Network::kMaxSendSome];
+    size_t covers[Network::kMaxSendSome];       // messages each send carries
+    int32_t results[Network::kMaxSendSome];
+    
+    // Zero-copy sends whose notification has not arrived
+    struct Pinned {
+        uint64_t generation;
+        size_t count;
+        size_t slots[Network::kMaxSendSome];
+    };
+    Pinned pinned[kMaxPinnedSends];
+    size_t pinned_count = 0;
+};
+#else
+struct NetworkEngine::Uring {
+};
+#endif
+
+bool parse_overflow_policy(const std::string& name, OverflowPolicy& policy) {
+    if (name == "drop-oldest") {
+        policy = OverflowPolicy::DropOldest;
+    } else if (name == "drop-newest") {
+        policy = OverflowPolicy::DropNewest;
+    } else if (name == "downgrade") {
+        policy = OverflowPolicy::Downgrade;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* overflow_policy_name(OverflowPolicy policy) {
+    switch (policy) {
+    case OverflowPolicy::DropOldest: return "drop-oldest";
+    case OverflowPolicy::DropNewest: return "drop-newest";
+    case OverflowPolicy::Downgrade: return "downgrade";
+    }
+    return "unknown";
+}
+
+const char* io_backend_name(IoBackend backend) {
+    switch (backend) {
+    case IoBackend::Epoll: return "epoll";
+    case IoBackend::Uring: return "io_uring";
+    }
+    return "unknown";
+}
+
+ConstBuffer copy_message_head(const ConstBuffer* parts, size_t count, const SharedBuffer& payload,
+                              std::vector<uint8_t>& head) {
+    ConstBuffer body{nullptr, 0};
+    if (count > 0 && payload.contains(parts[count - 1].data, parts[count - 1].size)) {
+        body = parts[--count];
+    }
+    
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += parts[i].size;
+    }
+    head.resize(total);
+    uint8_t* out = head.data();
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(out, parts[i].data, parts[i].size);
+        out += parts[i].size;
+    }
+    return body;
+}
+
+bool NetworkEngine::supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+NetworkEngine::NetworkEngine(Network& network, const EngineConfig& config)
+    : network_(network), config_(config) {
+    limit_frames_ = static_cast<uint64_t>(config.queue_ms) * config.sample_rate / 1000;
+    
+    size_t capacity = static_cast<size_t>(std::max<uint64_t>(64, limit_frames_ / kMinMessageFrames + 1));
+    slots_.resize(capacity);
+    for (auto& slot : slots_) {
+        slot.bytes.reserve(kSlotHeadBytes);
+    }
+    order_.resize(capacity);
+    free_.reserve(capacity);
+    for (size_t i = capacity; i > 0; i--) {
+        free_.push_back(i - 1);
+    }
+    last_level_change_ = std::chrono::steady_clock::now();
+}
+
+NetworkEngine::~NetworkEngine() {
+    stop();
+}
+
+bool NetworkEngine::start() {
+#ifdef __linux__
+    if (running_) return true;
+    if (config_.backend == IoBackend::Uring && !IoUring::available()) {
+        std::cerr << "io_uring is unavailable; using epoll" << std::endl;
+        config_.backend = IoBackend::Epoll;
+    }
+    
+    // io_uring waits for room itself; epoll needs sends that return when the socket is full
+    if (config_.backend == IoBackend::Epoll && !network_.set_nonblocking()) {
+        std::cerr << "Failed to make the socket non-blocking" << std::endl;
+        return false;
+    }
+    if (config_.send_buffer > 0) {
+        network_.set_send_buffer(config_.send_buffer);
+    }
+    
+    // A restart means a new connection: a half-written stream message cannot continue on it
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (offset_ > 0 && size_ > 0) {
+            size_t index = order_[head_];
+            head_ = (head_ + 1) % order_.size();
+            size_--;
+            queued_frames_ -= slots_[index].frames;
+            free_slot_locked(index);
+        }
+        offset_ = 0;
+        inflight_ = 0;
+        
+        // Zero-copy notifications died with the old ring, and the old socket is closed
+        for (size_t i = 0; i < slots_.size(); i++) {
+            if (slots_[i].pins > 0) {
+                slots_[i].pins = 0;
+                unpin_locked(&i, 1);
+            }
+        }
+    }
+    failed_ = false;
+    
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        std::cerr << "Failed to create the wake-up event" << std::endl;
+        stop();
+        return false;
+    }
+    
+    if (config_.backend == IoBackend::Uring) {
+        if (!uring_) {
+            uring_ = std::make_unique<Uring>();
+        }
+        Uring& uring = *uring_;
+        if (!uring.ring.init(kUringEntries)) {
+            std::cerr << "Failed to create io_uring instance" << std::endl;
+            stop();
+            return false;
+        }
+        uring.fd = network_.fd();
+        uring.ring.register_file(uring.fd);
+        uring.stream = network_.max_message_size() == 0;
+        uring.wake_armed = false;
+        uring.error_armed = false;
+        uring.outstanding = 0;
+        uring.unaccounted = false;
+        uring.count = 0;
+        uring.requests = 0;
+        uring.pinned_count = 0;
+        
+        running_ = true;
+        thread_ = std::thread(&NetworkEngine::run, this);
+        return true;
+    }
+    
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        std::cerr << "Failed to create epoll instance" << std::endl;
+        stop();
+        return false;
+    }
+    
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+    
+    // Errors and hangups are always reported; EPOLLOUT is added only while blocked
+    event.events = 0;
+    event.data.fd = network_.fd();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, network_.fd(), &event) < 0) {
+        std::cerr << "Failed to watch the socket" << std::endl;
+        stop();
+        return false;
+    }
+    want_writable_ = false;
+    
+    running_ = true;
+    thread_ = std::thread(&NetworkEngine::run, this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NetworkEngine::stop() {
+#ifdef __linux__
+    if (running_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        room_.notify_all();
+        wake();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    if (uring_) {
+        uring_->ring.close();
+    }
+#endif
+}
+
+bool NetworkEngine::drain(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!failed_ && std::chrono::steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (size_ == 0) return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+bool NetworkEngine::submit(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload,
+                           bool wait) {
+    if (failed_) return false;
+    stats_.submitted++;
+    
+    // A non-empty queue means the I/O thread is already writing or waiting for EPOLLOUT
+    bool was_empty;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        
+        if (wait) {
+            // An empty queue always accepts, so a message larger than the budget cannot stall
+            room_.wait(lock, [this, frames] {
+                return failed_ || !running_ || size_ == 0 ||
+                       (queued_frames_ + frames <= limit_frames_ && !free_.empty());
+            });
+        }
+        
+        bool over = size_ > 0 && (queued_frames_ + frames > limit_frames_ || free_.empty());
+        while (over) {
+            if (config_.policy == OverflowPolicy::DropNewest || !drop_oldest_locked()) {
+                stats_.dropped_newest++;
+                return false;
+            }
+            over = size_ > 0 && (queued_frames_ + frames > limit_frames_ || free_.empty());
+        }
+        
+        size_t index = free_.back();
+        free_.pop_back();
+        Slot& slot = slots_[index];
+        slot.body = copy_message_head(parts, count, payload, slot.bytes);
+        slot.payload = slot.body.data ? payload : SharedBuffer();
+        slot.frames = frames;
+        
+        was_empty = size_ == 0;
+        order_[(head_ + size_) % order_.size()] = index;
+        size_++;
+        queued_frames_ += frames;
+        if (queued_frames_ > stats_.peak_queue_frames) {
+            stats_.peak_queue_frames = queued_frames_;
+        }
+        
+        if (config_.policy == OverflowPolicy::Downgrade) {
+            update_downgrade_locked();
+        }
+    }
+    
+    if (was_empty) {
+        wake();
+    }
+    return true;
+}
+
+bool NetworkEngine::drop_oldest_locked() {
+    // Never drop what the I/O thread is writing, or a half-written stream message
+    size_t first = std::max<size_t>(inflight_, offset_ > 0 ? 1 : 0);
+    if (first >= size_) return false;
+    
+    const size_t capacity = order_.size();
+    size_t victim = order_[(head_ + first) % capacity];
+    
+    // Shift the protected prefix up by one over the victim
+    for (size_t i = first; i > 0; i--) {
+        order_[(head_ + i) % capacity] = order_[(head_ + i - 1) % capacity];
+    }
+    head_ = (head_ + 1) % capacity;
+    size_--;
+    
+    queued_frames_ -= slots_[victim].frames;
+    free_slot_locked(victim);
+    stats_.dropped_oldest++;
+    return true;
+}
+
+void NetworkEngine::free_slot_locked(size_t index) {
+    Slot& slot = slots_[index];
+    if (slot.pins > 0) {
+        // The kernel may still read these bytes; unpin_locked() frees the slot
+        slot.released = true;
+        return;
+    }
+    slot.released = false;
+    slot.payload.reset();
+    slot.body = ConstBuffer{nullptr, 0};
+    free_.push_back(index);
+}
+
+void NetworkEngine::update_downgrade_locked() {
+    auto now = std::chrono::steady_clock::now();
+    double fill = limit_frames_ > 0 ? static_cast<double>(queued_frames_) / limit_frames_ : 0.0;
+    int level = downgrade_level_;
+    
+    if (fill > kDowngradeFill && level < config_.max_downgrade && now - last_level_change_ >= kDowngradeInterval) {
+        downgrade_level_ = level + 1;
+        last_level_change_ = now;
+        stats_.downgrades++;
+    } else if (fill < kRecoverFill && level > 0 && now - last_level_change_ >= kRecoverInterval) {
+        downgrade_level_ = level - 1;
+        last_level_change_ = now;
+    }
+}
+
+uint64_t NetworkEngine::queued_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_.sample_rate > 0 ? queued_frames_ * 1000 / config_.sample_rate : 0;
+}
+
+void NetworkEngine::wake() {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t written = write(wake_fd_, &one, sizeof(one));
+    (void)written;
+#endif
+}
+
+void NetworkEngine::set_writable_interest(bool enabled) {
+#ifdef __linux__
+    if (enabled == want_writable_) return;
+    
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u;
+    event.data.fd = network_.fd();
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, network_.fd(), &event);
+    want_writable_ = enabled;
+#else
+    (void)enabled;
+#endif
+}
+
+bool NetworkEngine::pump() {
+    MessageView batch[Network::kMaxSendSome];
+    
+    while (true) {
+        size_t count = 0;
+        size_t offset = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count = std::min(size_, Network::kMaxSendSome);
+            for (size_t i = 0; i < count; i++) {
+                const Slot& slot = slots_[order_[(head_ + i) % order_.size()]];
+                batch[i] = MessageView{ConstBuffer{slot.bytes.data(), slot.bytes.size()}, slot.body};
+            }
+            inflight_ = count;
+            offset = offset_;
+        }
+        
+        if (count == 0) {
+            set_writable_interest(false);
+            return true;
+        }
+        
+        int sent = network_.send_some(batch, count, offset);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_ = 0;
+            offset_ = sent < 0 ? 0 : offset;
+            
+            for (int i = 0; i < sent; i++) {
+                size_t index = order_[head_];
+                head_ = (head_ + 1) % order_.size();
+                size_--;
+                queued_frames_ -= slots_[index].frames;
+                free_slot_locked(index);
+            }
+        }
+        if (sent > 0) {
+            room_.notify_all();
+        }
+        
+        if (sent < 0) return false;
+        if (static_cast<size_t>(sent) < count) {
+            // The socket is full; resume when epoll reports it writable
+            set_writable_interest(true);
+            return true;
+        }
+    }
+}
+
+void NetworkEngine::run() {
+    bool connected = config_.backend == IoBackend::Uring ? run_uring() : run_epoll();
+    if (connected) return;
+    
+    std::cerr << "Connection lost; dropping queued audio" << std::endl;
+    failed_ = true;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (size_ > 0) {
+        free_slot_locked(order_[head_]);
+        head_ = (head_ + 1) % order_.size();
+        size_--;
+    }
+    queued_frames_ = 0;
+    offset_ = 0;
+    inflight_ = 0;
+    room_.notify_all();
+}
+
+bool NetworkEngine::run_epoll() {
+#ifdef __linux__
+    struct epoll_event events[4];
+    
+    while (running_) {
+        int ready = epoll_wait(epoll_fd_, events, 4, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait failed" << std::endl;
+            break;
+        }
+        
+        bool broken = false;
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t value;
+                ssize_t drained = read(wake_fd_, &value, sizeof(value));
+                (void)drained;
+            } else if (events[i].events & EPOLLHUP) {
+                broken = true;
+            } else if (events[i].events & EPOLLERR) {
+                // Reading SO_ERROR clears it; a refused UDP datagram is not fatal
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(network_.fd(), SOL_SOCKET, SO_ERROR, &error, &length);
+                broken = error != 0 && error != ECONNREFUSED;
+            }
+        }
+        if (!running_) break;
+        
+        if (broken || !pump()) return false;
+    }
+#endif
+    return true;
+}
+
+bool NetworkEngine::run_uring() {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    bool connected = true;
+    
+    while (running_ && connected) {
+        // The wake-up read and the error watch are one-shot; re-arm them each round
+        if (!uring.wake_armed && uring.ring.prepare_read(wake_fd_, &uring.wake_value, sizeof(uring.wake_value),
+                                                          kWakeRequest)) {
+            uring.wake_armed = true;
+            uring.outstanding++;
+        }
+        if (!uring.error_armed && uring.ring.prepare_poll(uring.fd, POLLERR | POLLHUP, kErrorRequest)) {
+            uring.error_armed = true;
+            uring.outstanding++;
+        }
+        if (uring.count == 0) {
+            submit_batch();
+        }
+        
+        int entered = uring.ring.enter(1);
+        if (entered < 0 && entered != -EINTR && entered != -EAGAIN && entered != -EBUSY) {
+            std::cerr << "io_uring_enter failed: " << std::strerror(-entered) << std::endl;
+            connected = false;
+            break;
+        }
+        if (entered > 0 && uring.unaccounted) {
+            // One system call for the whole batch
+            network_.record_sent(0, 0, 1);
+            uring.unaccounted = false;
+        }
+        
+        UringCompletion completion;
+        while (uring.ring.next_completion(completion)) {
+            if (completion.notification()) {
+                release_pinned(completion.user_data >> kGenerationShift);
+                continue;
+            }
+            uring.outstanding--;
+            
+            if (completion.user_data == kWakeRequest) {
+                uring.wake_armed = false;
+            } else if (completion.user_data == kErrorRequest) {
+                uring.error_armed = false;
+                if (completion.result > 0 && (completion.result & POLLHUP)) {
+                    connected = false;
+                } else if (completion.result > 0 && (completion.result & POLLERR)) {
+                    // Reading SO_ERROR clears it; a refused UDP datagram is not fatal
+                    int error = 0;
+                    socklen_t length = sizeof(error);
+                    getsockopt(uring.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                    connected = error == 0 || error == ECONNREFUSED;
+                }
+            } else if (is_send_request(completion.user_data)) {
+                record_completion(completion);
+            }
+        }
+        
+        if (uring.count > 0 && uring.completed == uring.requests && !finish_batch()) {
+            connected = false;
+        }
+    }
+    
+    shutdown_uring();
+    return connected;
+#else
+    return true;
+#endif
+}
+
+void NetworkEngine::submit_batch() {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count = std::min(size_, Network::kMaxSendSome);
+        for (size_t i = 0; i < count; i++) {
+            size_t index = order_[(head_ + i) % order_.size()];
+            const Slot& slot = slots_[index];
+            uring.slots[i] = index;
+            uring.batch[i] = MessageView{ConstBuffer{slot.bytes.data(), slot.bytes.size()}, slot.body};
+        }
+        inflight_ = count;
+        uring.offset = offset_;
+    }
+    if (count == 0) return;
+    
+    uring.generation++;
+    uring.count = count;
+    uring.requests = 0;
+    uring.completed = 0;
+    uring.zerocopy = false;
+    
+    size_t built = network_.build_sends(uring.batch, count, uring.offset, uring.headers, uring.covers);
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes += uring.batch[i].size();
+    }
+    
+    // Datagrams stay under the MTU, far below where zero-copy pays off
+    bool zerocopy = uring.stream && bytes >= kZeroCopyBytes && uring.ring.zerocopy() &&
+                    uring.pinned_count < kMaxPinnedSends;
+    
+    // A failed send cancels the ones linked after it; they go again in the next batch
+    for (size_t i = 0; i < built; i++) {
+        uring.results[i] = -ECANCELED;
+        if (!uring.ring.prepare_sendmsg(uring.fd, uring.headers[i], MSG_NOSIGNAL, send_request(uring.generation, i),
+                                        i + 1 < built, zerocopy)) {
+            break;
+        }
+        uring.requests++;
+    }
+    uring.zerocopy = zerocopy && uring.requests > 0;
+    uring.outstanding += uring.requests;
+    uring.unaccounted = uring.requests > 0;
+    
+    if (uring.zerocopy) {
+        Uring::Pinned& pinned = uring.pinned[uring.pinned_count++];
+        pinned.generation = uring.generation;
+        pinned.count = count;
+        std::copy(uring.slots, uring.slots + count, pinned.slots);
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < count; i++) {
+            slots_[uring.slots[i]].pins++;
+        }
+        stats_.zerocopy_sends++;
+    }
+#endif
+}
+
+void NetworkEngine::record_completion(const UringCompletion& completion) {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    uint64_t generation = completion.user_data >> kGenerationShift;
+    size_t index = completion.user_data & ((uint64_t(1) << kGenerationShift) - 1);
+    
+    // A zero-copy send that failed, or was copied after all, sends no notification
+    if (!completion.more()) {
+        release_pinned(generation);
+    }
+    if (generation != uring.generation || index >= uring.requests) return;
+    uring.results[index] = completion.result;
+    uring.completed++;
+#else
+    (void)completion;
+#endif
+}
+
+bool NetworkEngine::finish_batch() {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    size_t handled = 0;
+    size_t offset = uring.offset;
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    bool connected = true;
+    
+    if (uring.stream) {
+        int32_t result = uring.results[0];
+        if (result >= 0) {
+            handled = complete_messages(uring.batch, uring.count, static_cast<size_t>(result), offset);
+            messages = handled;
+            bytes = static_cast<uint64_t>(result);
+        } else if (network_.classify_send_error(-result) == Network::SendError::Fatal) {
+            std::cerr << "TCP send failed: " << std::strerror(-result) << std::endl;
+            connected = false;
+        }
+    } else {
+        for (size_t i = 0; i < uring.requests; i++) {
+            int32_t result = uring.results[i];
+            if (result >= 0) {
+                messages += uring.covers[i];
+                bytes += static_cast<uint64_t>(result);
+                handled += uring.covers[i];
+                continue;
+            }
+            
+            Network::SendError error = network_.classify_send_error(-result);
+            if (error == Network::SendError::Fatal) {
+                std::cerr << "UDP send failed: " << std::strerror(-result) << std::endl;
+                connected = false;
+            }
+            if (error != Network::SendError::Drop) break;
+            handled += uring.covers[i];
+        }
+    }
+    network_.record_sent(messages, bytes, 0);
+    uring.count = 0;
+    uring.requests = 0;
+    
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inflight_ = 0;
+        offset_ = connected ? offset : 0;
+        for (size_t i = 0; i < handled; i++) {
+            size_t index = order_[head_];
+            head_ = (head_ + 1) % order_.size();
+            size_--;
+            queued_frames_ -= slots_[index].frames;
+            free_slot_locked(index);
+        }
+    }
+    if (handled > 0) {
+        room_.notify_all();
+    }
+    return connected;
+#else
+    return true;
+#endif
+}
+
+void NetworkEngine::release_pinned(uint64_t generation) {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    for (size_t i = 0; i < uring.pinned_count; i++) {
+        if (uring.pinned[i].generation != generation) continue;
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            unpin_locked(uring.pinned[i].slots, uring.pinned[i].count);
+        }
+        uring.pinned[i] = uring.pinned[--uring.pinned_count];
+        return;
+    }
+#else
+    (void)generation;
+#endif
+}
+
+void NetworkEngine::unpin_locked(const size_t* indices, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Slot& slot = slots_[indices[i]];
+        if (slot.pins > 0) {
+            slot.pins--;
+        }
+        if (slot.pins == 0 && slot.released) {
+            free_slot_locked(indices[i]);
+        }
+    }
+}
+
+void NetworkEngine::shutdown_uring() {
+#ifdef __linux__
+    Uring& uring = *uring_;
+    
+    // Nothing may still point into the slots once the thread exits: cancel
+    // whatever waits on the socket or the wake-up and collect every completion
+    if (uring.count > 0) {
+        for (size_t i = 0; i < uring.requests; i++) {
+            if (uring.ring.prepare_cancel(send_request(uring.generation, i), kCancelRequest)) {
+                uring.outstanding++;
+            }
+        }
+    }
+    if (uring.wake_armed && uring.ring.prepare_cancel(kWakeRequest, kCancelRequest)) {
+        uring.outstanding++;
+    }
+    if (uring.error_armed && uring.ring.prepare_cancel(kErrorRequest, kCancelRequest)) {
+        uring.outstanding++;
+    }
+    
+    while (uring.outstanding > 0) {
+        int entered = uring.ring.enter(1);
+        if (entered < 0 && entered != -EINTR) break;
+        
+        UringCompletion completion;
+        while (uring.ring.next_completion(completion)) {
+            if (completion.notification()) {
+                release_pinned(completion.user_data >> kGenerationShift);
+                continue;
+            }
+            uring.outstanding--;
+            if (is_send_request(completion.user_data)) {
+                record_completion(completion);
+            }
+        }
+    }
+    uring.wake_armed = false;
+    uring.error_armed = false;
+    
+    // Account for what went out before the cancel. Pending zero-copy
+    // notifications are not waited for: a stalled peer may never acknowledge,
+    // so those slots stay pinned until start() and its new socket.
+    if (uring.count > 0) {
+        finish_batch();
+    }
+#endif
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "network.h"
+#include "shared_buffer.h"
+
+struct UringCompletion;
+
+// What to do when the outbound queue would exceed its audio budget
+enum class OverflowPolicy {
+    DropOldest,     // discard queued audio to keep latency bounded
+    DropNewest,     // discard the new message
+    Downgrade       // ask the pipeline for cheaper payloads, then drop oldest
+};
+
+bool parse_overflow_policy(const std::string& name, OverflowPolicy& policy);
+const char* overflow_policy_name(OverflowPolicy policy);
+
+// How the I/O thread drives the socket
+enum class IoBackend {
+    Epoll,      // non-blocking sends, waiting for EPOLLOUT when the socket is full
+    Uring       // batches of sends submitted to io_uring, zero-copy for large writes
+};
+
+const char* io_backend_name(IoBackend backend);
+
+// Copies a message's parts into head, except a last part that lies inside
+// payload: that one is returned so the caller can keep a reference to
+// payload instead of copying it. Returns an empty buffer if all were copied.
+ConstBuffer copy_message_head(const ConstBuffer* parts, size_t count, const SharedBuffer& payload,
+                              std::vector<uint8_t>& head);
+
+struct EngineConfig {
+    int sample_rate = 16000;        // wire rate, to turn frames into milliseconds
+    int queue_ms = 150;             // outbound budget in milliseconds of audio
+    OverflowPolicy policy = OverflowPolicy::DropOldest;
+    int max_downgrade = 0;          // deepest quality level the pipeline offers
+    bool wait_when_full = false;    // offline sources wait for room instead of dropping
+    size_t send_buffer = 0;         // SO_SNDBUF cap in bytes; 0 leaves the kernel default
+    IoBackend backend = IoBackend::Epoll;
+};
+
+struct EngineStats {
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> dropped_oldest{0};
+    std::atomic<uint64_t> dropped_newest{0};
+    std::atomic<uint64_t> peak_queue_frames{0};
+    std::atomic<uint64_t> downgrades{0};
+    std::atomic<uint64_t> zerocopy_sends{0};
+};
+
+// Event-loop sender: the caller's thread only queues messages, copying their
+// headers and referencing their shared payloads, and an I/O thread drains
+// the bounded queue into the socket, either non-blocking with epoll or as
+// batches of io_uring requests. A slow or stalled receiver costs at most
+// queue_ms of audio, never a blocked capture path. Linux only; elsewhere
+// supported() is false.
+class NetworkEngine {
+public:
+    static bool supported();
+    
+    NetworkEngine(Network& network, const EngineConfig& config);
+    ~NetworkEngine();
+    
+    // Falls back to epoll when the io_uring backend is unavailable
+    bool start();
+    void stop();
+    
+    // Waits up to timeout for the queue to empty, e.g. before shutdown
+    bool drain(std::chrono::milliseconds timeout);
+    
+    // Queues one message (header and payload parts) covering frames of audio.
+    // A last part inside payload is referenced, everything else copied.
+    // Returns false if the message was dropped. With wait, blocks for room
+    // instead of applying the overflow policy.
+    bool submit(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload) {
+        return submit(parts, count, frames, payload, config_.wait_when_full);
+    }
+    bool submit(const ConstBuffer* parts, size_t count, uint32_t frames, const SharedBuffer& payload, bool wait);
+    
+    // Quality level the Downgrade policy currently asks for; 0 is full quality
+    int downgrade_level() const { return downgrade_level_; }
+    
+    // False once the connection failed, until the next start(); queued audio is discarded
+    bool healthy() const { return !failed_; }
+    
+    uint64_t queued_ms() const;
+    
+    // Queue budget in wire-rate frames; queued payloads never cover more
+    uint64_t limit_frames() const { return limit_frames_; }
+    const EngineStats& stats() const { return stats_; }
+    
+    // Backend in use after any fallback
+    IoBackend backend() const { return config_.backend; }
+
+private:
+    struct Slot {
+        std::vector<uint8_t> bytes;     // copied parts
+        SharedBuffer payload;           // keeps body alive
+        ConstBuffer body{nullptr, 0};
+        uint32_t frames = 0;
+        
+        // Zero-copy sends the kernel may still read from; the slot is
+        // reused only after the last one's notification
+        uint32_t pins = 0;
+        bool released = false;
+    };
+    
+    // io_uring backend state, defined with the backend
+    struct Uring;
+    
+    void run();
+    
+    // Backend loops; false when the connection failed
+    bool run_epoll();
+    bool run_uring();
+    
+    // Writes queued messages until the socket would block; false on a fatal error
+    bool pump();
+    
+    // io_uring: submits the front of the queue as one batch, collects its
+    // completions and pops what went out; finish_batch() is false on a fatal error
+    void submit_batch();
+    void record_completion(const UringCompletion& completion);
+    bool finish_batch();
+    
+    // Zero-copy: the kernel is done with a send's buffers
+    void release_pinned(uint64_t generation);
+    void unpin_locked(const size_t* indices, size_t count);
+    
+    // Cancels and collects every outstanding request before the thread exits
+    void shutdown_uring();
+    
+    // Removes the oldest message not currently being written; false if none
+    bool drop_oldest_locked();
+    
+    // Returns a slot to the free list, releasing its payload reference
+    void free_slot_locked(size_t index);
+    void update_downgrade_locked();
+    void set_writable_interest(bool enabled);
+    void wake();
+    
+    Network& network_;
+    EngineConfig config_;
+    EngineStats stats_;
+    uint64_t limit_frames_ = 0;
+    
+    // Queue of slot indices in order_[head_ .. head_ + size_), modulo capacity
+    mutable std::mutex mutex_;
+    std::condition_variable room_;
+    std::vector<Slot> slots_;
+    std::vector<size_t> free_;
+    std::vector<size_t> order_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    uint64_t queued_frames_ = 0;
+    
+    // The I/O thread writes the first inflight_ messages outside the lock;
+    // a partly written stream message stays pinned while offset_ > 0
+    size_t inflight_ = 0;
+    size_t offset_ = 0;
+    
+    std::atomic<int> downgrade_level_{0};
+    std::chrono::steady_clock::time_point last_level_change_;
+    
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::unique_ptr<Uring> uring_;
+    bool want_writable_ = false;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> failed_{false};
+    std::thread thread_;
+};
@@ -1,18 +1,238 @@
 #include "network.h"
+#include "resolver.h"
 #include <iostream>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <chrono>
 
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
 #endif
 
+#ifdef __linux__
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// IP and UDP headers
+constexpr size_t kUdpOverhead = 20 + 8;
+constexpr size_t kUdp6Overhead = 40 + 8;
+
+// Kernel limits for one UDP_SEGMENT super-buffer
+constexpr size_t kMaxSegments = 64;
+constexpr size_t kMaxSegmentBytes = 65535 - kUdpOverhead;
+
+// Longest a connect waits for the name lookup before giving up
+constexpr auto kResolveTimeout = std::chrono::seconds(2);
+
+// Head start each connection attempt gets before the next one starts (RFC 8305)
+constexpr auto kAttemptDelay = std::chrono::milliseconds(250);
+
+namespace {
+
+void close_socket(int fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+bool set_socket_blocking(int fd, bool blocking) {
+#ifdef _WIN32
+    u_long enabled = blocking ? 0 : 1;
+    return ioctlsocket(fd, FIONBIO, &enabled) == 0;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, flags) == 0;
+#endif
+}
+
+// Reads without blocking; 0 means nothing is waiting, -1 a dead connection
+int receive_nonblocking(int fd, uint8_t* buffer, size_t size, bool stream) {
+    if (fd < 0) return -1;
+    
+#ifdef _WIN32
+    // No MSG_DONTWAIT: only read what is already there
+    u_long available = 0;
+    if (ioctlsocket(fd, FIONREAD, &available) != 0) return -1;
+    if (available == 0) return 0;
+    int received = recv(fd, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0);
+    if (received < 0) {
+        // WSAECONNRESET on a datagram socket is an ICMP port unreachable
+        int error = WSAGetLastError();
+        return error == WSAEWOULDBLOCK || (!stream && error == WSAECONNRESET) ? 0 : -1;
+    }
+    return received == 0 && stream ? -1 : received;
+#else
+    ssize_t received;
+    do {
+        received = recv(fd, buffer, size, MSG_DONTWAIT);
+    } while (received < 0 && errno == EINTR);
+    
+    if (received < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        // ICMP port unreachable from an earlier datagram; the relay may not be up yet
+        return !stream && errno == ECONNREFUSED ? 0 : -1;
+    }
+    // A stream read of 0 bytes is the peer closing; a datagram can be empty
+    return received == 0 && stream ? -1 : static_cast<int>(received);
+#endif
+}
+
+#ifdef __linux__
+// Kernels or devices without GSO reject a segmented message with one of these
+bool gso_unsupported(int error) {
+    return error == EIO || error == EINVAL || error == EOPNOTSUPP || error == ENOPROTOOPT;
+}
+#endif
+
+bool connect_in_progress() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EINPROGRESS;
+#endif
+}
+
+// Happy Eyeballs: starts a connection attempt to the next address every
+// kAttemptDelay, or as soon as the previous one fails, and keeps the first
+// that completes. A dead address family then costs a quarter second instead
+// of a full connect timeout. Returns a blocking socket, or -1.
+int connect_racing(const std::vector<ResolvedAddress>& addresses, std::chrono::milliseconds timeout,
+                   size_t& winner) {
+    struct Attempt {
+        int fd;
+        size_t index;
+    };
+    std::vector<Attempt> attempts;
+    std::vector<struct pollfd> polls;
+    
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto next_start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    int connected = -1;
+    
+    while (connected < 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+        
+        if (next < addresses.size() && (now >= next_start || attempts.empty())) {
+            const ResolvedAddress& address = addresses[next];
+            int fd = static_cast<int>(socket(address.family(), SOCK_STREAM, 0));
+            if (fd >= 0 && set_socket_blocking(fd, false)) {
+                if (::connect(fd, address.address(), address.length) == 0) {
+                    connected = fd;
+                    winner = next;
+                } else if (connect_in_progress()) {
+                    attempts.push_back({fd, next});
+                } else {
+                    close_socket(fd);
+                }
+            } else if (fd >= 0) {
+                close_socket(fd);
+            }
+            next++;
+            next_start = now + kAttemptDelay;
+            continue;
+        }
+        if (attempts.empty()) break;
+        
+        // Sleep until an attempt finishes or the next one is due
+        auto wake = deadline;
+        if (next < addresses.size()) {
+            wake = std::min(wake, next_start);
+        }
+        int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count()) + 1;
+        
+        polls.resize(attempts.size());
+        for (size_t i = 0; i < attempts.size(); i++) {
+            polls[i].fd = attempts[i].fd;
+            polls[i].events = POLLOUT;
+            polls[i].revents = 0;
+        }
+#ifdef _WIN32
+        int ready = WSAPoll(polls.data(), static_cast<ULONG>(polls.size()), wait_ms);
+#else
+        int ready = poll(polls.data(), polls.size(), wait_ms);
+#endif
+        if (ready <= 0) continue;
+        
+        for (size_t i = attempts.size(); i > 0; i--) {
+            if (polls[i - 1].revents == 0) continue;
+            
+            Attempt attempt = attempts[i - 1];
+            attempts.erase(attempts.begin() + static_cast<std::ptrdiff_t>(i - 1));
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(attempt.fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+            if (error == 0 && connected < 0) {
+                connected = attempt.fd;
+                winner = attempt.index;
+            } else {
+                close_socket(attempt.fd);
+                next_start = now;
+            }
+        }
+    }
+    
+    for (const Attempt& attempt : attempts) {
+        close_socket(attempt.fd);
+    }
+    if (connected >= 0 && !set_socket_blocking(connected, true)) {
+        close_socket(connected);
+        connected = -1;
+    }
+    return connected;
+}
+
+} // namespace
+
+size_t message_parts(const MessageView& message, size_t offset, ConstBuffer* out) {
+    size_t count = 0;
+    if (offset < message.head.size) {
+        out[count++] = ConstBuffer{message.head.data + offset, message.head.size - offset};
+        offset = 0;
+    } else {
+        offset -= message.head.size;
+    }
+    if (offset < message.body.size) {
+        out[count++] = ConstBuffer{message.body.data + offset, message.body.size - offset};
+    }
+    return count;
+}
+
+size_t complete_messages(const MessageView* messages, size_t count, size_t written, size_t& offset) {
+    size_t complete = 0;
+    while (complete < count) {
+        size_t rest = messages[complete].size() - (complete == 0 ? offset : 0);
+        if (written < rest) break;
+        written -= rest;
+        complete++;
+    }
+    offset = complete < count ? written + (complete == 0 ? offset : 0) : 0;
+    return complete;
+}
+
 void Network::initialize() {
 #ifdef _WIN32
     WSADATA wsaData;
@@ -29,60 +249,196 @@ void Network::cleanup() {
 #endif
 }
 
+int Network::send_some(const MessageView* messages, size_t count, size_t& offset) {
+    // Blocking fallback for sockets without a non-blocking path
+    for (size_t i = 0; i < count; i++) {
+        ConstBuffer rest[2];
+        size_t parts = message_parts(messages[i], offset, rest);
+        offset = 0;
+        if (!send(rest, parts)) return i > 0 ? static_cast<int>(i) : -1;
+    }
+    return static_cast<int>(count);
+}
+
+Network::SendError Network::classify_send_error(int error) {
+    return error == EINTR || error == EAGAIN || error == ECANCELED ? SendError::Retry : SendError::Fatal;
+}
+
+void Network::record_sent(uint64_t messages, uint64_t bytes, uint64_t syscalls) {
+    stats_.messages += messages;
+    stats_.bytes += bytes;
+    stats_.syscalls += syscalls;
+}
+
+#ifdef __linux__
+size_t Network::build_sends(const MessageView* messages, size_t count, size_t offset, struct msghdr** headers,
+                            size_t* covers) {
+    count = std::min(count, kMaxSendSome);
+    size_t part_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        ConstBuffer pieces[2];
+        size_t pieces_count = message_parts(messages[i], i == 0 ? offset : 0, pieces);
+        for (size_t p = 0; p < pieces_count; p++) {
+            stream_iovecs_[part_count].iov_base = const_cast<uint8_t*>(pieces[p].data);
+            stream_iovecs_[part_count].iov_len = pieces[p].size;
+            part_count++;
+        }
+    }
+    
+    std::memset(&stream_header_, 0, sizeof(stream_header_));
+    stream_header_.msg_iov = stream_iovecs_;
+    stream_header_.msg_iovlen = part_count;
+    headers[0] = &stream_header_;
+    covers[0] = count;
+    return count > 0 ? 1 : 0;
+}
+#endif
+
+bool Network::set_nonblocking() {
+    return fd() >= 0 && set_socket_blocking(fd(), false);
+}
+
+bool Network::set_send_buffer(size_t bytes) {
+    int size = static_cast<int>(bytes);
+    return fd() >= 0 && setsockopt(fd(), SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&size), sizeof(size)) == 0;
+}
+
 // TCP Implementation
 TCPNetwork::~TCPNetwork() {
     disconnect();
 }
 
 bool TCPNetwork::connect(const std::string& host, int port) {
-    socket_fd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd_ < 0) {
-        std::cerr << "Failed to create TCP socket" << std::endl;
-        return false;
-    }
-    
-    struct sockaddr_in server_addr;
-    std::memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(port);
-    
-    // Convert hostname to IP
-    struct hostent* he = gethostbyname(host.c_str());
-    if (he == nullptr) {
-        std::cerr << "Failed to resolve hostname: " << host << std::endl;
-        disconnect();
+    std::vector<ResolvedAddress> addresses;
+    if (!Resolver::instance().resolve(host, port, addresses, kResolveTimeout)) {
         return false;
     }
     
-    std::memcpy(&server_addr.sin_addr, he->h_addr_list[0], he->h_length);
-    
-    if (::connect(socket_fd_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+    size_t winner = 0;
+    socket_fd_ = connect_racing(addresses, std::chrono::seconds(kConnectTimeoutSeconds), winner);
+    if (socket_fd_ < 0) {
         std::cerr << "Failed to connect to " << host << ":" << port << std::endl;
-        disconnect();
         return false;
     }
     
+    remote_address_ = addresses[winner].to_string();
     return true;
 }
 
-bool TCPNetwork::send(const std::vector<uint8_t>& data) {
-    if (socket_fd_ < 0) return false;
+void TCPNetwork::attach(int fd, const std::string& address) {
+    disconnect();
+    socket_fd_ = fd;
+    remote_address_ = address;
+}
+
+bool TCPNetwork::send(const ConstBuffer* buffers, size_t count) {
+    if (socket_fd_ < 0 || count > kMaxBuffers) return false;
     
-    size_t total_sent = 0;
-    while (total_sent < data.size()) {
-        ssize_t sent = ::send(socket_fd_, 
-                            reinterpret_cast<const char*>(data.data() + total_sent),
-                            data.size() - total_sent, 0);
+#ifdef _WIN32
+    WSABUF parts[kMaxBuffers];
+    for (size_t i = 0; i < count; i++) {
+        parts[i].buf = const_cast<char*>(reinterpret_cast<const char*>(buffers[i].data));
+        parts[i].len = static_cast<ULONG>(buffers[i].size);
+    }
+    
+    // Blocking WSASend completes the whole write
+    DWORD sent = 0;
+    stats_.syscalls++;
+    if (WSASend(socket_fd_, parts, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) {
+        std::cerr << "TCP send failed" << std::endl;
+        return false;
+    }
+    stats_.bytes += sent;
+#else
+    struct iovec parts[kMaxBuffers];
+    for (size_t i = 0; i < count; i++) {
+        parts[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+        parts[i].iov_len = buffers[i].size;
+    }
+    
+    struct iovec* pending = parts;
+    size_t remaining = count;
+    while (remaining > 0) {
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = pending;
+        message.msg_iovlen = remaining;
+        
+        ssize_t sent = sendmsg(socket_fd_, &message, MSG_NOSIGNAL);
+        stats_.syscalls++;
         if (sent < 0) {
+            if (errno == EINTR) continue;
             std::cerr << "TCP send failed" << std::endl;
             return false;
         }
-        total_sent += sent;
+        stats_.bytes += sent;
+        
+        // Skip what was written; a short write resumes mid-buffer
+        size_t written = static_cast<size_t>(sent);
+        while (remaining > 0 && written >= pending->iov_len) {
+            written -= pending->iov_len;
+            pending++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            pending->iov_base = static_cast<uint8_t*>(pending->iov_base) + written;
+            pending->iov_len -= written;
+        }
     }
+#endif
     
+    stats_.messages++;
     return true;
 }
 
+int TCPNetwork::send_some(const MessageView* messages, size_t count, size_t& offset) {
+    if (socket_fd_ < 0) return -1;
+    
+#ifdef _WIN32
+    return Network::send_some(messages, count, offset);
+#else
+    count = std::min(count, kMaxSendSome);
+    struct iovec parts[kMaxSendSome * 2];
+    size_t part_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        ConstBuffer pieces[2];
+        size_t pieces_count = message_parts(messages[i], i == 0 ? offset : 0, pieces);
+        for (size_t p = 0; p < pieces_count; p++) {
+            parts[part_count].iov_base = const_cast<uint8_t*>(pieces[p].data);
+            parts[part_count].iov_len = pieces[p].size;
+            part_count++;
+        }
+    }
+    
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = parts;
+    message.msg_iovlen = part_count;
+    
+    ssize_t sent;
+    do {
+        sent = sendmsg(socket_fd_, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        stats_.syscalls++;
+    } while (sent < 0 && errno == EINTR);
+    
+    if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        std::cerr << "TCP send failed" << std::endl;
+        return -1;
+    }
+    stats_.bytes += sent;
+    
+    // Count whole messages; a partial one keeps its progress in offset
+    size_t complete = complete_messages(messages, count, static_cast<size_t>(sent), offset);
+    stats_.messages += complete;
+    return static_cast<int>(complete);
+#endif
+}
+
+int TCPNetwork::receive(uint8_t* buffer, size_t size) {
+    return receive_nonblocking(socket_fd_, buffer, size, true);
+}
+
 void TCPNetwork::disconnect() {
     if (socket_fd_ >= 0) {
 #ifdef _WIN32
@@ -95,52 +451,413 @@ void TCPNetwork::disconnect() {
 }
 
 // UDP Implementation
+bool UDPNetwork::parse_send_mode(const std::string& name, SendMode& mode) {
+    if (name == "single") {
+        mode = SendMode::Single;
+    } else if (name == "mmsg") {
+        mode = SendMode::Batch;
+    } else if (name == "gso") {
+        mode = SendMode::Segment;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* UDPNetwork::send_mode_name(SendMode mode) {
+    switch (mode) {
+    case SendMode::Single: return "single";
+    case SendMode::Batch: return "mmsg";
+    case SendMode::Segment: return "gso";
+    }
+    return "unknown";
+}
+
+UDPNetwork::UDPNetwork(size_t mtu_cap, SendMode mode) : mtu_cap_(mtu_cap), mode_(mode) {
+    pending_.reserve(kMaxBatch);
+    pending_parts_.reserve(kMaxBatch * kMaxBuffers);
+#ifdef __linux__
+    iovecs_.resize(kMaxBatch * kMaxBuffers);
+    messages_.resize(kMaxBatch);
+    message_first_.resize(kMaxBatch);
+    message_datagrams_.resize(kMaxBatch);
+    control_.resize(kMaxBatch * CMSG_SPACE(sizeof(uint16_t)));
+#else
+    mode_ = SendMode::Single;
+#endif
+}
+
 UDPNetwork::~UDPNetwork() {
     disconnect();
 }
 
 bool UDPNetwork::connect(const std::string& host, int port) {
-    socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socket_fd_ < 0) {
-        std::cerr << "Failed to create UDP socket" << std::endl;
+    std::vector<ResolvedAddress> addresses;
+    if (!Resolver::instance().resolve(host, port, addresses, kResolveTimeout)) {
         return false;
     }
     
-    std::memset(&server_addr_, 0, sizeof(server_addr_));
-    server_addr_.sin_family = AF_INET;
-    server_addr_.sin_port = htons(port);
-    
-    // Convert hostname to IP
-    struct hostent* he = gethostbyname(host.c_str());
-    if (he == nullptr) {
-        std::cerr << "Failed to resolve hostname: " << host << std::endl;
+    // Connecting pins the route, so the kernel can report its path MTU. There
+    // is no handshake to race: the first address with a route wins.
+    for (const ResolvedAddress& address : addresses) {
+        socket_fd_ = static_cast<int>(socket(address.family(), SOCK_DGRAM, 0));
+        if (socket_fd_ < 0) continue;
+        if (::connect(socket_fd_, address.address(), address.length) == 0) {
+            family_ = address.family();
+            remote_address_ = address.to_string();
+            break;
+        }
         disconnect();
+    }
+    if (socket_fd_ < 0) {
+        std::cerr << "Failed to set UDP destination " << host << ":" << port << std::endl;
         return false;
     }
     
-    std::memcpy(&server_addr_.sin_addr, he->h_addr_list[0], he->h_length);
+    // Set DF so oversized datagrams fail with EMSGSIZE instead of fragmenting
+    if (family_ == AF_INET6) {
+#if defined(IPV6_MTU_DISCOVER) && defined(IPV6_PMTUDISC_DO)
+        int discover = IPV6_PMTUDISC_DO;
+        setsockopt(socket_fd_, IPPROTO_IPV6, IPV6_MTU_DISCOVER, reinterpret_cast<const char*>(&discover), sizeof(discover));
+#endif
+    } else {
+#if defined(IP_MTU_DISCOVER) && defined(IP_PMTUDISC_DO)
+        int discover = IP_PMTUDISC_DO;
+        setsockopt(socket_fd_, IPPROTO_IP, IP_MTU_DISCOVER, reinterpret_cast<const char*>(&discover), sizeof(discover));
+#endif
+    }
+    refresh_path_mtu();
+    
+#ifdef __linux__
+    // UDP_SEGMENT needs Linux 4.18; the option is readable exactly when it is supported
+    if (mode_ == SendMode::Segment) {
+        int segment = 0;
+        socklen_t length = sizeof(segment);
+        if (getsockopt(socket_fd_, SOL_UDP, UDP_SEGMENT, &segment, &length) < 0) {
+            mode_ = SendMode::Batch;
+        }
+    }
+#endif
     
     return true;
 }
 
-bool UDPNetwork::send(const std::vector<uint8_t>& data) {
-    if (socket_fd_ < 0) return false;
+void UDPNetwork::refresh_path_mtu() {
+    path_mtu_ = 0;
+    int mtu = 0;
+    socklen_t length = sizeof(mtu);
+    int result = -1;
+    if (family_ == AF_INET6) {
+#ifdef IPV6_MTU
+        result = getsockopt(socket_fd_, IPPROTO_IPV6, IPV6_MTU, reinterpret_cast<char*>(&mtu), &length);
+#endif
+    } else {
+#ifdef IP_MTU
+        result = getsockopt(socket_fd_, IPPROTO_IP, IP_MTU, reinterpret_cast<char*>(&mtu), &length);
+#endif
+    }
+    if (result == 0 && mtu > 0) {
+        path_mtu_ = static_cast<size_t>(mtu);
+    }
+}
+
+size_t UDPNetwork::max_message_size() const {
+    size_t mtu = mtu_cap_;
+    if (path_mtu_ > 0 && path_mtu_ < mtu) {
+        mtu = path_mtu_;
+    }
+    size_t overhead = family_ == AF_INET6 ? kUdp6Overhead : kUdpOverhead;
+    return mtu > overhead ? mtu - overhead : 0;
+}
+
+bool UDPNetwork::send(const ConstBuffer* buffers, size_t count) {
+    if (socket_fd_ < 0 || count > kMaxBuffers) return false;
     
-    ssize_t sent = sendto(socket_fd_,
-                         reinterpret_cast<const char*>(data.data()),
-                         data.size(), 0,
-                         (struct sockaddr*)&server_addr_,
-                         sizeof(server_addr_));
+#ifdef _WIN32
+    WSABUF parts[kMaxBuffers];
+    for (size_t i = 0; i < count; i++) {
+        parts[i].buf = const_cast<char*>(reinterpret_cast<const char*>(buffers[i].data));
+        parts[i].len = static_cast<ULONG>(buffers[i].size);
+    }
     
-    if (sent < 0) {
+    DWORD sent = 0;
+    stats_.syscalls++;
+    if (WSASend(socket_fd_, parts, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) {
         std::cerr << "UDP send failed" << std::endl;
         return false;
     }
+#else
+    struct iovec parts[kMaxBuffers];
+    for (size_t i = 0; i < count; i++) {
+        parts[i].iov_base = const_cast<uint8_t*>(buffers[i].data);
+        parts[i].iov_len = buffers[i].size;
+    }
     
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = parts;
+    message.msg_iovlen = count;
+    
+    ssize_t sent = sendmsg(socket_fd_, &message, 0);
+    stats_.syscalls++;
+    if (sent < 0) {
+        if (!recoverable_error(errno)) {
+            std::cerr << "UDP send failed" << std::endl;
+        }
+        return false;
+    }
+#endif
+    
+    stats_.messages++;
+    stats_.bytes += sent;
     return true;
 }
 
+bool UDPNetwork::recoverable_error(int error) {
+    if (error == EMSGSIZE) {
+        // The path MTU shrank; later datagrams are sized to the new value
+        refresh_path_mtu();
+        return true;
+    }
+    // ICMP port unreachable from an earlier datagram; the receiver may not be up yet
+    return error == ECONNREFUSED;
+}
+
+bool UDPNetwork::queue(const ConstBuffer* buffers, size_t count) {
+    if (mode_ == SendMode::Single) return send(buffers, count);
+    if (socket_fd_ < 0 || count > kMaxBuffers) return false;
+    
+    bool ok = true;
+    if (pending_.size() == kMaxBatch) {
+        ok = flush();
+    }
+    
+    Pending datagram{pending_parts_.size(), count, 0};
+    for (size_t i = 0; i < count; i++) {
+        pending_parts_.push_back(buffers[i]);
+        datagram.bytes += buffers[i].size;
+    }
+    pending_.push_back(datagram);
+    return ok;
+}
+
+bool UDPNetwork::flush() {
+    if (pending_.empty()) return true;
+    
+    bool ok = true;
+#ifdef __linux__
+    ok = flush_batch();
+#else
+    for (const Pending& datagram : pending_) {
+        ok = send(&pending_parts_[datagram.first], datagram.count) && ok;
+    }
+#endif
+    pending_.clear();
+    pending_parts_.clear();
+    return ok;
+}
+
+#ifdef __linux__
+size_t UDPNetwork::build_messages(size_t start) {
+    const size_t control_size = CMSG_SPACE(sizeof(uint16_t));
+    size_t count = 0;
+    size_t iov_used = 0;
+    
+    for (size_t i = start; i < pending_.size(); count++) {
+        // GSO cuts one buffer into equal segments; only the last may be shorter
+        size_t run = 1;
+        size_t segment = pending_[i].bytes;
+        if (mode_ == SendMode::Segment) {
+            size_t total = segment;
+            while (i + run < pending_.size() && run < kMaxSegments) {
+                size_t next = pending_[i + run].bytes;
+                if (next > segment || total + next > kMaxSegmentBytes) break;
+                total += next;
+                run++;
+                if (next < segment) break;
+            }
+        }
+        
+        struct mmsghdr& message = messages_[count];
+        std::memset(&message, 0, sizeof(message));
+        message.msg_hdr.msg_iov = &iovecs_[iov_used];
+        for (size_t d = i; d < i + run; d++) {
+            for (size_t p = 0; p < pending_[d].count; p++) {
+                const ConstBuffer& part = pending_parts_[pending_[d].first + p];
+                iovecs_[iov_used].iov_base = const_cast<uint8_t*>(part.data);
+                iovecs_[iov_used].iov_len = part.size;
+                iov_used++;
+            }
+        }
+        message.msg_hdr.msg_iovlen = &iovecs_[iov_used] - message.msg_hdr.msg_iov;
+        
+        if (run > 1) {
+            char* control = &control_[count * control_size];
+            std::memset(control, 0, control_size);
+            message.msg_hdr.msg_control = control;
+            message.msg_hdr.msg_controllen = control_size;
+            
+            struct cmsghdr* header = CMSG_FIRSTHDR(&message.msg_hdr);
+            header->cmsg_level = SOL_UDP;
+            header->cmsg_type = UDP_SEGMENT;
+            header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t size = static_cast<uint16_t>(segment);
+            std::memcpy(CMSG_DATA(header), &size, sizeof(size));
+        }
+        
+        message_first_[count] = i;
+        message_datagrams_[count] = run;
+        i += run;
+    }
+    return count;
+}
+
+bool UDPNetwork::flush_batch() {
+    return send_pending(0) >= 0;
+}
+
+int UDPNetwork::send_pending(int flags) {
+    size_t count = build_messages(0);
+    size_t done = 0;
+    size_t handled = 0;
+    
+    while (done < count) {
+        int sent = sendmmsg(socket_fd_, &messages_[done], static_cast<unsigned int>(count - done), flags);
+        stats_.syscalls++;
+        
+        if (sent < 0) {
+            int error = errno;
+            if (error == EINTR) continue;
+            if (error == EAGAIN || error == EWOULDBLOCK) break;
+            
+            // Kernels or devices without GSO reject the segmented message; rebuild without it
+            bool segmented = message_datagrams_[done] > 1;
+            if (segmented && gso_unsupported(error)) {
+                std::cerr << "UDP GSO unavailable, falling back to sendmmsg" << std::endl;
+                mode_ = SendMode::Batch;
+                
+                count = build_messages(message_first_[done]);
+                done = 0;
+                continue;
+            }
+            
+            if (!recoverable_error(error)) {
+                std::cerr << "UDP send failed" << std::endl;
+                return -1;
+            }
+            handled += message_datagrams_[done];
+            done++;
+            continue;
+        }
+        
+        for (int m = 0; m < sent; m++) {
+            stats_.messages += message_datagrams_[done + m];
+            stats_.bytes += messages_[done + m].msg_len;
+            handled += message_datagrams_[done + m];
+        }
+        done += static_cast<size_t>(sent);
+    }
+    return static_cast<int>(handled);
+}
+
+void UDPNetwork::set_pending(const MessageView* messages, size_t count) {
+    pending_.clear();
+    pending_parts_.clear();
+    for (size_t i = 0; i < count; i++) {
+        ConstBuffer parts[2];
+        size_t parts_count = message_parts(messages[i], 0, parts);
+        pending_.push_back(Pending{pending_parts_.size(), parts_count, messages[i].size()});
+        pending_parts_.insert(pending_parts_.end(), parts, parts + parts_count);
+    }
+}
+
+size_t UDPNetwork::build_sends(const MessageView* messages, size_t count, size_t offset, struct msghdr** headers,
+                               size_t* covers) {
+    (void)offset;
+    set_pending(messages, std::min(count, kMaxBatch));
+    
+    // Same GSO runs as sendmmsg would get; the headers live in messages_ until the next build
+    size_t built = build_messages(0);
+    for (size_t i = 0; i < built; i++) {
+        headers[i] = &messages_[i].msg_hdr;
+        covers[i] = message_datagrams_[i];
+    }
+    pending_.clear();
+    pending_parts_.clear();
+    return built;
+}
+#endif
+
+Network::SendError UDPNetwork::classify_send_error(int error) {
+#ifdef __linux__
+    if (mode_ == SendMode::Segment && gso_unsupported(error)) {
+        std::cerr << "UDP GSO unavailable, falling back to sendmmsg" << std::endl;
+        mode_ = SendMode::Batch;
+        return SendError::Retry;
+    }
+#endif
+    if (recoverable_error(error)) return SendError::Drop;
+    return Network::classify_send_error(error);
+}
+
+int UDPNetwork::send_some(const MessageView* messages, size_t count, size_t& offset) {
+    offset = 0;
+    if (socket_fd_ < 0) return -1;
+    count = std::min(count, kMaxBatch);
+    
+#ifdef __linux__
+    if (mode_ != SendMode::Single) {
+        set_pending(messages, count);
+        int handled = send_pending(MSG_DONTWAIT);
+        pending_.clear();
+        pending_parts_.clear();
+        return handled;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        ConstBuffer pieces[2];
+        size_t pieces_count = message_parts(messages[i], 0, pieces);
+        struct iovec parts[2];
+        for (size_t p = 0; p < pieces_count; p++) {
+            parts[p].iov_base = const_cast<uint8_t*>(pieces[p].data);
+            parts[p].iov_len = pieces[p].size;
+        }
+        
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = parts;
+        message.msg_iovlen = pieces_count;
+        
+        ssize_t sent;
+        do {
+            sent = sendmsg(socket_fd_, &message, MSG_DONTWAIT);
+            stats_.syscalls++;
+        } while (sent < 0 && errno == EINTR);
+        
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return static_cast<int>(i);
+            if (!recoverable_error(errno)) {
+                std::cerr << "UDP send failed" << std::endl;
+                return -1;
+            }
+            continue;
+        }
+        stats_.messages++;
+        stats_.bytes += sent;
+    }
+    return static_cast<int>(count);
+#else
+    return Network::send_some(messages, count, offset);
+#endif
+}
+
+int UDPNetwork::receive(uint8_t* buffer, size_t size) {
+    return receive_nonblocking(socket_fd_, buffer, size, false);
+}
+
 void UDPNetwork::disconnect() {
+    pending_.clear();
+    pending_parts_.clear();
     if (socket_fd_ >= 0) {
 #ifdef _WIN32
         closesocket(socket_fd_);
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include <cstdint>
 
 #ifdef _WIN32
@@ -9,12 +10,41 @@
 #include <ws2tcpip.h>
 #else
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netdb.h>
 #endif
 
+// One piece of a scatter-gather write
+struct ConstBuffer {
+    const uint8_t* data;
+    size_t size;
+};
+
+// One queued message for send_some(): bytes copied into the queue (usually
+// the header) followed by a payload it references, written back to back
+struct MessageView {
+    ConstBuffer head;
+    ConstBuffer body;
+    
+    size_t size() const { return head.size + body.size; }
+};
+
+// The non-empty pieces of a message after skipping offset bytes; at most two
+size_t message_parts(const MessageView& message, size_t offset, ConstBuffer* out);
+
+// Whole messages a stream write of written bytes finished, starting offset
+// bytes into messages[0]; offset is left where a partial message stopped
+size_t complete_messages(const MessageView* messages, size_t count, size_t written, size_t& offset);
+
+struct NetworkStats {
+    std::atomic<uint64_t> messages{0};     // datagrams, or framed writes on a stream
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> syscalls{0};     // send calls made to deliver them
+};
+
 class Network {
 public:
     virtual ~Network() = default;
@@ -26,32 +56,183 @@ public:
     // Connect to server
     virtual bool connect(const std::string& host, int port) = 0;
     
+    // Scatter-gather send: the buffers go out as one message (one datagram for UDP)
+    static constexpr size_t kMaxBuffers = 8;
+    virtual bool send(const ConstBuffer* buffers, size_t count) = 0;
+    
     // Send data
-    virtual bool send(const std::vector<uint8_t>& data) = 0;
+    bool send(const std::vector<uint8_t>& data) {
+        ConstBuffer buffer{data.data(), data.size()};
+        return send(&buffer, 1);
+    }
+    
+    // Batched send: queue() may hold the message until flush(), so its buffers
+    // must stay valid until then. Without batching, queue() sends immediately.
+    virtual bool queue(const ConstBuffer* buffers, size_t count) { return send(buffers, count); }
+    virtual bool flush() { return true; }
+    
+    // Non-blocking send for the event loop; each view is one whole message.
+    // Returns how many messages went out completely before the socket would
+    // block, or -1 on a fatal error. On streams, offset is how far into
+    // messages[0] an earlier call got, and is left where a partial write stopped.
+    static constexpr size_t kMaxSendSome = 64;
+    virtual int send_some(const MessageView* messages, size_t count, size_t& offset);
+    
+    // Non-blocking read of whatever the peer sent back, e.g. receiver reports.
+    // Returns bytes read (one datagram on UDP), 0 if nothing is waiting, or -1
+    // if the connection failed or the peer closed it.
+    virtual int receive(uint8_t* buffer, size_t size) { (void)buffer; (void)size; return 0; }
+    
+    // Switches the connected socket to non-blocking mode for send_some()
+    bool set_nonblocking();
+    
+    // Caps the kernel send buffer, which otherwise adds latency no queue policy can see
+    bool set_send_buffer(size_t bytes);
+    
+    // Largest message send() delivers in one piece; 0 means no limit (streams)
+    virtual size_t max_message_size() const { return 0; }
+    
+    // Sends made on fd() outside this class, e.g. through io_uring: what to
+    // do about a message that failed with error, and the counters to update
+    enum class SendError {
+        Retry,      // not sent; goes again with the next batch
+        Drop,       // lost, like a datagram refused by ICMP; carry on
+        Fatal       // the connection is gone
+    };
+    virtual SendError classify_send_error(int error);
+    void record_sent(uint64_t messages, uint64_t bytes, uint64_t syscalls);
+    
+#ifdef __linux__
+    // The msghdrs send_some() would hand the kernel for messages, starting
+    // offset bytes into messages[0], for a caller that submits them itself.
+    // covers[i] is how many messages headers[i] carries. Returns the number
+    // of headers; they stay valid until the next call.
+    virtual size_t build_sends(const MessageView* messages, size_t count, size_t offset, struct msghdr** headers,
+                               size_t* covers);
+#endif
     
     // Disconnect
     virtual void disconnect() = 0;
+    
+    // Connected socket, or -1
+    virtual int fd() const = 0;
+    
+    const NetworkStats& stats() const { return stats_; }
+    
+    // Address the last connect() reached, e.g. "[2001:db8::1]:8080"
+    const std::string& remote_address() const { return remote_address_; }
+
+protected:
+    NetworkStats stats_;
+    std::string remote_address_;
+    
+#ifdef __linux__
+    // Scratch for build_sends() on a stream: one write over every message
+    struct msghdr stream_header_;
+    struct iovec stream_iovecs_[kMaxSendSome * 2];
+#endif
 };
 
 class TCPNetwork : public Network {
 private:
     int socket_fd_ = -1;
-    
+
 public:
+    using Network::send;
+    
+    static constexpr int kConnectTimeoutSeconds = 5;
+    
     ~TCPNetwork() override;
     bool connect(const std::string& host, int port) override;
-    bool send(const std::vector<uint8_t>& data) override;
+    
+    // Takes over a socket that is already connected, e.g. one the relay accepted
+    void attach(int fd, const std::string& address);
+    
+    bool send(const ConstBuffer* buffers, size_t count) override;
+    int send_some(const MessageView* messages, size_t count, size_t& offset) override;
+    int receive(uint8_t* buffer, size_t size) override;
     void disconnect() override;
+    int fd() const override { return socket_fd_; }
 };
 
 class UDPNetwork : public Network {
+public:
+    // How queued datagrams leave the socket. Segment and Batch fall back to
+    // the next mode down when the kernel does not support them.
+    enum class SendMode {
+        Single,     // one sendmsg per datagram
+        Batch,      // sendmmsg per flush
+        Segment     // sendmmsg with UDP_SEGMENT (GSO) super-buffers
+    };
+    
+    static bool parse_send_mode(const std::string& name, SendMode& mode);
+    static const char* send_mode_name(SendMode mode);
+
 private:
     int socket_fd_ = -1;
-    struct sockaddr_in server_addr_;
+    int family_ = AF_INET;
+    size_t mtu_cap_;
+    size_t path_mtu_ = 0;
+    SendMode mode_;
+    
+    // Queued datagrams: pending_[i] covers pending_parts_[first, first + count)
+    struct Pending {
+        size_t first;
+        size_t count;
+        size_t bytes;
+    };
+    std::vector<Pending> pending_;
+    std::vector<ConstBuffer> pending_parts_;
     
+#ifdef __linux__
+    // Scratch for flush(), sized once in the constructor
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> messages_;
+    std::vector<size_t> message_first_;     // first pending datagram of each message
+    std::vector<size_t> message_datagrams_;
+    std::vector<char> control_;
+    
+    // Replaces the pending datagrams with messages
+    void set_pending(const MessageView* messages, size_t count);
+    size_t build_messages(size_t start);
+    bool flush_batch();
+    
+    // One sendmmsg over the pending datagrams; returns datagrams handled or -1
+    int send_pending(int flags);
+#endif
+    
+    // Re-reads the kernel's path MTU estimate for the connected route
+    void refresh_path_mtu();
+    
+    // Handles a failed send; returns true if the datagram should just be dropped
+    bool recoverable_error(int error);
+
 public:
+    using Network::send;
+    
+    static constexpr size_t kDefaultMtu = 1500;
+    static constexpr size_t kMaxBatch = 64;         // datagrams per flush
+    
+    // Datagrams never exceed mtu_cap, even if the discovered path MTU is larger
+    explicit UDPNetwork(size_t mtu_cap = kDefaultMtu, SendMode mode = SendMode::Segment);
     ~UDPNetwork() override;
     bool connect(const std::string& host, int port) override;
-    bool send(const std::vector<uint8_t>& data) override;
+    bool send(const ConstBuffer* buffers, size_t count) override;
+    bool queue(const ConstBuffer* buffers, size_t count) override;
+    bool flush() override;
+    int send_some(const MessageView* messages, size_t count, size_t& offset) override;
+    int receive(uint8_t* buffer, size_t size) override;
+    size_t max_message_size() const override;
+    SendError classify_send_error(int error) override;
+#ifdef __linux__
+    size_t build_sends(const MessageView* messages, size_t count, size_t offset, struct msghdr** headers,
+                       size_t* covers) override;
+#endif
     void disconnect() override;
+    int fd() const override { return socket_fd_; }
+    
+    size_t path_mtu() const { return path_mtu_; }
+    
+    // Mode in effect after any fallback
+    SendMode send_mode() const { return mode_; }
 };
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "packet.h"
+#include "rtp.h"
+#include <algorithm>
+
+namespace {
+
+void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, static_cast<uint16_t>(value >> 16));
+    put_u16(out + 2, static_cast<uint16_t>(value));
+}
+
+void put_u64(uint8_t* out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+    put_u32(out + 4, static_cast<uint32_t>(value));
+}
+
+uint16_t get_u16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(get_u16(in)) << 16) | get_u16(in + 2);
+}
+
+uint64_t get_u64(const uint8_t* in) {
+    return (static_cast<uint64_t>(get_u32(in)) << 32) | get_u32(in + 4);
+}
+
+} // namespace
+
+PayloadEncoding payload_encoding_for(const CodecConfig& config) {
+    if (config.codec == Codec::Opus) return PayloadEncoding::Opus;
+    
+    switch (config.format) {
+    case SampleFormat::F32: return PayloadEncoding::F32;
+    case SampleFormat::S16: return PayloadEncoding::S16;
+    case SampleFormat::S24: return PayloadEncoding::S24;
+    }
+    return PayloadEncoding::F32;
+}
+
+const char* payload_encoding_name(PayloadEncoding encoding) {
+    switch (encoding) {
+    case PayloadEncoding::F32: return "f32";
+    case PayloadEncoding::S16: return "s16";
+    case PayloadEncoding::S24: return "s24";
+    case PayloadEncoding::Opus: return "opus";
+    }
+    return "unknown";
+}
+
+void PacketHeader::serialize(uint8_t* out) const {
+    put_u16(out, kMagic);
+    out[2] = version;
+    out[3] = flags;
+    put_u32(out + 4, stream_id);
+    put_u32(out + 8, sequence);
+    put_u64(out + 12, timestamp);
+    put_u32(out + 20, sample_rate);
+    out[24] = static_cast<uint8_t>(encoding);
+    out[25] = channels;
+    out[26] = fragment;
+    out[27] = fragment_count;
+    put_u32(out + 28, payload_length);
+}
+
+bool PacketHeader::parse(const uint8_t* in, size_t size, PacketHeader& header) {
+    if (size < kSize || get_u16(in) != kMagic || in[2] != kVersion) return false;
+    
+    header.version = in[2];
+    header.flags = in[3];
+    header.stream_id = get_u32(in + 4);
+    header.sequence = get_u32(in + 8);
+    header.timestamp = get_u64(in + 12);
+    header.sample_rate = get_u32(in + 20);
+    header.encoding = static_cast<PayloadEncoding>(in[24]);
+    header.channels = in[25];
+    header.fragment = in[26];
+    header.fragment_count = in[27];
+    header.payload_length = get_u32(in + 28);
+    return true;
+}
+
+bool Packetizer::configure(size_t max_message, size_t frame_bytes, size_t max_payload, size_t max_packets,
+                           Framing framing) {
+    size_t overhead = 0;
+    if (framing == Framing::Native) {
+        overhead = PacketHeader::kSize;
+    } else if (framing == Framing::Rtp) {
+        overhead = RtpHeader::kSize;
+    }
+    
+    // Nothing changes until the new layout is known to fit
+    size_t max_chunk = max_payload;
+    if (max_message > 0) {
+        if (max_message <= overhead) return false;
+        max_chunk = max_message - overhead;
+        if (frame_bytes > 0) {
+            max_chunk -= max_chunk % frame_bytes;
+        }
+    }
+    if (max_chunk == 0) return false;
+    
+    size_t messages_per_packet = std::max<size_t>(1, (max_payload + max_chunk - 1) / max_chunk);
+    if (frame_bytes == 0 && messages_per_packet > (framing == Framing::Rtp ? 1 : kMaxFragments)) return false;
+    
+    framing_ = framing;
+    frame_bytes_ = frame_bytes;
+    max_chunk_ = max_chunk;
+    messages_per_packet_ = messages_per_packet;
+    size_t max_messages = messages_per_packet_ * std::max<size_t>(1, max_packets);
+    headers_.assign(max_messages * PacketHeader::kSize, 0);
+    parts_.assign(max_messages * 2, ConstBuffer{nullptr, 0});
+    frames_.assign(max_messages, 0);
+    payloads_.assign(max_messages, nullptr);
+    message_count_ = 0;
+    return true;
+}
+
+void Packetizer::set_rtp(uint8_t payload_type, uint32_t clock_scale, uint32_t timestamp_offset) {
+    rtp_payload_type_ = payload_type;
+    rtp_clock_scale_ = clock_scale;
+    rtp_timestamp_offset_ = timestamp_offset;
+    rtp_started_ = false;
+}
+
+size_t Packetizer::add(PacketHeader& header, const EncodedPacket& packet) {
+    const uint8_t* payload = packet.payload.data();
+    size_t remaining = packet.payload.size();
+    if (max_chunk_ == 0) return 0;
+    size_t count = std::max<size_t>(1, (remaining + max_chunk_ - 1) / max_chunk_);
+    if ((message_count_ + count) * 2 > parts_.size()) return 0;
+    
+    // Opaque payloads keep one sequence number and timestamp across fragments
+    bool fragmented = frame_bytes_ == 0 && count > 1;
+    header.fragment_count = static_cast<uint8_t>(fragmented ? count : 1);
+    
+    uint64_t timestamp = packet.timestamp;
+    for (size_t i = 0; i < count; i++) {
+        size_t chunk = std::min(remaining, max_chunk_);
+        size_t index = message_count_ + i;
+        ConstBuffer* message = &parts_[index * 2];
+        size_t part = 0;
+        
+        if (framing_ == Framing::Rtp) {
+            // A talk spurt after DTX silence, or the first packet, starts with the marker set
+            RtpHeader rtp;
+            rtp.marker = !rtp_started_ || timestamp != next_timestamp_;
+            rtp.payload_type = rtp_payload_type_;
+            rtp.sequence = static_cast<uint16_t>(header.sequence++);
+            rtp.timestamp = static_cast<uint32_t>(timestamp * rtp_clock_scale_) + rtp_timestamp_offset_;
+            rtp.ssrc = header.stream_id;
+            uint8_t* bytes = &headers_[index * PacketHeader::kSize];
+            rtp.serialize(bytes);
+            message[part++] = {bytes, RtpHeader::kSize};
+            rtp_started_ = true;
+            next_timestamp_ = timestamp + (frame_bytes_ > 0 ? chunk / frame_bytes_ : packet.frames);
+        } else if (framing_ == Framing::Native) {
+            uint8_t* bytes = &headers_[index * PacketHeader::kSize];
+            header.fragment = static_cast<uint8_t>(fragmented ? i : 0);
+            header.timestamp = timestamp;
+            header.payload_length = static_cast<uint32_t>(chunk);
+            header.serialize(bytes);
+            message[part++] = {bytes, PacketHeader::kSize};
+            if (!fragmented) header.sequence++;
+        }
+        message[part] = {payload, chunk};
+        payloads_[index] = &packet.payload;
+        
+        if (frame_bytes_ > 0) {
+            frames_[index] = static_cast<uint32_t>(chunk / frame_bytes_);
+        } else {
+            frames_[index] = i + 1 == count ? static_cast<uint32_t>(packet.frames) : 0;
+        }
+        
+        payload += chunk;
+        remaining -= chunk;
+        if (frame_bytes_ > 0) timestamp += chunk / frame_bytes_;
+    }
+    
+    if (fragmented && framing_ == Framing::Native) header.sequence++;
+    header.fragment = 0;
+    header.fragment_count = 1;
+    message_count_ += count;
+    return count;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "codec.h"
+#include "network.h"
+#include "pipeline.h"
+
+// Wire framing: every payload is preceded by a fixed 32-byte header. Fields
+// are big-endian; the payload keeps its own byte order (PCM is little-endian).
+//
+//   0  u16  magic 0x4153 ("AS")
+//   2  u8   version
+//   3  u8   flags (PacketHeader::kFlag*)
+//   4  u32  stream id, random per sender unless configured
+//   8  u32  sequence number, +1 per packet
+//  12  u64  timestamp of the first frame, in samples at sample_rate
+//  20  u32  sample rate in Hz
+//  24  u8   payload encoding (PayloadEncoding)
+//  25  u8   channels
+//  26  u8   fragment index
+//  27  u8   fragment count; 0 or 1 means the payload is complete
+//  28  u32  payload length in bytes
+enum class PayloadEncoding : uint8_t {
+    F32 = 0,
+    S16 = 1,
+    S24 = 2,
+    Opus = 16
+};
+
+PayloadEncoding payload_encoding_for(const CodecConfig& config);
+const char* payload_encoding_name(PayloadEncoding encoding);
+
+struct PacketHeader {
+    static constexpr uint16_t kMagic = 0x4153;
+    static constexpr uint8_t kVersion = 1;
+    static constexpr size_t kSize = 32;
+    
+    static constexpr uint8_t kFlagComfortNoise = 0x01;   // DTX keepalive, not captured audio
+    static constexpr uint8_t kFlagFec = 0x02;            // FEC repair datagram (fec.h), not audio
+    static constexpr uint8_t kFlagReport = 0x04;         // receiver report from the relay (feedback.h)
+    
+    uint8_t version = kVersion;
+    uint8_t flags = 0;
+    uint32_t stream_id = 0;
+    uint32_t sequence = 0;
+    uint64_t timestamp = 0;
+    uint32_t sample_rate = 0;
+    PayloadEncoding encoding = PayloadEncoding::F32;
+    uint8_t channels = 1;
+    uint8_t fragment = 0;
+    uint8_t fragment_count = 1;
+    uint32_t payload_length = 0;
+    
+    // Writes exactly kSize bytes
+    void serialize(uint8_t* out) const;
+    
+    // Returns false on short input, bad magic or an unknown version
+    static bool parse(const uint8_t* in, size_t size, PacketHeader& header);
+};
+
+// What precedes each payload on the wire
+enum class Framing {
+    Raw,        // nothing (--raw, legacy receivers)
+    Native,     // PacketHeader
+    Rtp         // RTP fixed header (rtp.h); payloads are never fragmented
+};
+
+// Splits encoded packets into datagrams no larger than the path allows, each
+// with its own header. PCM splits on frame boundaries into independent
+// packets with their own sequence number and timestamp, so a lost datagram
+// costs only the frames it carried. Opaque codec payloads that do not fit are
+// sent as fragments sharing one sequence number. Messages accumulate across
+// add() calls until clear(), so one captured frame can go out as one batch.
+class Packetizer {
+public:
+    static constexpr size_t kMaxFragments = 255;
+    
+    // max_message: largest datagram including the header, 0 for no limit.
+    // frame_bytes: bytes per PCM frame, 0 for codecs that cannot be cut.
+    // max_payload, max_packets: largest payload and packets per batch the pipeline produces.
+    bool configure(size_t max_message, size_t frame_bytes, size_t max_payload, size_t max_packets,
+                   Framing framing);
+    
+    // RTP framing: payload type, RTP clock ticks per wire-rate sample and the
+    // random offset added to every timestamp. The RTP sequence number is the
+    // low 16 bits of PacketHeader::sequence, the SSRC its stream_id.
+    void set_rtp(uint8_t payload_type, uint32_t clock_scale, uint32_t timestamp_offset);
+    
+    // Starts a new batch
+    void clear() { message_count_ = 0; }
+    
+    // Splits one packet into the batch, advancing header.sequence; returns messages added
+    size_t add(PacketHeader& header, const EncodedPacket& packet);
+    
+    // Parts of message i of the batch, to pass to Network::send or Network::queue
+    size_t message_count() const { return message_count_; }
+    const ConstBuffer* parts(size_t index) const { return &parts_[index * 2]; }
+    size_t part_count() const { return framing_ == Framing::Raw ? 1 : 2; }
+    
+    // Audio frames message i carries; fragments count only on the last piece
+    uint32_t message_frames(size_t index) const { return frames_[index]; }
+    
+    // The shared payload message i's last part points into, for Connection::submit
+    const SharedBuffer& message_payload(size_t index) const { return *payloads_[index]; }
+    
+    // Payload bytes per message after the header
+    size_t max_chunk() const { return max_chunk_; }
+
+private:
+    size_t max_chunk_ = 0;
+    size_t frame_bytes_ = 0;
+    size_t messages_per_packet_ = 0;
+    size_t message_count_ = 0;
+    Framing framing_ = Framing::Native;
+    
+    // RTP state: the marker bit flags the first packet after a timestamp gap
+    uint8_t rtp_payload_type_ = 0;
+    uint32_t rtp_clock_scale_ = 1;
+    uint32_t rtp_timestamp_offset_ = 0;
+    uint64_t next_timestamp_ = 0;
+    bool rtp_started_ = false;
+    
+    std::vector<uint8_t> headers_;      // PacketHeader::kSize bytes per message
+    std::vector<ConstBuffer> parts_;    // header and payload per message
+    std::vector<uint32_t> frames_;
+    std::vector<const SharedBuffer*> payloads_;
+};
@@ -0,0 +1,205 @@
+#include "pipeline.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+// Keepalive packets carry this many frames of noise at the estimated floor,
+// or one codec frame for codecs with a fixed frame size
+constexpr size_t kComfortNoiseFrames = 16;
+
+// Codec frame durations rate control may switch between; buffers fit all of them
+constexpr int kShortestCodecFrameMs = 10;
+constexpr int kLongestCodecFrameMs = 40;
+
+// Payload blocks ready at start, in batches of max_packets; send queues holding more grow the pool
+constexpr size_t kPreallocatedBatches = 4;
+
+} // namespace
+
+bool SendPipeline::configure(const PipelineConfig& config) {
+    config_ = config;
+    config_.codec.sample_rate = config.wire_rate;
+    config_.codec.channels = config.channels;
+    
+    if (!resampler_.configure(config.capture_rate, config.wire_rate, config.channels, config.max_frames)) {
+        std::cerr << "Unsupported resampling ratio " << config.capture_rate << " -> "
+                  << config.wire_rate << " Hz" << std::endl;
+        return false;
+    }
+    
+    encoder_ = AudioEncoder::create(config_.codec);
+    if (!encoder_) return false;
+    
+    size_t max_frames = resampler_.max_output_frames(config.max_frames);
+    resampled_.assign(max_frames * config.channels, 0.0f);
+    
+    // A captured frame can complete several codec frames plus one keepalive
+    size_t codec_frames = 0;
+    size_t shortest_codec_frames = 0;
+    if (encoder_->frame_size() > 0) {
+        codec_frames = std::max<size_t>(encoder_->frame_size(),
+                                        static_cast<size_t>(config.wire_rate) * kLongestCodecFrameMs / 1000);
+        shortest_codec_frames = std::min<size_t>(encoder_->frame_size(),
+                                                 static_cast<size_t>(config.wire_rate) * kShortestCodecFrameMs / 1000);
+    }
+    size_t packet_frames = codec_frames > 0 ? codec_frames : max_frames;
+    size_t max_packets = codec_frames > 0 ? max_frames / shortest_codec_frames + 2 : 1;
+    max_payload_bytes_ = encoder_->max_payload_bytes(packet_frames);
+    packets_.assign(max_packets, EncodedPacket());
+    size_t period_frames = static_cast<size_t>(static_cast<uint64_t>(config.max_frames) * config.wire_rate /
+                                               config.capture_rate);
+    min_packet_frames_ = std::max<size_t>(1, codec_frames > 0 ? shortest_codec_frames : period_frames);
+    payload_pool_.configure(max_payload_bytes_, max_packets * kPreallocatedBatches);
+    packet_count_ = 0;
+    
+    codec_frame_.assign(codec_frames * config.channels, 0.0f);
+    codec_fill_ = 0;
+    pending_frame_ms_ = 0;
+    
+    VadConfig vad_config;
+    vad_config.sample_rate = config.wire_rate;
+    vad_config.hangover_ms = config.vad_hangover_ms;
+    vad_.configure(vad_config, max_frames);
+    comfort_noise_.assign((codec_frames > 0 ? codec_frames : kComfortNoiseFrames) * config.channels, 0.0f);
+    frames_since_send_ = 0;
+    wire_time_ = 0;
+    return true;
+}
+
+void SendPipeline::reserve_payloads(uint64_t queued_frames) {
+    // Each queued packet holds a block, plus the batches kept on hand
+    size_t blocks = static_cast<size_t>(queued_frames / min_packet_frames_) + 1;
+    payload_pool_.reserve(blocks + packets_.size() * kPreallocatedBatches);
+}
+
+size_t SendPipeline::process(const FrameRingBuffer::Frame& frame) {
+    const float* samples = frame.samples.data();
+    size_t frames = frame.frames;
+    packet_count_ = 0;
+    
+    if (!resampler_.is_passthrough()) {
+        frames = resampler_.process(samples, frames, resampled_.data());
+        samples = resampled_.data();
+    }
+    if (frames == 0) return 0;
+    stats_.frames_in++;
+    
+    uint64_t start_time = wire_time_;
+    wire_time_ += frames;
+    
+    if (config_.dtx && !vad_.process(samples, frames, config_.channels)) {
+        frames_since_send_ += frames;
+        stats_.frames_suppressed++;
+        
+        // A talk spurt's unfinished codec frame is dropped with the silence
+        codec_fill_ = 0;
+        
+        size_t saved = encoder_->estimated_bytes(frames);
+        uint64_t keepalive_frames = static_cast<uint64_t>(config_.keepalive_ms) * config_.wire_rate / 1000;
+        if (frames_since_send_ < keepalive_frames) {
+            stats_.bytes_saved += saved;
+            return 0;
+        }
+        
+        apply_frame_ms();
+        size_t noise_frames = encoder_->frame_size() > 0 ? encoder_->frame_size() : kComfortNoiseFrames;
+        build_keepalive(noise_frames);
+        if (!emit(comfort_noise_.data(), noise_frames, start_time, true)) {
+            return 0;
+        }
+        size_t sent = packets_[0].payload.size();
+        stats_.bytes_saved += saved > sent ? saved - sent : 0;
+        stats_.keepalives++;
+        frames_since_send_ = 0;
+        return packet_count_;
+    }
+    
+    if (encoder_->frame_size() == 0) {
+        emit(samples, frames, start_time, false);
+    } else {
+        encode_active(samples, frames);
+    }
+    frames_since_send_ = 0;
+    return packet_count_;
+}
+
+void SendPipeline::encode_active(const float* samples, size_t frames) {
+    const int channels = config_.channels;
+    uint64_t time = wire_time_ - frames;
+    
+    while (frames > 0) {
+        if (codec_fill_ == 0) {
+            apply_frame_ms();
+            codec_timestamp_ = time;
+        }
+        
+        const size_t frame_size = encoder_->frame_size();
+        size_t take = std::min(frames, frame_size - codec_fill_);
+        std::memcpy(&codec_frame_[codec_fill_ * channels], samples, take * channels * sizeof(float));
+        codec_fill_ += take;
+        samples += take * channels;
+        frames -= take;
+        time += take;
+        
+        if (codec_fill_ == frame_size) {
+            emit(codec_frame_.data(), frame_size, codec_timestamp_, false);
+            codec_fill_ = 0;
+        }
+    }
+}
+
+size_t SendPipeline::max_payload_bytes() const {
+    if (payload_limit_ > 0 && encoder_->bytes_per_frame() == 0) {
+        return std::min(max_payload_bytes_, payload_limit_);
+    }
+    return max_payload_bytes_;
+}
+
+bool SendPipeline::emit(const float* samples, size_t frames, uint64_t timestamp, bool keepalive) {
+    if (packet_count_ == packets_.size()) return false;
+    
+    // A fresh block each time: the previous one may still be queued for sending
+    EncodedPacket& packet = packets_[packet_count_];
+    packet.payload = payload_pool_.acquire();
+    packet.payload.resize(max_payload_bytes());
+    size_t bytes = encoder_->encode(samples, frames, packet.payload.data(), packet.payload.size());
+    if (bytes == 0) return false;
+    
+    packet.payload.resize(bytes);
+    packet.frames = frames;
+    packet.timestamp = timestamp;
+    packet.keepalive = keepalive;
+    packet_count_++;
+    return true;
+}
+
+void SendPipeline::set_vad_hangover(int hangover_ms) {
+    config_.vad_hangover_ms = hangover_ms;
+    vad_.set_hangover_ms(hangover_ms);
+}
+
+void SendPipeline::apply_frame_ms() {
+    if (pending_frame_ms_ == 0) return;
+    
+    size_t frames = static_cast<size_t>(config_.wire_rate) * pending_frame_ms_ / 1000;
+    if (frames * config_.channels <= codec_frame_.size() && encoder_->set_frame_ms(pending_frame_ms_)) {
+        config_.codec.frame_ms = pending_frame_ms_;
+    }
+    pending_frame_ms_ = 0;
+}
+
+void SendPipeline::build_keepalive(size_t frames) {
+    // Uniform noise in [-a, a] has RMS a / sqrt(3)
+    float amplitude = std::pow(10.0f, vad_.noise_floor_db() / 20.0f) * std::sqrt(3.0f);
+    
+    for (size_t i = 0; i < frames * config_.channels; i++) {
+        float& sample = comfort_noise_[i];
+        noise_state_ ^= noise_state_ << 13;
+        noise_state_ ^= noise_state_ >> 17;
+        noise_state_ ^= noise_state_ << 5;
+        sample = amplitude * (static_cast<float>(noise_state_) / 2147483648.0f - 1.0f);
+    }
+}
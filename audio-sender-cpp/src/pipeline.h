@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ring_buffer.h"
+#include "resampler.h"
+#include "codec.h"
+#include "vad.h"
+#include "shared_buffer.h"
+
+struct PipelineConfig {
+    int capture_rate = 16000;   // rate the device delivers
+    int wire_rate = 16000;      // rate sent on the wire
+    int channels = 1;
+    size_t max_frames = 1024;   // largest captured frame, in frames
+    
+    // Codec, wire format and codec parameters; rate and channels are filled in from above
+    CodecConfig codec;
+    
+    // Discontinuous transmission: suppress frames the VAD classifies as silence
+    bool dtx = false;
+    int vad_hangover_ms = 300;
+    int keepalive_ms = 500;         // comfort-noise packet interval during silence
+};
+
+struct PipelineStats {
+    std::atomic<uint64_t> frames_in{0};
+    std::atomic<uint64_t> frames_suppressed{0};
+    std::atomic<uint64_t> keepalives{0};
+    std::atomic<uint64_t> bytes_saved{0};   // payload bytes DTX did not send
+};
+
+// One wire payload produced by the pipeline. The payload is pooled and
+// reference counted, so send queues can hold on to it without a copy.
+struct EncodedPacket {
+    SharedBuffer payload;
+    size_t frames = 0;          // audio frames the payload covers
+    uint64_t timestamp = 0;     // wire-rate sample clock of the first frame
+    bool keepalive = false;     // comfort noise rather than captured audio
+};
+
+// Turns captured frames into wire payloads on the sender thread:
+// resample to the wire rate, drop silence (DTX), reframe to the codec frame
+// size, then encode. One captured frame can yield zero or more packets.
+// All buffers are sized in configure(); payload blocks come from a pool
+// that only grows while send queues hold more of them than ever before.
+class SendPipeline {
+public:
+    bool configure(const PipelineConfig& config);
+    
+    // Runs one frame through the stages; returns the number of packets ready to send
+    size_t process(const FrameRingBuffer::Frame& frame);
+    
+    // Packets from the last process(), index < its return value
+    const EncodedPacket& packet(size_t index) const { return packets_[index]; }
+    
+    const PipelineConfig& config() const { return config_; }
+    const PipelineStats& stats() const { return stats_; }
+    const AudioEncoder& encoder() const { return *encoder_; }
+    
+    // Largest payload a single packet can carry
+    size_t max_payload_bytes() const;
+    
+    // Caps packets of codecs that cannot be cut on frame boundaries (Opus),
+    // so each fits one datagram when the framing cannot fragment; 0 for no cap
+    void limit_payload(size_t bytes) { payload_limit_ = bytes; }
+    
+    // Switches the encoder to a cheaper payload under congestion; 0 restores full quality
+    void set_downgrade(int level) { encoder_->set_downgrade(level); }
+    int max_downgrade() const { return encoder_->max_downgrade(); }
+    
+    // Rate control: codec bitrate, codec frame duration and DTX hangover. A
+    // new frame duration starts at the next codec frame boundary.
+    bool set_bitrate(int bitrate) { return encoder_->set_bitrate(bitrate); }
+    void set_frame_ms(int frame_ms) { pending_frame_ms_ = frame_ms; }
+    void set_vad_hangover(int hangover_ms);
+    
+    // Most packets a single process() call can return
+    size_t max_packets() const { return packets_.size(); }
+    
+    // Payload blocks allocated so far
+    size_t payload_blocks() const { return payload_pool_.allocated(); }
+    
+    // Allocates payload blocks for send queues holding queued_frames of
+    // audio in total, so filling them does not allocate while streaming
+    void reserve_payloads(uint64_t queued_frames);
+
+private:
+    // Encodes and appends a packet; returns false if the encoder failed
+    bool emit(const float* samples, size_t frames, uint64_t timestamp, bool keepalive);
+    
+    // Feeds active audio through the codec-frame accumulator
+    void encode_active(const float* samples, size_t frames);
+    
+    // Applies a frame duration from set_frame_ms(); only between codec frames
+    void apply_frame_ms();
+    
+    void build_keepalive(size_t frames);
+    
+    PipelineConfig config_;
+    Resampler resampler_;
+    std::unique_ptr<AudioEncoder> encoder_;
+    VoiceActivityDetector vad_;
+    PipelineStats stats_;
+    
+    // Wire-rate sample clock of the next resampled frame
+    uint64_t wire_time_ = 0;
+    
+    // Wire-rate frames since the last packet sent, for the keepalive timer
+    uint64_t frames_since_send_ = 0;
+    uint32_t noise_state_ = 0x2545F491u;
+    
+    std::vector<float> resampled_;
+    std::vector<float> comfort_noise_;
+    
+    // Partial codec frame carried between captured frames
+    std::vector<float> codec_frame_;
+    size_t codec_fill_ = 0;
+    uint64_t codec_timestamp_ = 0;
+    int pending_frame_ms_ = 0;
+    
+    BufferPool payload_pool_;
+    std::vector<EncodedPacket> packets_;
+    size_t packet_count_ = 0;
+    size_t max_payload_bytes_ = 0;
+    size_t payload_limit_ = 0;
+    size_t min_packet_frames_ = 1;      // shortest packet at the configured period, for reserve_payloads()
+};
@@ -0,0 +1,106 @@
+#include "rate_control.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Loss bands in the style of WebRTC's loss-based controller: below the
+// first the bitrate may grow, above the second it must shrink
+constexpr double kLossIncrease = 0.02;
+constexpr double kLossDecrease = 0.10;
+constexpr double kLossSmoothing = 0.3;
+
+// Queueing delay worth backing off for: RTT above its recent minimum, or relay backlog
+constexpr double kQueueDelayLimitMs = 60.0;
+constexpr double kRelayQueueLimitMs = 100.0;
+constexpr size_t kRttWindow = 30;
+constexpr double kRttSmoothing = 0.125;     // as TCP's SRTT
+
+constexpr double kIncreaseFactor = 1.08;
+constexpr double kDelayDecreaseFactor = 0.85;
+
+// Clean reports in a row before congestion is over
+constexpr int kRecoveryReports = 3;
+
+// FEC overhead range and how it follows loss: 10% on a clean path, +2% per 1% loss
+constexpr int kMinFecOverhead = 10;
+constexpr int kMaxFecOverhead = 50;
+
+// Opus frames used under congestion, and the talk-spurt tail DTX keeps
+constexpr int kLongFrameMs = 40;
+constexpr int kCongestedHangoverMs = 100;
+
+} // namespace
+
+RateController::RateController(const RateControlConfig& config) : config_(config) {
+    decision_.bitrate = config.max_bitrate;
+    decision_.frame_ms = config.frame_ms;
+    decision_.fec_overhead = config.fec ? config.fec_overhead : 0;
+    decision_.hangover_ms = config.dtx ? config.hangover_ms : 0;
+}
+
+bool RateController::loss_congested(const PathFeedback& feedback) const {
+    return feedback.loss > kLossDecrease;
+}
+
+bool RateController::delay_congested(const PathFeedback& feedback) {
+    bool queueing = feedback.queue_ms > kRelayQueueLimitMs;
+    if (feedback.rtt_ms >= 0.0) {
+        rtts_.push_back(feedback.rtt_ms);
+        if (rtts_.size() > kRttWindow) {
+            rtts_.pop_front();
+        }
+        srtt_ = srtt_ < 0.0 ? feedback.rtt_ms : srtt_ + kRttSmoothing * (feedback.rtt_ms - srtt_);
+        double baseline = *std::min_element(rtts_.begin(), rtts_.end());
+        queueing = queueing || srtt_ - baseline > kQueueDelayLimitMs;
+    }
+    return queueing;
+}
+
+bool RateController::update(const PathFeedback& feedback) {
+    RateDecision previous = decision_;
+    smoothed_loss_ += kLossSmoothing * (feedback.loss - smoothed_loss_);
+    
+    bool lossy = loss_congested(feedback);
+    bool queueing = delay_congested(feedback);
+    if (lossy || queueing) {
+        congested_ = true;
+        clean_reports_ = 0;
+    } else if (congested_ && ++clean_reports_ >= kRecoveryReports) {
+        congested_ = false;
+    }
+    
+    if (config_.max_bitrate > 0) {
+        double bitrate = decision_.bitrate;
+        if (lossy) {
+            bitrate *= std::max(0.5, 1.0 - 0.5 * feedback.loss);
+        } else if (queueing) {
+            bitrate *= kDelayDecreaseFactor;
+        } else if (feedback.loss < kLossIncrease && !congested_) {
+            bitrate *= kIncreaseFactor;
+        }
+        decision_.bitrate = std::clamp(static_cast<int>(bitrate), config_.min_bitrate, config_.max_bitrate);
+    }
+    
+    // Longer frames below half the ceiling, back above three quarters
+    if (config_.frame_ms > 0 && config_.frame_ms < kLongFrameMs && config_.max_bitrate > 0) {
+        if (decision_.bitrate <= config_.max_bitrate / 2) {
+            long_frames_ = true;
+        } else if (decision_.bitrate >= config_.max_bitrate * 3 / 4) {
+            long_frames_ = false;
+        }
+        decision_.frame_ms = long_frames_ ? kLongFrameMs : config_.frame_ms;
+    }
+    
+    if (config_.fec && !queueing) {
+        int target = kMinFecOverhead + static_cast<int>(std::lround(200.0 * smoothed_loss_));
+        decision_.fec_overhead = std::clamp(target, kMinFecOverhead, kMaxFecOverhead);
+    }
+    
+    if (config_.dtx) {
+        decision_.hangover_ms = congested_ ? std::min(config_.hangover_ms, kCongestedHangoverMs) : config_.hangover_ms;
+    }
+    
+    return decision_.bitrate != previous.bitrate || decision_.frame_ms != previous.frame_ms ||
+           decision_.fec_overhead != previous.fec_overhead || decision_.hangover_ms != previous.hangover_ms;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+#include "feedback.h"
+
+struct RateControlConfig {
+    int max_bitrate = 0;        // configured Opus bitrate, the ceiling; 0 if the codec has none
+    int min_bitrate = 6000;
+    int frame_ms = 0;           // configured Opus frame duration; 0 if the codec has none
+    bool fec = false;
+    int fec_overhead = 25;      // starting point
+    bool dtx = false;
+    int hangover_ms = 300;      // configured VAD hangover
+};
+
+// Settings the controller asks for; 0 means the knob is not in use
+struct RateDecision {
+    int bitrate = 0;
+    int frame_ms = 0;
+    int fec_overhead = 0;
+    int hangover_ms = 0;
+};
+
+// Adjusts the stream to what receiver reports say about the path. Loss and
+// queueing delay (smoothed RTT above its recent minimum, or a growing relay
+// backlog) mark the path congested: the bitrate backs off, Opus moves to
+// longer frames to save header overhead, and DTX ends talk spurts sooner. A
+// clean path ramps back up to the configured settings. FEC follows the
+// smoothed loss rate, but only loss without queueing raises it; more repair
+// traffic would only deepen congestion loss.
+class RateController {
+public:
+    explicit RateController(const RateControlConfig& config);
+    
+    // Feeds one report; returns true if the decision changed
+    bool update(const PathFeedback& feedback);
+    
+    const RateDecision& decision() const { return decision_; }
+    bool congested() const { return congested_; }
+
+private:
+    // Congestion from the latest report; also tracks the RTT baseline
+    bool loss_congested(const PathFeedback& feedback) const;
+    bool delay_congested(const PathFeedback& feedback);
+    
+    RateControlConfig config_;
+    RateDecision decision_;
+    
+    double smoothed_loss_ = 0.0;
+    std::deque<double> rtts_;       // recent RTT samples for the baseline
+    double srtt_ = -1.0;
+    bool congested_ = false;
+    int clean_reports_ = 0;
+    bool long_frames_ = false;
+};
@@ -0,0 +1,989 @@
+#include "relay.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace {
+
+// Reports, idle expiry and the epoll timeout all run on this tick
+constexpr auto kTick = std::chrono::milliseconds(1000);
+
+// Reads per readiness event, so one busy client cannot starve the others
+constexpr int kMaxReadsPerEvent = 16;
+constexpr int kMaxEvents = 64;
+constexpr int kListenBacklog = 128;
+
+// A header claiming more than this means the stream is not header-framed
+constexpr size_t kMaxPacketBytes = 1 << 20;
+
+// TCP read blocks. A block is refilled until less than kMinReadBytes is
+// left, so a block pinned by a slow listener holds mostly relayed bytes.
+constexpr size_t kBlockBytes = 64 * 1024;
+constexpr size_t kMinReadBytes = kBlockBytes / 4;
+constexpr size_t kPreallocatedBlocks = 16;
+
+// Both directions of the UDP socket; the default is a few hundred datagrams
+constexpr int kUdpBufferBytes = 4 << 20;
+
+// A receive slot holds the largest datagram, or the largest run GRO hands over
+constexpr size_t kUdpSlotBytes = 65536;
+constexpr size_t kGroControlBytes = CMSG_SPACE(sizeof(int));
+
+constexpr auto kResolveTimeout = std::chrono::seconds(2);
+
+// Messages in flight from one shard to another. Packets leave a quarter of
+// the slots free, so a client joining or leaving always gets through.
+constexpr size_t kMailboxSlots = 4096;
+constexpr size_t kControlSlots = kMailboxSlots / 4;
+
+// Mix mode: stream id of the mixed packets, and how many missed frames a
+// late wake-up still mixes before skipping ahead
+constexpr uint32_t kMixStreamId = 0x4D495800;   // "MIX"
+constexpr int kMaxMixCatchUp = 5;
+
+// Address and port, so a client is found whatever padding the kernel leaves
+std::string address_key(const struct sockaddr_storage& address) {
+    if (address.ss_family == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(&address);
+        return std::string(reinterpret_cast<const char*>(&in6->sin6_port), sizeof(in6->sin6_port)) +
+               std::string(reinterpret_cast<const char*>(&in6->sin6_addr), sizeof(in6->sin6_addr));
+    }
+    const auto* in = reinterpret_cast<const struct sockaddr_in*>(&address);
+    return std::string(reinterpret_cast<const char*>(&in->sin_port), sizeof(in->sin_port)) +
+           std::string(reinterpret_cast<const char*>(&in->sin_addr), sizeof(in->sin_addr));
+}
+
+// GRO hands over a run of same-size datagrams from one sender as one
+// buffer, with the size of each in a control message
+size_t gro_segment_size(struct msghdr& header, size_t size) {
+    for (struct cmsghdr* control = CMSG_FIRSTHDR(&header); control; control = CMSG_NXTHDR(&header, control)) {
+        if (control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO) {
+            int segment = 0;
+            std::memcpy(&segment, CMSG_DATA(control), sizeof(segment));
+            if (segment > 0) return static_cast<size_t>(segment);
+        }
+    }
+    return size;
+}
+
+bool parse_framed(const uint8_t* data, size_t size, PacketHeader& header) {
+    return PacketHeader::parse(data, size, header) && header.payload_length <= kMaxPacketBytes - PacketHeader::kSize;
+}
+
+std::string address_name(const struct sockaddr_storage& address, socklen_t length) {
+    ResolvedAddress resolved;
+    resolved.storage = address;
+    resolved.length = length;
+    return resolved.to_string();
+}
+
+bool resolve_bind_address(const std::string& host, int port, ResolvedAddress& address) {
+    std::vector<ResolvedAddress> addresses;
+    if (!Resolver::instance().resolve(host, port, addresses, kResolveTimeout)) return false;
+    address = addresses[0];
+    return true;
+}
+
+// Non-blocking socket bound to address; IPv6 sockets take IPv4 clients too.
+// Shards share the port with SO_REUSEPORT, and the kernel spreads
+// connections and UDP flows over them by address hash.
+int bind_socket(const ResolvedAddress& address, int type, bool reuse_port) {
+    int fd = socket(address.family(), type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (address.family() == AF_INET6) {
+        int v6only = 0;
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only));
+    }
+    if (bind(fd, address.address(), address.length) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+ShardMailbox::ShardMailbox(size_t capacity) : slots_(capacity) {
+}
+
+ShardMessage* ShardMailbox::reserve(size_t keep_free) {
+    uint64_t write = write_pos_.load(std::memory_order_relaxed);
+    uint64_t read = read_pos_.load(std::memory_order_acquire);
+    if (write - read + keep_free >= slots_.size()) return nullptr;
+    return &slots_[write % slots_.size()];
+}
+
+void ShardMailbox::commit() {
+    write_pos_.store(write_pos_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+ShardMessage* ShardMailbox::front() {
+    uint64_t read = read_pos_.load(std::memory_order_relaxed);
+    if (read == write_pos_.load(std::memory_order_acquire)) return nullptr;
+    return &slots_[read % slots_.size()];
+}
+
+void ShardMailbox::pop() {
+    read_pos_.store(read_pos_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+Relay::Relay(const RelayConfig& config) : config_(config) {
+    // Every stream has to reach the one mixer
+    if (config_.mix) {
+        config_.threads = 1;
+    } else if (config_.threads <= 0) {
+        config_.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < config_.threads; i++) {
+        shards_.push_back(std::make_unique<RelayShard>(config_, static_cast<size_t>(i), shards_));
+    }
+}
+
+Relay::~Relay() {
+    stop();
+}
+
+bool Relay::start() {
+    // Every shard joins the SO_REUSEPORT group before any of them runs
+    for (auto& shard : shards_) {
+        if (!shard->start()) return false;
+    }
+    for (auto& shard : shards_) {
+        threads_.emplace_back(&RelayShard::run, shard.get());
+    }
+    return true;
+}
+
+void Relay::stop() {
+    for (auto& shard : shards_) {
+        shard->stop();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+const RelayStats& Relay::shard_stats(size_t index) const {
+    return shards_[index]->stats();
+}
+
+RelayShard::RelayShard(const RelayConfig& config, size_t index,
+                       const std::vector<std::unique_ptr<RelayShard>>& shards)
+    : config_(config), index_(index), shards_(shards), posted_(static_cast<size_t>(config.threads), false),
+      messages_(UDPNetwork::kMaxBatch), parts_(UDPNetwork::kMaxBatch) {
+    pool_.configure(kBlockBytes, kPreallocatedBlocks);
+    large_pool_.configure(kMaxPacketBytes, 0);
+    report_pool_.configure(ReceptionStats::kReportSize, 0);
+    recovered_pool_.configure(kUdpSlotBytes, 0);
+    if (config.mix) {
+        mixer_ = std::make_unique<Mixer>(config.mixer);
+        mix_pool_.configure(PacketHeader::kSize + mixer_->frame_bytes(), kPreallocatedBlocks);
+    }
+    
+    // No mailbox from a shard to itself
+    for (int i = 0; i < config.threads; i++) {
+        inbox_.push_back(static_cast<size_t>(i) == index ? nullptr : std::make_unique<ShardMailbox>(kMailboxSlots));
+    }
+}
+
+RelayShard::~RelayShard() {
+    tcp_clients_.clear();
+    for (int fd : {tcp_fd_, udp_fd_, wake_fd_, epoll_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool RelayShard::start() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        std::cerr << "Failed to create event loop" << std::endl;
+        return false;
+    }
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+    
+    if (config_.tcp_port > 0 && !open_tcp()) return false;
+    if (config_.udp_port > 0 && !open_udp()) return false;
+    
+    next_tick_ = Clock::now() + kTick;
+    next_mix_ = Clock::now();
+    running_ = true;
+    return true;
+}
+
+bool RelayShard::open_tcp() {
+    ResolvedAddress address;
+    if (!resolve_bind_address(config_.bind_address, config_.tcp_port, address)) return false;
+    tcp_fd_ = bind_socket(address, SOCK_STREAM, config_.threads > 1);
+    if (tcp_fd_ < 0 || listen(tcp_fd_, kListenBacklog) < 0) {
+        std::cerr << "Failed to listen on TCP " << address.to_string() << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = tcp_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, tcp_fd_, &event);
+    if (config_.verbose && index_ == 0) {
+        std::cout << "[TCP] Relay listening on " << address.to_string() << std::endl;
+    }
+    return true;
+}
+
+bool RelayShard::open_udp() {
+    ResolvedAddress address;
+    if (!resolve_bind_address(config_.bind_address, config_.udp_port, address)) return false;
+    udp_fd_ = bind_socket(address, SOCK_DGRAM, config_.threads > 1);
+    if (udp_fd_ < 0) {
+        std::cerr << "Failed to bind UDP " << address.to_string() << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    int size = kUdpBufferBytes;
+    setsockopt(udp_fd_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(udp_fd_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    
+    // UDP_GRO needs Linux 5.0; without it every datagram is a slot of its own
+    if (config_.udp_gro) {
+        int enable = 1;
+        gro_ = setsockopt(udp_fd_, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    }
+    
+    size_t batch = std::max<size_t>(1, config_.udp_batch);
+    receive_buffer_.resize(batch * kUdpSlotBytes);
+    receive_messages_.resize(batch);
+    receive_parts_.resize(batch);
+    receive_addresses_.resize(batch);
+    receive_control_.resize(batch * kGroControlBytes);
+    for (size_t i = 0; i < batch; i++) {
+        receive_parts_[i].iov_base = receive_buffer_.data() + i * kUdpSlotBytes;
+        receive_parts_[i].iov_len = kUdpSlotBytes;
+        struct msghdr& header = receive_messages_[i].msg_hdr;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_name = &receive_addresses_[i];
+        header.msg_iov = &receive_parts_[i];
+        header.msg_iovlen = 1;
+        header.msg_control = gro_ ? receive_control_.data() + i * kGroControlBytes : nullptr;
+    }
+    
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = udp_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, udp_fd_, &event);
+    if (config_.verbose && index_ == 0) {
+        std::cout << "[UDP] Relay listening on " << address.to_string() << (gro_ ? " (GRO)" : "") << std::endl;
+    }
+    return true;
+}
+
+void RelayShard::stop() {
+    running_ = false;
+    if (wake_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd_, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void RelayShard::run() {
+    struct epoll_event events[kMaxEvents];
+    
+    while (running_) {
+        auto now = Clock::now();
+        auto wake = mixer_ ? std::min(next_tick_, next_mix_) : next_tick_;
+        int timeout = static_cast<int>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count() + 1));
+        int ready = epoll_wait(epoll_fd_, events, kMaxEvents, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        
+        now = Clock::now();
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t value;
+                ssize_t drained = read(wake_fd_, &value, sizeof(value));
+                (void)drained;
+                drain_mailboxes(now);
+            } else if (fd == tcp_fd_) {
+                accept_clients();
+            } else if (fd == udp_fd_) {
+                read_udp(now);
+            } else {
+                auto found = tcp_clients_.find(fd);
+                if (found == tcp_clients_.end() || found->second->failed) continue;
+                TcpClient& client = *found->second;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    read_tcp(client, now);
+                }
+                if ((events[i].events & EPOLLOUT) && !client.failed) {
+                    flush(client);
+                }
+            }
+        }
+        
+        if (now >= next_tick_) {
+            send_reports(now);
+            expire_udp_clients(now);
+            next_tick_ = std::max(next_tick_ + kTick, now);
+        }
+        
+        // A frame per frame_ms; after a long stall the mix skips ahead rather than bursting
+        if (mixer_) {
+            auto frame = std::chrono::milliseconds(mixer_->config().frame_ms);
+            for (int rounds = 0; now >= next_mix_ && rounds < kMaxMixCatchUp; rounds++) {
+                mix_round();
+                next_mix_ += frame;
+            }
+            if (now >= next_mix_) {
+                next_mix_ = now + frame;
+            }
+        }
+        
+        // Whatever this round queued goes out in one write per listener
+        flush_pending();
+        wake_peers();
+        for (int fd : to_close_) {
+            close_tcp(fd);
+        }
+        to_close_.clear();
+    }
+}
+
+void RelayShard::accept_clients() {
+    while (true) {
+        struct sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        int fd = accept4(tcp_fd_, reinterpret_cast<struct sockaddr*>(&address), &length,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[TCP] Accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        
+        // Packets are small and latency-bound
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        
+        auto client = std::make_unique<TcpClient>();
+        client->network.attach(fd, address_name(address, length));
+        client->participant = next_participant_++;
+        
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) continue;
+        
+        if (config_.verbose) {
+            std::cout << "[TCP] Client connected: " << client->network.remote_address() << std::endl;
+        }
+        tcp_clients_[fd] = std::move(client);
+        stats_.tcp_clients = static_cast<uint32_t>(tcp_clients_.size());
+    }
+}
+
+void RelayShard::read_tcp(TcpClient& client, Clock::time_point now) {
+    for (int reads = 0; reads < kMaxReadsPerEvent; reads++) {
+        prepare_block(client);
+        size_t room = client.block.capacity() - client.filled;
+        int received = client.network.receive(client.block.data() + client.filled, room);
+        stats_.receives++;
+        if (received < 0) {
+            client.failed = true;
+            to_close_.push_back(client.network.fd());
+            return;
+        }
+        if (received == 0) return;
+        
+        stats_.bytes_in += static_cast<uint64_t>(received);
+        client.filled += static_cast<size_t>(received);
+        parse_frames(client, now);
+        if (static_cast<size_t>(received) < room) return;
+    }
+}
+
+void RelayShard::prepare_block(TcpClient& client) {
+    // Keep reading into the current block while the split packet fits and
+    // the room left is worth a read; a large block only while it is needed
+    size_t capacity = client.block.capacity();
+    size_t pending = client.filled - client.used;
+    bool fits = client.block && capacity - client.used >= client.needs;
+    bool roomy = capacity - client.filled >= kMinReadBytes && (capacity <= kBlockBytes || client.needs > kBlockBytes);
+    if (fits && (roomy || pending > 0)) return;
+    
+    // Only the start of a split packet is copied
+    SharedBuffer block = client.needs > kBlockBytes ? large_pool_.acquire() : pool_.acquire();
+    if (pending > 0) {
+        std::memcpy(block.data(), client.block.data() + client.used, pending);
+    }
+    client.block = std::move(block);
+    client.used = 0;
+    client.filled = pending;
+}
+
+void RelayShard::parse_frames(TcpClient& sender, Clock::time_point now) {
+    // Packets are relayed where they were read; listeners share the block
+    auto deliver = [&](size_t size) {
+        PacketSlice packet{sender.block, sender.block.data() + sender.used, size};
+        sender.used += size;
+        stats_.packets_in++;
+        relay_tcp(&sender, packet);
+    };
+    
+    sender.needs = 0;
+    while (!sender.raw && sender.filled > sender.used) {
+        const uint8_t* data = sender.block.data() + sender.used;
+        size_t size = sender.filled - sender.used;
+        if (size < PacketHeader::kSize) {
+            sender.needs = PacketHeader::kSize;
+            return;
+        }
+        
+        PacketHeader header;
+        if (!parse_framed(data, size, header)) {
+            sender.raw = true;
+            break;
+        }
+        size_t packet_size = PacketHeader::kSize + header.payload_length;
+        if (size < packet_size) {
+            sender.needs = packet_size;
+            return;
+        }
+        sender.reception.on_packet(header, packet_size, now);
+        if (mixer_) {
+            mixer_->push(sender.participant, header, data + PacketHeader::kSize);
+            sender.used += packet_size;
+            stats_.packets_in++;
+        } else {
+            deliver(packet_size);
+        }
+    }
+    
+    // Not header-framed (--raw senders): everything from here on is relayed
+    // as it comes; the mixer has no header to place it by, so drops it
+    if (sender.raw && sender.filled > sender.used) {
+        if (mixer_) {
+            stats_.packets_in++;
+            sender.used = sender.filled;
+        } else {
+            deliver(sender.filled - sender.used);
+        }
+    }
+}
+
+void RelayShard::relay_tcp(const TcpClient* sender, const PacketSlice& packet) {
+    for (auto& entry : tcp_clients_) {
+        TcpClient& client = *entry.second;
+        if (&client == sender || client.failed) continue;
+        
+        enqueue(client, packet);
+        if (!client.flush_pending) {
+            client.flush_pending = true;
+            to_flush_.push_back(&client);
+        }
+    }
+    
+    // A packet from a mailbox has already been handed to every shard
+    if (sender == nullptr) return;
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+        if (shard == index_ || shards_[shard]->stats().tcp_clients == 0) continue;
+        
+        ShardMessage* message = post(shard, kControlSlots);
+        if (message == nullptr) {
+            stats_.dropped++;
+            continue;
+        }
+        message->type = ShardMessage::Type::TcpPacket;
+        message->packet = packet;
+        shards_[shard]->inbox_[index_]->commit();
+        stats_.handoffs++;
+    }
+}
+
+void RelayShard::enqueue(TcpClient& client, const PacketSlice& packet) {
+    // Too slow a listener loses its oldest audio, never part of a packet
+    while (client.queued_bytes + packet.size > config_.client_queue_bytes) {
+        size_t oldest = client.offset > 0 ? 1 : 0;
+        if (oldest >= client.queue.size()) {
+            stats_.dropped++;
+            return;
+        }
+        client.queued_bytes -= client.queue[oldest].size;
+        client.queue.erase(client.queue.begin() + static_cast<std::ptrdiff_t>(oldest));
+        stats_.dropped++;
+    }
+    client.queue.push_back(packet);
+    client.queued_bytes += packet.size;
+}
+
+void RelayShard::flush(TcpClient& client) {
+    while (!client.queue.empty()) {
+        MessageView views[Network::kMaxSendSome];
+        size_t count = std::min(client.queue.size(), Network::kMaxSendSome);
+        for (size_t i = 0; i < count; i++) {
+            views[i] = {{client.queue[i].data, client.queue[i].size}, {nullptr, 0}};
+        }
+        
+        int sent = client.network.send_some(views, count, client.offset);
+        stats_.syscalls++;
+        if (sent < 0) {
+            client.failed = true;
+            to_close_.push_back(client.network.fd());
+            return;
+        }
+        for (int i = 0; i < sent; i++) {
+            stats_.bytes_out += client.queue.front().size;
+            client.queued_bytes -= client.queue.front().size;
+            client.queue.pop_front();
+        }
+        stats_.packets_out += static_cast<uint64_t>(sent);
+        if (static_cast<size_t>(sent) < count) break;
+    }
+    
+    // Wait for room only while something is left over
+    bool want_write = !client.queue.empty();
+    if (want_write != client.want_write) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = client.network.fd();
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.network.fd(), &event);
+        client.want_write = want_write;
+    }
+}
+
+void RelayShard::flush_pending() {
+    for (TcpClient* client : to_flush_) {
+        client->flush_pending = false;
+        if (!client->failed) {
+            flush(*client);
+        }
+    }
+    to_flush_.clear();
+}
+
+void RelayShard::close_tcp(int fd) {
+    auto found = tcp_clients_.find(fd);
+    if (found == tcp_clients_.end()) return;
+    
+    if (config_.verbose) {
+        std::cout << "[TCP] Client disconnected: " << found->second->network.remote_address() << std::endl;
+    }
+    stats_.dropped += found->second->queue.size();
+    if (mixer_) {
+        mixer_->remove(found->second->participant);
+    }
+    tcp_clients_.erase(found);
+    stats_.tcp_clients = static_cast<uint32_t>(tcp_clients_.size());
+}
+
+void RelayShard::read_udp(Clock::time_point now) {
+    size_t batch = receive_messages_.size();
+    for (int reads = 0; reads < kMaxReadsPerEvent; reads++) {
+        // recvmmsg overwrites the lengths and flags it reports
+        for (size_t i = 0; i < batch; i++) {
+            struct msghdr& header = receive_messages_[i].msg_hdr;
+            header.msg_namelen = sizeof(struct sockaddr_storage);
+            header.msg_controllen = gro_ ? kGroControlBytes : 0;
+            header.msg_flags = 0;
+        }
+        
+        int received = recvmmsg(udp_fd_, receive_messages_.data(), static_cast<unsigned>(batch), MSG_DONTWAIT,
+                                nullptr);
+        stats_.receives++;
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        
+        // The whole batch is relayed before its slots are read into again
+        for (int i = 0; i < received; i++) {
+            receive_datagrams(static_cast<size_t>(i), now);
+        }
+        send_udp();
+        recovered_.clear();
+        if (static_cast<size_t>(received) < batch) return;
+    }
+}
+
+void RelayShard::receive_datagrams(size_t slot, Clock::time_point now) {
+    struct mmsghdr& message = receive_messages_[slot];
+    const uint8_t* data = static_cast<const uint8_t*>(receive_parts_[slot].iov_base);
+    size_t size = message.msg_len;
+    size_t segment = gro_ ? gro_segment_size(message.msg_hdr, size) : size;
+    size_t sender = find_udp_client(receive_addresses_[slot], message.msg_hdr.msg_namelen, now);
+    
+    // Each datagram of a GRO run goes out as the sender sent it
+    size_t offset = 0;
+    do {
+        size_t length = std::min(segment, size - offset);
+        stats_.packets_in++;
+        stats_.bytes_in += length;
+        
+        PacketHeader header;
+        bool framed = PacketHeader::parse(data + offset, length, header);
+        if (framed) {
+            udp_clients_[sender].reception.on_packet(header, length, now);
+        }
+        if (!mixer_) {
+            relay_udp(sender, data + offset, length);
+        } else if (framed && header.payload_length <= length - PacketHeader::kSize) {
+            mixer_->push(udp_clients_[sender].participant, header, data + offset + PacketHeader::kSize);
+        }
+        if (framed) {
+            recover_udp(sender, data + offset, length, header);
+        }
+        offset += length;
+    } while (offset < size);
+}
+
+void RelayShard::recover_udp(size_t sender, const uint8_t* data, size_t size, const PacketHeader& header) {
+    // Decoding keeps a copy of every datagram, so only senders that use FEC pay for it
+    UdpClient& client = udp_clients_[sender];
+    if (!client.fec) {
+        if (!(header.flags & PacketHeader::kFlagFec)) return;
+        client.fec = std::make_unique<FecDecoder>();
+        if (config_.verbose) {
+            std::cout << "[UDP] FEC repairs from " << client.name << ", recovering its losses" << std::endl;
+        }
+    }
+    
+    // Rebuilt datagrams are mixed or go out as if they had arrived
+    size_t count = client.fec->receive(data, size);
+    for (size_t i = 0; i < count; i++) {
+        const std::vector<uint8_t>& datagram = client.fec->recovered(i);
+        if (mixer_) {
+            PacketHeader recovered;
+            if (PacketHeader::parse(datagram.data(), datagram.size(), recovered) &&
+                recovered.payload_length <= datagram.size() - PacketHeader::kSize) {
+                stats_.recovered++;
+                mixer_->push(client.participant, recovered, datagram.data() + PacketHeader::kSize);
+            }
+            continue;
+        }
+        if (datagram.size() > kUdpSlotBytes) continue;
+        SharedBuffer buffer = recovered_pool_.acquire();
+        std::memcpy(buffer.data(), datagram.data(), datagram.size());
+        recovered_.push_back(PacketSlice{buffer, buffer.data(), datagram.size()});
+        stats_.recovered++;
+        relay_udp(sender, buffer.data(), datagram.size());
+    }
+}
+
+size_t RelayShard::find_udp_client(const struct sockaddr_storage& address, socklen_t length, Clock::time_point now) {
+    auto found = udp_index_.find(address_key(address));
+    size_t index = found != udp_index_.end() ? found->second : add_udp_client(address, length, false, now);
+    UdpClient& client = udp_clients_[index];
+    client.last_seen = now;
+    
+    // Its datagrams reach this shard, so this shard answers for it from now on
+    if (!client.owned) {
+        client.owned = true;
+        if (config_.verbose) {
+            std::cout << "[UDP] Client connected: " << client.name << std::endl;
+        }
+        post_udp_change(ShardMessage::Type::UdpJoin, client);
+        stats_.udp_clients++;
+    }
+    return index;
+}
+
+size_t RelayShard::add_udp_client(const struct sockaddr_storage& address, socklen_t length, bool owned,
+                                  Clock::time_point now) {
+    // Waiting copies point at addresses in udp_clients_, which may move
+    send_udp();
+    
+    UdpClient client;
+    client.key = address_key(address);
+    client.address = address;
+    client.length = length;
+    client.name = address_name(address, length);
+    client.participant = next_participant_++;
+    client.owned = owned;
+    client.last_seen = now;
+    udp_index_[client.key] = udp_clients_.size();
+    udp_clients_.push_back(std::move(client));
+    return udp_clients_.size() - 1;
+}
+
+void RelayShard::remove_udp_client(size_t index) {
+    if (mixer_) {
+        mixer_->remove(udp_clients_[index].participant);
+    }
+    udp_index_.erase(udp_clients_[index].key);
+    if (index + 1 < udp_clients_.size()) {
+        udp_clients_[index] = std::move(udp_clients_.back());
+        udp_index_[udp_clients_[index].key] = index;
+    }
+    udp_clients_.pop_back();
+}
+
+void RelayShard::relay_udp(size_t sender, const uint8_t* data, size_t size) {
+    // Every copy is sent from the receive slot; copies of the batch's
+    // datagrams share sendmmsg calls
+    for (size_t i = 0; i < udp_clients_.size(); i++) {
+        if (i != sender) {
+            queue_udp(i, data, size);
+        }
+    }
+}
+
+void RelayShard::queue_udp(size_t client, const uint8_t* data, size_t size) {
+    if (pending_ == messages_.size()) {
+        send_udp();
+    }
+    parts_[pending_].iov_base = const_cast<uint8_t*>(data);
+    parts_[pending_].iov_len = size;
+    struct msghdr& header = messages_[pending_].msg_hdr;
+    std::memset(&header, 0, sizeof(header));
+    header.msg_name = &udp_clients_[client].address;
+    header.msg_namelen = udp_clients_[client].length;
+    header.msg_iov = &parts_[pending_];
+    header.msg_iovlen = 1;
+    pending_++;
+}
+
+void RelayShard::send_udp() {
+    size_t count = pending_;
+    pending_ = 0;
+    size_t done = 0;
+    while (done < count) {
+        int sent = sendmmsg(udp_fd_, &messages_[done], static_cast<unsigned>(count - done), MSG_DONTWAIT);
+        stats_.syscalls++;
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                // Socket buffer full: the rest of this round is lost, as the network would lose it
+                stats_.dropped += count - done;
+                return;
+            }
+            // This client's address is unusable; skip it
+            stats_.dropped++;
+            done++;
+            continue;
+        }
+        for (int i = 0; i < sent; i++) {
+            stats_.bytes_out += messages_[done + static_cast<size_t>(i)].msg_len;
+        }
+        stats_.packets_out += static_cast<uint64_t>(sent);
+        done += static_cast<size_t>(sent);
+    }
+}
+
+void RelayShard::expire_udp_clients(Clock::time_point now) {
+    if (config_.idle_timeout_ms <= 0) return;
+    
+    // Only the owner knows when a client last spoke; the others follow its UdpLeave
+    auto timeout = std::chrono::milliseconds(config_.idle_timeout_ms);
+    for (size_t i = 0; i < udp_clients_.size();) {
+        if (!udp_clients_[i].owned || now - udp_clients_[i].last_seen < timeout) {
+            i++;
+            continue;
+        }
+        
+        if (config_.verbose) {
+            std::cout << "[UDP] Client expired: " << udp_clients_[i].name << std::endl;
+        }
+        post_udp_change(ShardMessage::Type::UdpLeave, udp_clients_[i]);
+        remove_udp_client(i);
+        stats_.expired++;
+        stats_.udp_clients--;
+    }
+}
+
+ShardMessage* RelayShard::post(size_t shard, size_t keep_free) {
+    ShardMessage* message = shards_[shard]->inbox_[index_]->reserve(keep_free);
+    if (message != nullptr) {
+        posted_[shard] = true;
+    }
+    return message;
+}
+
+void RelayShard::post_udp_change(ShardMessage::Type type, const UdpClient& client) {
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+        if (shard == index_) continue;
+        
+        // Control messages may use the reserve; a full one means that shard has stopped
+        ShardMessage* message = post(shard, 0);
+        if (message == nullptr) continue;
+        message->type = type;
+        message->address = client.address;
+        message->length = client.length;
+        shards_[shard]->inbox_[index_]->commit();
+    }
+}
+
+void RelayShard::drain_mailboxes(Clock::time_point now) {
+    for (size_t shard = 0; shard < inbox_.size(); shard++) {
+        if (shard == index_) continue;
+        
+        ShardMailbox& mailbox = *inbox_[shard];
+        while (ShardMessage* message = mailbox.front()) {
+            if (message->type == ShardMessage::Type::TcpPacket) {
+                relay_tcp(nullptr, message->packet);
+                message->packet.buffer.reset();
+            } else {
+                auto found = udp_index_.find(address_key(message->address));
+                if (message->type == ShardMessage::Type::UdpJoin && found == udp_index_.end()) {
+                    add_udp_client(message->address, message->length, false, now);
+                } else if (message->type == ShardMessage::Type::UdpLeave && found != udp_index_.end() &&
+                           !udp_clients_[found->second].owned) {
+                    // A client that moved here is ours to expire now
+                    remove_udp_client(found->second);
+                }
+            }
+            mailbox.pop();
+        }
+    }
+}
+
+void RelayShard::wake_peers() {
+    uint64_t one = 1;
+    for (size_t shard = 0; shard < posted_.size(); shard++) {
+        if (!posted_[shard]) continue;
+        
+        ssize_t written = write(shards_[shard]->wake_fd_, &one, sizeof(one));
+        (void)written;
+        posted_[shard] = false;
+    }
+}
+
+void RelayShard::send_reports(Clock::time_point now) {
+    // A sender's backlog is the deepest queue among the other listeners
+    size_t deepest = 0;
+    size_t second = 0;
+    const TcpClient* deepest_client = nullptr;
+    for (const auto& entry : tcp_clients_) {
+        size_t queued = entry.second->queued_bytes;
+        if (queued >= deepest) {
+            second = deepest;
+            deepest = queued;
+            deepest_client = entry.second.get();
+        } else if (queued > second) {
+            second = queued;
+        }
+    }
+    deepest_queue_.store(deepest, std::memory_order_relaxed);
+    if (!config_.reports) return;
+    
+    // Listeners on other shards count too, as of their last tick
+    size_t remote = 0;
+    for (const auto& shard : shards_) {
+        if (shard.get() != this) {
+            remote = std::max(remote, shard->deepest_queue_.load(std::memory_order_relaxed));
+        }
+    }
+    
+    uint8_t report[ReceptionStats::kReportSize];
+    for (auto& entry : tcp_clients_) {
+        TcpClient& client = *entry.second;
+        if (client.raw || client.failed || !client.reception.active()) continue;
+        
+        size_t backlog = std::max(remote, &client == deepest_client ? second : deepest);
+        SharedBuffer buffer = report_pool_.acquire();
+        if (!client.reception.build_report(now, backlog, buffer.data())) continue;
+        enqueue(client, PacketSlice{buffer, buffer.data(), ReceptionStats::kReportSize});
+        if (!client.flush_pending) {
+            client.flush_pending = true;
+            to_flush_.push_back(&client);
+        }
+        stats_.reports++;
+    }
+    
+    for (UdpClient& client : udp_clients_) {
+        if (!client.owned || !client.reception.active() || !client.reception.build_report(now, 0, report)) continue;
+        
+        sendto(udp_fd_, report, sizeof(report), MSG_DONTWAIT, reinterpret_cast<struct sockaddr*>(&client.address),
+               client.length);
+        stats_.syscalls++;
+        stats_.reports++;
+    }
+}
+
+void RelayShard::mix_round() {
+    // Nothing is sent for a frame nobody spoke in
+    if (mixer_->mix() == 0) return;
+    stats_.mixed++;
+    
+    PacketHeader header;
+    header.stream_id = kMixStreamId;
+    header.sequence = mix_sequence_++;
+    header.timestamp = mixer_->timestamp();
+    header.sample_rate = static_cast<uint32_t>(mixer_->config().sample_rate);
+    header.encoding = PayloadEncoding::S16;
+    header.channels = static_cast<uint8_t>(mixer_->config().channels);
+    header.payload_length = static_cast<uint32_t>(mixer_->frame_bytes());
+    
+    // Whoever was heard gets a mix without themselves; everyone else shares the full mix
+    PacketSlice full;
+    auto output_for = [&](uint64_t participant) {
+        bool heard = mixer_->contributed(participant);
+        if (!heard && full.buffer) return full;
+        
+        SharedBuffer buffer = mix_pool_.acquire();
+        header.serialize(buffer.data());
+        if (heard) {
+            mixer_->write_mix_minus(participant, buffer.data() + PacketHeader::kSize);
+        } else {
+            mixer_->write_mix(buffer.data() + PacketHeader::kSize);
+        }
+        PacketSlice packet{buffer, buffer.data(), PacketHeader::kSize + mixer_->frame_bytes()};
+        if (!heard) {
+            full = packet;
+        }
+        return packet;
+    };
+    
+    for (auto& entry : tcp_clients_) {
+        TcpClient& client = *entry.second;
+        if (client.failed) continue;
+        
+        enqueue(client, output_for(client.participant));
+        if (!client.flush_pending) {
+            client.flush_pending = true;
+            to_flush_.push_back(&client);
+        }
+    }
+    
+    // The UDP outputs stay in mix_sends_ until sendmmsg has them
+    mix_sends_.clear();
+    mix_sends_.reserve(udp_clients_.size());
+    for (size_t i = 0; i < udp_clients_.size(); i++) {
+        mix_sends_.push_back(output_for(udp_clients_[i].participant));
+        queue_udp(i, mix_sends_.back().data, mix_sends_.back().size);
+    }
+    send_udp();
+    mix_sends_.clear();
+}
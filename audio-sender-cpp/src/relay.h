@@ -0,0 +1,308 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+#include "network.h"
+#include "feedback.h"
+#include "fec.h"
+#include "resolver.h"
+#include "shared_buffer.h"
+#include "mixer.h"
+
+struct RelayConfig {
+    std::string bind_address = "0.0.0.0";
+    int tcp_port = 8080;                        // 0 disables the TCP relay
+    int udp_port = 8081;                        // 0 disables the UDP relay
+    int threads = 1;                            // shards, each with its own sockets and epoll loop
+    size_t udp_batch = 32;                      // datagrams per recvmmsg
+    bool udp_gro = true;                        // let the kernel coalesce datagrams (UDP_GRO) where it can
+    size_t client_queue_bytes = 256 * 1024;     // per TCP listener
+    int idle_timeout_ms = 30000;                // UDP clients silent this long are forgotten
+    bool reports = true;                        // receiver reports to header-framed senders
+    bool verbose = true;                        // log clients joining and leaving
+    
+    // Send every client one mix-minus stream instead of everyone's packets
+    bool mix = false;
+    MixerConfig mixer;
+};
+
+struct RelayStats {
+    std::atomic<uint64_t> packets_in{0};        // datagrams, or framed packets or raw reads on TCP
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> receives{0};          // receive calls made to read them
+    std::atomic<uint64_t> packets_out{0};       // copies delivered to listeners
+    std::atomic<uint64_t> bytes_out{0};
+    std::atomic<uint64_t> dropped{0};           // copies lost to a full listener queue, socket buffer or mailbox
+    std::atomic<uint64_t> syscalls{0};          // send calls made to deliver them
+    std::atomic<uint64_t> reports{0};
+    std::atomic<uint64_t> expired{0};           // UDP clients forgotten after going quiet
+    std::atomic<uint64_t> handoffs{0};          // TCP packets passed to other shards
+    std::atomic<uint64_t> recovered{0};         // UDP datagrams rebuilt from FEC repairs
+    std::atomic<uint64_t> mixed{0};             // frames mixed and sent (mix mode)
+    std::atomic<uint32_t> tcp_clients{0};       // connections this shard accepted
+    std::atomic<uint32_t> udp_clients{0};       // clients whose datagrams reach this shard
+};
+
+// Bytes inside a pooled block: a whole packet, a raw read or a report.
+// Every listener queue holding it shares the block, which goes back to its
+// pool when the last copy is sent or dropped.
+struct PacketSlice {
+    SharedBuffer buffer;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// One message between shards: a TCP packet for the receiving shard's
+// listeners, or a UDP client joining or leaving
+struct ShardMessage {
+    enum class Type : uint8_t {
+        TcpPacket,
+        UdpJoin,
+        UdpLeave
+    };
+    
+    Type type = Type::TcpPacket;
+    PacketSlice packet;                         // TcpPacket; released once delivered
+    struct sockaddr_storage address;            // UdpJoin, UdpLeave
+    socklen_t length = 0;
+};
+
+// Wait-free single-producer/single-consumer ring of preallocated messages
+// from one shard to another, like FrameRingBuffer
+class ShardMailbox {
+public:
+    explicit ShardMailbox(size_t capacity);
+    
+    // Producer side: the slot to fill, or nullptr unless more than keep_free
+    // slots are free; commit() publishes it
+    ShardMessage* reserve(size_t keep_free);
+    void commit();
+    
+    // Consumer side: oldest message or nullptr, then pop() to release it
+    ShardMessage* front();
+    void pop();
+
+private:
+    std::vector<ShardMessage> slots_;
+    
+    // Monotonic counters; slot index is counter % capacity
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    alignas(64) std::atomic<uint64_t> read_pos_{0};
+};
+
+class RelayShard;
+
+// Native counterpart of startTCPServer and startUDPServer in
+// linux-cli-server.js: every packet a client sends goes to every other
+// client of the same protocol. TCP senders that use packet headers are
+// relayed a whole packet at a time, so packets from different senders never
+// interleave; anything else is relayed as it arrives. Each TCP listener has
+// a bounded queue that drops its oldest packets when the listener cannot
+// keep up. UDP copies that find the socket buffer full are dropped, and UDP
+// clients are forgotten after idle_timeout_ms of silence. UDP senders that
+// send FEC repairs get a FecDecoder once the first repair arrives: datagrams
+// lost on the way to the relay are rebuilt and relayed like the rest, and
+// the repairs are relayed too, for listeners that decode them.
+//
+// The work is split over config.threads shards. Each has its own
+// SO_REUSEPORT sockets on the same ports and its own epoll loop, and the
+// kernel pins every connection and every UDP client's flow to one of them.
+// A shard relays its own senders' datagrams to every UDP client straight
+// from its socket, so it keeps a copy of the whole UDP client table, updated
+// through the mailboxes when clients join or leave. TCP listeners belong to
+// the shard that accepted them, so TCP packets for other shards' listeners
+// go through the mailboxes. The packet blocks they point into go back to
+// the sending shard's pool through its lock-free return list (BufferPool)
+// when the last listener is done with them, so no lock is taken on the
+// packet path.
+//
+// With config.mix, clients get one mixed stream each instead: everyone else's
+// audio, mixed by a Mixer every frame. Mixing needs every stream in one
+// place, so it runs on a single shard. Linux only.
+class Relay {
+public:
+    explicit Relay(const RelayConfig& config);
+    ~Relay();
+    
+    Relay(const Relay&) = delete;
+    Relay& operator=(const Relay&) = delete;
+    
+    // Binds every shard's sockets, then starts a thread per shard
+    bool start();
+    
+    // Stops and joins the shard threads
+    void stop();
+    
+    size_t shard_count() const { return shards_.size(); }
+    const RelayStats& shard_stats(size_t index) const;
+
+private:
+    RelayConfig config_;
+    std::vector<std::unique_ptr<RelayShard>> shards_;
+    std::vector<std::thread> threads_;
+};
+
+// One event loop of the relay
+class RelayShard {
+public:
+    RelayShard(const RelayConfig& config, size_t index, const std::vector<std::unique_ptr<RelayShard>>& shards);
+    ~RelayShard();
+    
+    RelayShard(const RelayShard&) = delete;
+    RelayShard& operator=(const RelayShard&) = delete;
+    
+    // Binds the listening sockets
+    bool start();
+    
+    // Event loop; returns after stop() or on a fatal error
+    void run();
+    
+    // Safe from any thread
+    void stop();
+    
+    const RelayStats& stats() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct TcpClient {
+        TCPNetwork network;
+        uint64_t participant = 0;               // mixer id
+        
+        // Reads land in block at filled. Bytes before used are relayed and
+        // may sit in listener queues; [used, filled) is the start of a
+        // packet split across reads, which needs bytes in total. Bytes
+        // from filled on are not shared yet, so reading into them is safe.
+        SharedBuffer block;
+        size_t used = 0;
+        size_t filled = 0;
+        size_t needs = 0;
+        bool raw = false;                       // the stream turned out not to carry headers
+        ReceptionStats reception;
+        
+        // Outbound queue of whole packets; offset is how far into the front one a write got
+        std::deque<PacketSlice> queue;
+        size_t queued_bytes = 0;
+        size_t offset = 0;
+        bool want_write = false;
+        bool flush_pending = false;
+        bool failed = false;
+    };
+    
+    // Every UDP client, on every shard; only the owner (the shard the
+    // client's datagrams reach) keeps its statistics and expires it
+    struct UdpClient {
+        std::string key;
+        struct sockaddr_storage address;
+        socklen_t length = 0;
+        std::string name;
+        uint64_t participant = 0;
+        bool owned = false;
+        Clock::time_point last_seen;
+        ReceptionStats reception;
+        std::unique_ptr<FecDecoder> fec;        // from its first FEC repair on
+    };
+    
+    bool open_tcp();
+    bool open_udp();
+    
+    void accept_clients();
+    void read_tcp(TcpClient& client, Clock::time_point now);
+    void prepare_block(TcpClient& client);
+    void parse_frames(TcpClient& sender, Clock::time_point now);
+    void relay_tcp(const TcpClient* sender, const PacketSlice& packet);
+    void enqueue(TcpClient& client, const PacketSlice& packet);
+    void flush(TcpClient& client);
+    void flush_pending();
+    void close_tcp(int fd);
+    
+    void read_udp(Clock::time_point now);
+    void receive_datagrams(size_t slot, Clock::time_point now);
+    void recover_udp(size_t sender, const uint8_t* data, size_t size, const PacketHeader& header);
+    void relay_udp(size_t sender, const uint8_t* data, size_t size);
+    void queue_udp(size_t client, const uint8_t* data, size_t size);
+    void send_udp();
+    size_t find_udp_client(const struct sockaddr_storage& address, socklen_t length, Clock::time_point now);
+    size_t add_udp_client(const struct sockaddr_storage& address, socklen_t length, bool owned,
+                          Clock::time_point now);
+    void remove_udp_client(size_t index);
+    void expire_udp_clients(Clock::time_point now);
+    
+    // Mailboxes: post() to another shard, drain_mailboxes() for ours
+    ShardMessage* post(size_t shard, size_t keep_free);
+    void post_udp_change(ShardMessage::Type type, const UdpClient& client);
+    void drain_mailboxes(Clock::time_point now);
+    void wake_peers();
+    
+    void send_reports(Clock::time_point now);
+    void mix_round();
+    
+    RelayConfig config_;
+    RelayStats stats_;
+    size_t index_;
+    const std::vector<std::unique_ptr<RelayShard>>& shards_;
+    
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    int tcp_fd_ = -1;
+    int udp_fd_ = -1;
+    std::atomic<bool> running_{false};
+    
+    std::unordered_map<int, std::unique_ptr<TcpClient>> tcp_clients_;
+    std::vector<TcpClient*> to_flush_;
+    std::vector<int> to_close_;
+    
+    // Deepest TCP listener queue here, for other shards' receiver reports
+    std::atomic<size_t> deepest_queue_{0};
+    
+    // Contiguous so fan-out walks an array; the map finds a sender's index
+    std::vector<UdpClient> udp_clients_;
+    std::unordered_map<std::string, size_t> udp_index_;
+    
+    // inbox_[i] carries messages from shard i; posted_[i] marks shard i for a wake-up
+    std::vector<std::unique_ptr<ShardMailbox>> inbox_;
+    std::vector<bool> posted_;
+    
+    // TCP reads go straight into pooled blocks; packets bigger than a
+    // block get one of their own from large_pool_
+    BufferPool pool_;
+    BufferPool large_pool_;
+    BufferPool report_pool_;
+    
+    // UDP receive batch: a slot per datagram (or GRO run of datagrams),
+    // each with its sender's address and room for the GRO control message
+    bool gro_ = false;
+    std::vector<uint8_t> receive_buffer_;
+    std::vector<struct mmsghdr> receive_messages_;
+    std::vector<struct iovec> receive_parts_;
+    std::vector<struct sockaddr_storage> receive_addresses_;
+    std::vector<uint8_t> receive_control_;
+    
+    // UDP copies waiting for one sendmmsg; they point into the receive batch
+    std::vector<struct mmsghdr> messages_;
+    std::vector<struct iovec> parts_;
+    size_t pending_ = 0;
+    
+    // Datagrams FEC rebuilt; like the receive batch, kept until it is relayed
+    BufferPool recovered_pool_;
+    std::vector<PacketSlice> recovered_;
+    
+    // Mix mode: outputs come from mix_pool_, and UDP ones wait in mix_sends_ until sent
+    std::unique_ptr<Mixer> mixer_;
+    uint64_t next_participant_ = 1;
+    Clock::time_point next_mix_;
+    uint32_t mix_sequence_ = 0;
+    BufferPool mix_pool_;
+    std::vector<PacketSlice> mix_sends_;
+    
+    Clock::time_point next_tick_;
+};
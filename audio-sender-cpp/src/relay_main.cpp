@@ -0,0 +1,253 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <vector>
+
+#include "network.h"
+#include "relay.h"
+
+struct RelayOptions {
+    RelayConfig relay;
+    int stats_interval = 10;
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "🔁 Audio Relay v1.0\n";
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n\n";
+    std::cout << "Relays every client's packets to every other client of the same protocol,\n";
+    std::cout << "like the TCP and UDP servers of linux-cli-server.js.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --bind ADDR            Address to listen on (default: 0.0.0.0)\n";
+    std::cout << "  --tcp-port PORT        TCP relay port; 0 disables (default: 8080)\n";
+    std::cout << "  --udp-port PORT        UDP relay port; 0 disables (default: 8081)\n";
+    std::cout << "  --threads N            Event loops sharing the ports; 0 = one per core (default: 1)\n";
+    std::cout << "  --udp-batch N          UDP datagrams read per system call (default: 32)\n";
+    std::cout << "  --no-gro               Do not let the kernel coalesce UDP datagrams (UDP_GRO)\n";
+    std::cout << "  --queue-kb KB          Per-listener TCP queue; oldest packets drop beyond it (default: 256)\n";
+    std::cout << "  --idle-timeout SEC     Forget UDP clients silent this long; 0 = never (default: 30)\n";
+    std::cout << "  --no-reports           Do not send receiver reports to senders\n";
+    std::cout << "  --mix                  Send each client everyone else's audio mixed (PCM senders; one thread)\n";
+    std::cout << "  --mix-rate HZ          Sample rate of the mix (default: 16000)\n";
+    std::cout << "  --mix-channels N       Channels of the mix (default: 1)\n";
+    std::cout << "  --mix-frame-ms MS      Audio per mixed packet (default: 20)\n";
+    std::cout << "  --mix-delay-ms MS      How far the mix runs behind the senders, for jitter (default: 60)\n";
+    std::cout << "  --stats-interval SEC   Print relay statistics this often; 0 = only at exit (default: 10)\n";
+    std::cout << "  -q, --quiet            Do not log clients joining and leaving\n";
+    std::cout << "  -h, --help             Show this help\n";
+}
+
+RelayOptions parse_args(int argc, char* argv[]) {
+    RelayOptions options;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (arg == "--bind" && i + 1 < argc) {
+            options.relay.bind_address = argv[++i];
+        } else if (arg == "--tcp-port" && i + 1 < argc) {
+            options.relay.tcp_port = std::stoi(argv[++i]);
+        } else if (arg == "--udp-port" && i + 1 < argc) {
+            options.relay.udp_port = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.relay.threads = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--udp-batch" && i + 1 < argc) {
+            options.relay.udp_batch = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--no-gro") {
+            options.relay.udp_gro = false;
+        } else if (arg == "--queue-kb" && i + 1 < argc) {
+            options.relay.client_queue_bytes = static_cast<size_t>(std::max(1, std::stoi(argv[++i]))) * 1024;
+        } else if (arg == "--idle-timeout" && i + 1 < argc) {
+            options.relay.idle_timeout_ms = std::max(0, std::stoi(argv[++i])) * 1000;
+        } else if (arg == "--no-reports") {
+            options.relay.reports = false;
+        } else if (arg == "--mix") {
+            options.relay.mix = true;
+        } else if (arg == "--mix-rate" && i + 1 < argc) {
+            options.relay.mixer.sample_rate = std::stoi(argv[++i]);
+        } else if (arg == "--mix-channels" && i + 1 < argc) {
+            options.relay.mixer.channels = std::stoi(argv[++i]);
+        } else if (arg == "--mix-frame-ms" && i + 1 < argc) {
+            options.relay.mixer.frame_ms = std::stoi(argv[++i]);
+        } else if (arg == "--mix-delay-ms" && i + 1 < argc) {
+            options.relay.mixer.delay_ms = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--stats-interval" && i + 1 < argc) {
+            options.stats_interval = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "-q" || arg == "--quiet") {
+            options.relay.verbose = false;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    
+    if (options.relay.tcp_port <= 0 && options.relay.udp_port <= 0) {
+        std::cerr << "Nothing to relay: both ports are disabled" << std::endl;
+        exit(1);
+    }
+    if (options.relay.mix) {
+        const MixerConfig& mixer = options.relay.mixer;
+        if (options.relay.threads != 1) {
+            std::cerr << "--mix runs on one thread; drop --threads" << std::endl;
+            exit(1);
+        }
+        if (mixer.sample_rate < 8000 || mixer.sample_rate > 192000 || mixer.channels < 1 || mixer.channels > 8 ||
+            mixer.frame_ms < 1 || mixer.frame_ms > 1000) {
+            std::cerr << "Unsupported mix format: " << mixer.sample_rate << " Hz, " << mixer.channels
+                      << " channel(s), " << mixer.frame_ms << " ms frames" << std::endl;
+            exit(1);
+        }
+    }
+    return options;
+}
+
+std::atomic<bool> running{true};
+
+void signal_handler(int) {
+    running = false;
+}
+
+// Counters summed over the shards, or one shard's
+struct RelaySnapshot {
+    uint64_t packets_in = 0;
+    uint64_t bytes_in = 0;
+    uint64_t receives = 0;
+    uint64_t packets_out = 0;
+    uint64_t bytes_out = 0;
+    uint64_t dropped = 0;
+    uint64_t syscalls = 0;
+    uint64_t reports = 0;
+    uint64_t expired = 0;
+    uint64_t handoffs = 0;
+    uint64_t recovered = 0;
+    uint64_t mixed = 0;
+    uint32_t tcp_clients = 0;
+    uint32_t udp_clients = 0;
+    
+    void add(const RelayStats& stats) {
+        packets_in += stats.packets_in;
+        bytes_in += stats.bytes_in;
+        receives += stats.receives;
+        packets_out += stats.packets_out;
+        bytes_out += stats.bytes_out;
+        dropped += stats.dropped;
+        syscalls += stats.syscalls;
+        reports += stats.reports;
+        expired += stats.expired;
+        handoffs += stats.handoffs;
+        recovered += stats.recovered;
+        mixed += stats.mixed;
+        tcp_clients += stats.tcp_clients;
+        udp_clients += stats.udp_clients;
+    }
+};
+
+RelaySnapshot snapshot(const Relay& relay) {
+    RelaySnapshot total;
+    for (size_t i = 0; i < relay.shard_count(); i++) {
+        total.add(relay.shard_stats(i));
+    }
+    return total;
+}
+
+void print_progress(const Relay& relay, RelaySnapshot& last, std::vector<RelaySnapshot>& last_shards,
+                    double seconds) {
+    RelaySnapshot stats = snapshot(relay);
+    std::cout << "📡 Relaying... (TCP clients: " << stats.tcp_clients << ", UDP clients: " << stats.udp_clients
+              << ", in " << static_cast<uint64_t>((stats.packets_in - last.packets_in) / seconds) << " pkt/s, out "
+              << static_cast<uint64_t>((stats.packets_out - last.packets_out) / seconds) << " pkt/s, "
+              << static_cast<uint64_t>((stats.bytes_out - last.bytes_out) * 8 / seconds / 1000) << " kbit/s, "
+              << static_cast<double>(stats.packets_in - last.packets_in) /
+                     std::max<uint64_t>(1, stats.receives - last.receives)
+              << " pkt/receive, dropped " << stats.dropped << ")\n";
+    last = stats;
+    
+    // With several shards, show how evenly the kernel spread the clients
+    if (relay.shard_count() < 2) return;
+    for (size_t i = 0; i < relay.shard_count(); i++) {
+        RelaySnapshot shard;
+        shard.add(relay.shard_stats(i));
+        const RelaySnapshot& before = last_shards[i];
+        std::cout << "   🧩 Shard " << i << ": in "
+                  << static_cast<uint64_t>((shard.packets_in - before.packets_in) / seconds) << " pkt/s, out "
+                  << static_cast<uint64_t>((shard.packets_out - before.packets_out) / seconds)
+                  << " pkt/s, TCP clients " << shard.tcp_clients << ", UDP clients " << shard.udp_clients
+                  << ", handoffs " << shard.handoffs << "\n";
+        last_shards[i] = shard;
+    }
+}
+
+void print_relay_stats(const Relay& relay, double elapsed) {
+    RelaySnapshot stats = snapshot(relay);
+    std::cout << "📥 Received " << stats.packets_in << " packets, " << stats.bytes_in << " bytes in " << elapsed
+              << " s (" << (stats.receives > 0 ? static_cast<double>(stats.packets_in) / stats.receives : 0.0)
+              << " packets/receive call)\n";
+    std::cout << "📤 Relayed " << stats.packets_out << " packets, " << stats.bytes_out << " bytes ("
+              << (stats.packets_out > 0 ? static_cast<double>(stats.syscalls) / stats.packets_out : 0.0)
+              << " syscalls/packet), dropped " << stats.dropped << "\n";
+    std::cout << "📶 Receiver reports: " << stats.reports << ", UDP clients expired: " << stats.expired << "\n";
+    if (stats.recovered > 0) {
+        std::cout << "🩹 Recovered " << stats.recovered << " lost UDP datagrams from FEC repairs\n";
+    }
+    if (relay.shard_count() > 1) {
+        std::cout << "🧩 " << relay.shard_count() << " shards, " << stats.handoffs
+                  << " TCP packets handed between them\n";
+    }
+}
+
+void print_mix_stats(const Relay& relay, const MixerConfig& mixer) {
+    RelaySnapshot stats = snapshot(relay);
+    std::cout << "🎚️ Mixed " << stats.mixed << " frames of " << mixer.frame_ms << " ms at " << mixer.sample_rate
+              << " Hz, " << mixer.channels << " channel(s) (" << Mixer::kernel_name() << " kernel)\n";
+}
+
+int main(int argc, char* argv[]) {
+    RelayOptions options = parse_args(argc, argv);
+    Network::initialize();
+    
+    // Before any shard thread writes to a socket
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    Relay relay(options.relay);
+    if (!relay.start()) {
+        std::cerr << "❌ Failed to start relay\n";
+        return 1;
+    }
+    
+    std::cout << "🔁 Relay running on " << relay.shard_count() << " thread(s). Press Ctrl+C to stop.\n";
+    
+    auto started = std::chrono::steady_clock::now();
+    auto last_print = started;
+    RelaySnapshot last;
+    std::vector<RelaySnapshot> last_shards(relay.shard_count());
+    while (running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        
+        auto now = std::chrono::steady_clock::now();
+        double since_print = std::chrono::duration<double>(now - last_print).count();
+        if (options.stats_interval > 0 && since_print >= options.stats_interval) {
+            print_progress(relay, last, last_shards, since_print);
+            last_print = now;
+        }
+    }
+    
+    std::cout << "\n🛑 Stopping relay...\n";
+    relay.stop();
+    Network::cleanup();
+    
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    print_relay_stats(relay, elapsed);
+    if (options.relay.mix) {
+        print_mix_stats(relay, options.relay.mixer);
+    }
+    std::cout << "✅ Relay stopped.\n";
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "resampler.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RESAMPLER_SSE 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kKaiserBeta = 8.0;
+constexpr double kRolloff = 0.92;   // passband edge as a fraction of the lower Nyquist
+
+double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// Both pointers cover n floats, a multiple of 8
+inline float dot(const float* a, const float* b, int n) {
+#if defined(RESAMPLER_SSE)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    return _mm_cvtss_f32(acc0);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+} // namespace
+
+bool Resampler::configure(int input_rate, int output_rate, int channels, size_t max_input_frames) {
+    if (input_rate <= 0 || output_rate <= 0 || channels <= 0 || max_input_frames == 0) return false;
+    
+    int divisor = std::gcd(input_rate, output_rate);
+    input_rate_ = input_rate;
+    output_rate_ = output_rate;
+    channels_ = channels;
+    up_ = output_rate / divisor;
+    down_ = input_rate / divisor;
+    max_input_frames_ = max_input_frames;
+    
+    if (is_passthrough()) {
+        phases_.clear();
+        lines_.clear();
+        return true;
+    }
+    if (up_ > kMaxPhases) return false;
+    
+    // Decimating by M/L needs that many times the taps for the same
+    // transition band relative to the output; rounded up for the SIMD dot product
+    int64_t scaled = (static_cast<int64_t>(kTapsPerPhase) * std::max(up_, down_) + up_ - 1) / up_;
+    if (scaled > kMaxTapsPerPhase) return false;
+    taps_ = static_cast<int>((scaled + 7) / 8 * 8);
+    
+    // Windowed-sinc prototype at the upsampled rate L * input_rate
+    const int taps = taps_;
+    const size_t length = static_cast<size_t>(taps) * up_;
+    const double cutoff = 0.5 * kRolloff / std::max(up_, down_);
+    const double center = (length - 1) / 2.0;
+    const double window_norm = bessel_i0(kKaiserBeta);
+    
+    std::vector<double> prototype(length);
+    for (size_t i = 0; i < length; i++) {
+        double t = i - center;
+        double sinc = (t == 0.0) ? 2.0 * cutoff : std::sin(2.0 * kPi * cutoff * t) / (kPi * t);
+        double r = t / (center + 1.0);
+        double window = bessel_i0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - r * r))) / window_norm;
+        prototype[i] = sinc * window;
+    }
+    
+    // Phase p holds prototype[p + k * L]; each phase is normalized to unity DC gain
+    phases_.assign(length, 0.0f);
+    for (int p = 0; p < up_; p++) {
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            sum += prototype[p + static_cast<size_t>(k) * up_];
+        }
+        for (int k = 0; k < taps; k++) {
+            double value = prototype[p + static_cast<size_t>(k) * up_] / (sum != 0.0 ? sum : 1.0);
+            phases_[static_cast<size_t>(p) * taps + (taps - 1 - k)] = static_cast<float>(value);
+        }
+    }
+    
+    line_length_ = (taps - 1) + max_input_frames_;
+    lines_.assign(line_length_ * channels_, 0.0f);
+    reset();
+    return true;
+}
+
+size_t Resampler::max_output_frames(size_t input_frames) const {
+    if (is_passthrough()) return input_frames;
+    return (input_frames * up_ + down_ - 1) / down_ + 1;
+}
+
+void Resampler::reset() {
+    std::fill(lines_.begin(), lines_.end(), 0.0f);
+    next_input_ = static_cast<size_t>(taps_ - 1);
+    phase_ = 0;
+}
+
+size_t Resampler::process(const float* in, size_t frames, float* out) {
+    if (is_passthrough()) {
+        std::memcpy(out, in, frames * channels_ * sizeof(float));
+        return frames;
+    }
+    
+    const size_t history = static_cast<size_t>(taps_ - 1);
+    size_t produced = 0;
+    
+    while (frames > 0) {
+        size_t chunk = std::min(frames, max_input_frames_);
+        
+        for (int ch = 0; ch < channels_; ch++) {
+            float* line = &lines_[ch * line_length_];
+            for (size_t i = 0; i < chunk; i++) {
+                line[history + i] = in[i * channels_ + ch];
+            }
+        }
+        
+        while (next_input_ < history + chunk) {
+            const float* coeffs = &phases_[static_cast<size_t>(phase_) * taps_];
+            size_t start = next_input_ - history;
+            for (int ch = 0; ch < channels_; ch++) {
+                out[produced * channels_ + ch] = dot(coeffs, &lines_[ch * line_length_ + start], taps_);
+            }
+            produced++;
+            
+            phase_ += down_;
+            next_input_ += phase_ / up_;
+            phase_ %= up_;
+        }
+        
+        // Keep the newest samples as history for the next call
+        for (int ch = 0; ch < channels_; ch++) {
+            float* line = &lines_[ch * line_length_];
+            std::memmove(line, line + chunk, history * sizeof(float));
+        }
+        next_input_ -= chunk;
+        
+        in += chunk * channels_;
+        frames -= chunk;
+    }
+    
+    return produced;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Streaming polyphase resampler for arbitrary rational ratios. The ratio
+// input_rate:output_rate is reduced to L:M, and a windowed-sinc prototype is
+// split into L precomputed phases. Each output sample is one SIMD dot product
+// against the input history. When decimating, each phase gets M/L times
+// kTapsPerPhase taps, so the transition band stays the same fraction of the
+// output Nyquist frequency whatever the ratio.
+class Resampler {
+public:
+    static constexpr int kTapsPerPhase = 32;
+    static constexpr int kMaxTapsPerPhase = 2048;
+    static constexpr int kMaxPhases = 4096;
+    
+    // Returns false if the ratio needs more than kMaxPhases filter phases or kMaxTapsPerPhase taps
+    bool configure(int input_rate, int output_rate, int channels, size_t max_input_frames);
+    
+    // Upper bound on the frames process() can emit for input_frames of input
+    size_t max_output_frames(size_t input_frames) const;
+    
+    // Consumes interleaved input and writes interleaved output; returns output frames
+    size_t process(const float* in, size_t frames, float* out);
+    
+    // Clear the history, e.g. after a gap in the input
+    void reset();
+    
+    bool is_passthrough() const { return up_ == down_; }
+    int input_rate() const { return input_rate_; }
+    int output_rate() const { return output_rate_; }
+
+private:
+    int input_rate_ = 0;
+    int output_rate_ = 0;
+    int channels_ = 1;
+    int up_ = 1;      // L
+    int down_ = 1;    // M
+    int taps_ = kTapsPerPhase;
+    size_t max_input_frames_ = 0;
+    
+    // phases_[p * taps_ + j], stored oldest-sample-first for a contiguous dot product
+    std::vector<float> phases_;
+    
+    // Per channel: taps_ - 1 samples of history followed by the current input
+    std::vector<float> lines_;
+    size_t line_length_ = 0;
+    
+    size_t next_input_ = 0;   // line index of the newest sample the next output uses
+    int phase_ = 0;
+};
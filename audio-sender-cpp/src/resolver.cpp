@@ -0,0 +1,136 @@
+#include "resolver.h"
+#include <iostream>
+#include <thread>
+#include <cstring>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <arpa/inet.h>
+#endif
+
+namespace {
+
+// Alternates address families, starting with the resolver's first choice
+std::vector<ResolvedAddress> interleave_families(const std::vector<ResolvedAddress>& sorted) {
+    std::vector<ResolvedAddress> first;
+    std::vector<ResolvedAddress> other;
+    for (const ResolvedAddress& address : sorted) {
+        (address.family() == sorted[0].family() ? first : other).push_back(address);
+    }
+    
+    std::vector<ResolvedAddress> result;
+    result.reserve(sorted.size());
+    for (size_t i = 0; i < first.size() || i < other.size(); i++) {
+        if (i < first.size()) result.push_back(first[i]);
+        if (i < other.size()) result.push_back(other[i]);
+    }
+    return result;
+}
+
+void set_port(ResolvedAddress& address, int port) {
+    if (address.family() == AF_INET6) {
+        reinterpret_cast<struct sockaddr_in6*>(&address.storage)->sin6_port = htons(static_cast<uint16_t>(port));
+    } else {
+        reinterpret_cast<struct sockaddr_in*>(&address.storage)->sin_port = htons(static_cast<uint16_t>(port));
+    }
+}
+
+} // namespace
+
+std::string ResolvedAddress::to_string() const {
+    char text[INET6_ADDRSTRLEN] = {0};
+    if (family() == AF_INET6) {
+        const auto* in6 = reinterpret_cast<const struct sockaddr_in6*>(&storage);
+        inet_ntop(AF_INET6, &in6->sin6_addr, text, sizeof(text));
+        return std::string("[") + text + "]:" + std::to_string(ntohs(in6->sin6_port));
+    }
+    const auto* in = reinterpret_cast<const struct sockaddr_in*>(&storage);
+    inet_ntop(AF_INET, &in->sin_addr, text, sizeof(text));
+    return std::string(text) + ":" + std::to_string(ntohs(in->sin_port));
+}
+
+void Resolver::prefetch(const std::string& host) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    Entry& entry = state_->cache[host];
+    if (entry.addresses.empty() || std::chrono::steady_clock::now() >= entry.expires) {
+        start_lookup_locked(state_, host);
+    }
+}
+
+bool Resolver::resolve(const std::string& host, int port, std::vector<ResolvedAddress>& addresses,
+                       std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    Entry& entry = state_->cache[host];
+    
+    if (entry.addresses.empty() || std::chrono::steady_clock::now() >= entry.expires) {
+        start_lookup_locked(state_, host);
+        state_->resolved.wait_for(lock, timeout, [&entry] { return !entry.pending; });
+    }
+    
+    if (entry.addresses.empty()) {
+        if (entry.pending) {
+            std::cerr << "Timed out resolving hostname: " << host << std::endl;
+        } else {
+            std::cerr << "Failed to resolve hostname: " << host << " (" << gai_strerror(entry.error) << ")" << std::endl;
+        }
+        return false;
+    }
+    
+    addresses = entry.addresses;
+    for (ResolvedAddress& address : addresses) {
+        set_port(address, port);
+    }
+    return true;
+}
+
+void Resolver::start_lookup_locked(const std::shared_ptr<State>& state, const std::string& host) {
+    Entry& entry = state->cache[host];
+    if (entry.pending) return;
+    
+    entry.pending = true;
+    std::thread(&Resolver::lookup, state, host).detach();
+}
+
+void Resolver::lookup(std::shared_ptr<State> state, std::string host) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;    // one entry per address; the port is set per use
+    hints.ai_flags = AI_ADDRCONFIG;     // skip IPv6 on hosts without an IPv6 address
+    
+    struct addrinfo* results = nullptr;
+    int error = getaddrinfo(host.c_str(), nullptr, &hints, &results);
+    
+    std::vector<ResolvedAddress> sorted;
+    for (struct addrinfo* info = results; info != nullptr; info = info->ai_next) {
+        if ((info->ai_family != AF_INET && info->ai_family != AF_INET6) ||
+            info->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        ResolvedAddress address;
+        std::memset(&address.storage, 0, sizeof(address.storage));
+        std::memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+        address.length = static_cast<socklen_t>(info->ai_addrlen);
+        sorted.push_back(address);
+    }
+    if (results) {
+        freeaddrinfo(results);
+    }
+    if (error == 0 && sorted.empty()) {
+        error = EAI_NONAME;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        Entry& entry = state->cache[host];
+        entry.pending = false;
+        entry.error = error;
+        
+        // A failed lookup keeps the stale answer; it is still the best guess
+        if (!sorted.empty()) {
+            entry.addresses = interleave_families(sorted);
+            entry.expires = std::chrono::steady_clock::now() + kTtl;
+        }
+    }
+    state->resolved.notify_all();
+}
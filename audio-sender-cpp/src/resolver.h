@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+struct ResolvedAddress {
+    struct sockaddr_storage storage;
+    socklen_t length;
+    
+    int family() const { return storage.ss_family; }
+    const struct sockaddr* address() const { return reinterpret_cast<const struct sockaddr*>(&storage); }
+    std::string to_string() const;
+};
+
+// Name lookups with getaddrinfo on background threads and a short-lived cache.
+// A lookup that is slow or failing does not hold up the caller for longer
+// than its timeout, and a stale answer is preferred over no answer, so a
+// reconnect during a DNS outage still finds the relay.
+class Resolver {
+public:
+    static constexpr auto kTtl = std::chrono::seconds(30);
+    
+    static Resolver& instance() {
+        static Resolver resolver;
+        return resolver;
+    }
+    
+    // Starts a lookup in the background so a later resolve() finds it cached
+    void prefetch(const std::string& host);
+    
+    // Addresses for host with the port filled in, IPv6 and IPv4 interleaved
+    // in the order connection attempts should be made (RFC 8305). Returns a
+    // fresh cached answer at once, otherwise waits up to timeout for the
+    // lookup and falls back to a stale answer.
+    bool resolve(const std::string& host, int port, std::vector<ResolvedAddress>& addresses,
+                 std::chrono::milliseconds timeout);
+
+private:
+    struct Entry {
+        std::vector<ResolvedAddress> addresses;
+        std::chrono::steady_clock::time_point expires;
+        bool pending = false;
+        int error = 0;
+    };
+    
+    // Outlives the Resolver: getaddrinfo cannot be cancelled, so lookup
+    // threads are detached and keep the state alive until they finish
+    struct State {
+        std::mutex mutex;
+        std::condition_variable resolved;
+        std::map<std::string, Entry> cache;
+    };
+    
+    Resolver() : state_(std::make_shared<State>()) {}
+    
+    static void start_lookup_locked(const std::shared_ptr<State>& state, const std::string& host);
+    static void lookup(std::shared_ptr<State> state, std::string host);
+    
+    std::shared_ptr<State> state_;
+};
@@ -0,0 +1,100 @@
+#include "ring_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+FrameRingBuffer::FrameRingBuffer(size_t frame_count, size_t max_frame_samples)
+    : frames_(std::max<size_t>(frame_count, 2)),
+      max_frame_samples_(std::max<size_t>(max_frame_samples, 1)) {
+    for (auto& frame : frames_) {
+        frame.samples.resize(max_frame_samples_);
+    }
+}
+
+size_t FrameRingBuffer::frames_for_depth(int depth_ms, int sample_rate, int channels, size_t frame_samples) {
+    if (frame_samples == 0) return 2;
+    
+    uint64_t depth_samples = static_cast<uint64_t>(depth_ms) * sample_rate * channels / 1000;
+    size_t frames = static_cast<size_t>((depth_samples + frame_samples - 1) / frame_samples);
+    return std::max<size_t>(frames, 2);
+}
+
+bool FrameRingBuffer::has_room(const AudioBlock& block) const {
+    if (block.channels <= 0 || block.frames == 0) return true;
+    
+    uint64_t write = write_pos_.load(std::memory_order_relaxed);
+    uint64_t read = read_pos_.load(std::memory_order_acquire);
+    
+    size_t slot_frames = std::max<size_t>(max_frame_samples_ / block.channels, 1);
+    size_t needed = (block.frames + slot_frames - 1) / slot_frames;
+    return write - read + needed <= frames_.size();
+}
+
+bool FrameRingBuffer::push(const AudioBlock& block) {
+    if (block.channels <= 0 || block.frames == 0) return true;
+    
+    // Drop the whole block rather than queue a partial one
+    if (!has_room(block)) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    uint64_t write = write_pos_.load(std::memory_order_relaxed);
+    size_t slot_frames = std::max<size_t>(max_frame_samples_ / block.channels, 1);
+    const float* data = block.data;
+    size_t remaining = block.frames;
+    uint64_t sample_time = block.sample_time;
+    
+    while (remaining > 0) {
+        Frame& frame = frames_[write % frames_.size()];
+        size_t chunk = std::min(remaining, slot_frames);
+        size_t samples = chunk * block.channels;
+        
+        std::memcpy(frame.samples.data(), data, samples * sizeof(float));
+        frame.frames = chunk;
+        frame.channels = block.channels;
+        frame.sample_time = sample_time;
+        frame.host_time_ns = block.host_time_ns;
+        
+        write_pos_.store(++write, std::memory_order_release);
+        data += samples;
+        remaining -= chunk;
+        sample_time += chunk;
+    }
+    
+    return true;
+}
+
+const FrameRingBuffer::Frame* FrameRingBuffer::front() const {
+    uint64_t read = read_pos_.load(std::memory_order_relaxed);
+    uint64_t write = write_pos_.load(std::memory_order_acquire);
+    
+    if (read == write) return nullptr;
+    return &frames_[read % frames_.size()];
+}
+
+const FrameRingBuffer::Frame* FrameRingBuffer::wait_front(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    
+    // The producer is a real-time thread and must not signal, so poll
+    while (true) {
+        if (const Frame* frame = front()) return frame;
+        
+        if (std::chrono::steady_clock::now() >= deadline) {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void FrameRingBuffer::pop() {
+    uint64_t read = read_pos_.load(std::memory_order_relaxed);
+    read_pos_.store(read + 1, std::memory_order_release);
+}
+
+size_t FrameRingBuffer::size() const {
+    uint64_t write = write_pos_.load(std::memory_order_acquire);
+    uint64_t read = read_pos_.load(std::memory_order_acquire);
+    return static_cast<size_t>(write - read);
+}
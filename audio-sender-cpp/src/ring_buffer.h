@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_base.h"
+
+// Wait-free single-producer/single-consumer ring of preallocated audio frames.
+// The capture thread only copies into it with push(); a sender thread drains
+// it with front()/pop() and does all blocking I/O.
+class FrameRingBuffer {
+public:
+    struct Frame {
+        std::vector<float> samples;  // capacity fixed at construction
+        size_t frames = 0;           // valid frames in this slot
+        int channels = 0;
+        uint64_t sample_time = 0;
+        int64_t host_time_ns = 0;
+        
+        size_t sample_count() const { return frames * static_cast<size_t>(channels); }
+    };
+    
+    FrameRingBuffer(size_t frame_count, size_t max_frame_samples);
+    
+    // Number of frames of frame_samples interleaved samples needed to hold depth_ms
+    static size_t frames_for_depth(int depth_ms, int sample_rate, int channels, size_t frame_samples);
+    
+    // Producer side: never blocks or allocates. Blocks longer than one slot are
+    // split across slots. Returns false (and counts an overrun) if the block does not fit.
+    bool push(const AudioBlock& block);
+    
+    // Producer side: whether push(block) would succeed right now
+    bool has_room(const AudioBlock& block) const;
+    
+    // Consumer side: oldest queued frame, or nullptr if the ring is empty
+    const Frame* front() const;
+    
+    // Consumer side: wait up to timeout for a frame; counts an underrun on timeout
+    const Frame* wait_front(std::chrono::milliseconds timeout);
+    
+    // Consumer side: release the frame returned by front()
+    void pop();
+    
+    size_t capacity() const { return frames_.size(); }
+    size_t size() const;
+    
+    uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    
+private:
+    std::vector<Frame> frames_;
+    size_t max_frame_samples_;
+    
+    // Monotonic counters; slot index is counter % capacity
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    alignas(64) std::atomic<uint64_t> read_pos_{0};
+    
+    alignas(64) std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> underruns_{0};
+};
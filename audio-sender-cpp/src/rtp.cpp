@@ -0,0 +1,314 @@
+#include "rtp.h"
+#include <random>
+#include <sstream>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// RTCP packet types (RFC 3550 section 12.1)
+constexpr uint8_t kSenderReport = 200;
+constexpr uint8_t kReceiverReport = 201;
+constexpr uint8_t kSourceDescription = 202;
+constexpr uint8_t kGoodbye = 203;
+constexpr uint8_t kCname = 1;
+
+constexpr size_t kReportBlockSize = 24;
+
+// Deterministic report interval before randomization; fine for one sender
+constexpr double kReportIntervalSeconds = 5.0;
+
+// Reads per poll(); RTCP arrives every few seconds at most
+constexpr int kMaxReadsPerPoll = 8;
+
+// Seconds from the NTP epoch (1900) to the Unix epoch (1970)
+constexpr uint64_t kNtpUnixOffset = 2208988800ull;
+
+void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, static_cast<uint16_t>(value >> 16));
+    put_u16(out + 2, static_cast<uint16_t>(value));
+}
+
+uint16_t get_u16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(get_u16(in)) << 16) | get_u16(in + 2);
+}
+
+// Wall clock as 64-bit NTP: seconds since 1900 in the high word, fraction in the low
+uint64_t ntp_now() {
+    auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+    uint64_t seconds = static_cast<uint64_t>(micros / 1000000) + kNtpUnixOffset;
+    uint64_t fraction = (static_cast<uint64_t>(micros % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+// The middle 32 bits, the unit of LSR and DLSR: 1/65536 s
+uint32_t ntp_middle(uint64_t ntp) {
+    return static_cast<uint32_t>(ntp >> 16);
+}
+
+std::string local_cname() {
+    char host[256] = {};
+    if (gethostname(host, sizeof(host) - 1) != 0 || host[0] == '\0') {
+        return "audio-sender@localhost";
+    }
+    return std::string("audio-sender@") + host;
+}
+
+// Common RTCP header: version 2, no padding, item count, type, length in words minus one
+void put_rtcp_header(uint8_t* out, uint8_t count, uint8_t type, size_t bytes) {
+    out[0] = static_cast<uint8_t>(0x80 | (count & 0x1f));
+    out[1] = type;
+    put_u16(out + 2, static_cast<uint16_t>(bytes / 4 - 1));
+}
+
+} // namespace
+
+bool RtpFormat::for_codec(const CodecConfig& codec, int payload_type, RtpFormat& format) {
+    format.channels = codec.channels;
+    format.clock_rate = static_cast<uint32_t>(codec.sample_rate);
+    format.fmtp.clear();
+    
+    if (codec.codec == Codec::Opus) {
+        // RFC 7587: always a 48 kHz clock and "/2", whatever is actually encoded
+        format.encoding_name = "opus";
+        format.clock_rate = 48000;
+        format.channels = 2;
+        format.payload_type = static_cast<uint8_t>(payload_type >= 0 ? payload_type : kOpusPayloadType);
+        format.fmtp = "sprop-maxcapturerate=" + std::to_string(codec.sample_rate);
+        if (codec.channels == 2) {
+            format.fmtp += "; stereo=1; sprop-stereo=1";
+        }
+        return true;
+    }
+    
+    switch (codec.format) {
+    case SampleFormat::S16:
+        format.encoding_name = "L16";
+        format.payload_type = kDynamicPayloadType;
+        // RFC 3551 static types: 10 is 44.1 kHz stereo, 11 is 44.1 kHz mono
+        if (codec.sample_rate == 44100 && codec.channels <= 2) {
+            format.payload_type = codec.channels == 2 ? 10 : 11;
+        }
+        break;
+    case SampleFormat::S24:
+        format.encoding_name = "L24";
+        format.payload_type = kDynamicPayloadType;
+        break;
+    case SampleFormat::F32:
+        return false;
+    }
+    if (payload_type >= 0) {
+        format.payload_type = static_cast<uint8_t>(payload_type);
+    }
+    return true;
+}
+
+std::string RtpFormat::sdp(const std::string& address, int port, uint32_t ssrc) const {
+    const char* family = address.find(':') != std::string::npos ? "IP6" : "IP4";
+    std::ostringstream out;
+    out << "v=0\r\n";
+    out << "o=- " << ssrc << " 0 IN " << family << " " << address << "\r\n";
+    out << "s=audio-sender\r\n";
+    out << "c=IN " << family << " " << address << "\r\n";
+    out << "t=0 0\r\n";
+    out << "m=audio " << port << " RTP/AVP " << int(payload_type) << "\r\n";
+    out << "a=rtpmap:" << int(payload_type) << " " << encoding_name << "/" << clock_rate;
+    if (channels > 1) {
+        out << "/" << channels;
+    }
+    out << "\r\n";
+    if (!fmtp.empty()) {
+        out << "a=fmtp:" << int(payload_type) << " " << fmtp << "\r\n";
+    }
+    out << "a=ssrc:" << ssrc << " cname:" << local_cname() << "\r\n";
+    return out.str();
+}
+
+void RtpHeader::serialize(uint8_t* out) const {
+    out[0] = 0x80;
+    out[1] = static_cast<uint8_t>((marker ? 0x80 : 0) | (payload_type & 0x7f));
+    put_u16(out + 2, sequence);
+    put_u32(out + 4, timestamp);
+    put_u32(out + 8, ssrc);
+}
+
+bool RtpHeader::parse(const uint8_t* in, size_t size, RtpHeader& header) {
+    if (size < kSize || (in[0] >> 6) != 2) return false;
+    
+    header.marker = (in[1] & 0x80) != 0;
+    header.payload_type = in[1] & 0x7f;
+    header.sequence = get_u16(in + 2);
+    header.timestamp = get_u32(in + 4);
+    header.ssrc = get_u32(in + 8);
+    return true;
+}
+
+RtcpSession::RtcpSession(Network& network, uint32_t ssrc, uint32_t clock_rate)
+    : network_(network), ssrc_(ssrc), clock_rate_(clock_rate), cname_(local_cname()),
+      random_(std::random_device()()) {
+}
+
+void RtcpSession::sent(const ConstBuffer* parts, size_t count) {
+    RtpHeader header;
+    if (count == 0 || !RtpHeader::parse(parts[0].data, parts[0].size, header)) return;
+    
+    packets_++;
+    for (size_t i = 1; i < count; i++) {
+        octets_ += static_cast<uint32_t>(parts[i].size);
+    }
+    last_timestamp_ = header.timestamp;
+    last_sent_ = std::chrono::steady_clock::now();
+    
+    // The first report goes out with the first packet, so receivers can sync early
+    if (!started_) {
+        started_ = true;
+        next_report_ = last_sent_;
+    }
+}
+
+bool RtcpSession::poll() {
+    if (started_ && std::chrono::steady_clock::now() >= next_report_) {
+        send_compound(false);
+        schedule_next();
+    }
+    
+    bool reported = false;
+    for (int reads = 0; reads < kMaxReadsPerPoll; reads++) {
+        int received = network_.receive(buffer_, sizeof(buffer_));
+        if (received <= 0) break;
+        
+        bool report = parse(buffer_, static_cast<size_t>(received));
+        reported = reported || report;
+    }
+    return reported;
+}
+
+void RtcpSession::send_bye() {
+    if (started_) {
+        send_compound(true);
+    }
+}
+
+void RtcpSession::schedule_next() {
+    // RFC 3550 6.3.1: randomize over [0.5, 1.5] of the interval so reports do not synchronize
+    std::uniform_real_distribution<double> spread(0.5, 1.5);
+    auto interval = std::chrono::duration<double>(kReportIntervalSeconds * spread(random_));
+    next_report_ = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+}
+
+void RtcpSession::send_compound(bool bye) {
+    uint8_t packet[kMaxCompound];
+    size_t size = 0;
+    
+    // SR: sender info, no report blocks since we receive nothing
+    uint64_t ntp = ntp_now();
+    auto since_last = std::chrono::steady_clock::now() - last_sent_;
+    double elapsed = std::chrono::duration<double>(since_last).count();
+    uint32_t timestamp = last_timestamp_ + static_cast<uint32_t>(elapsed * clock_rate_);
+    put_rtcp_header(packet, 0, kSenderReport, 28);
+    put_u32(packet + 4, ssrc_);
+    put_u32(packet + 8, static_cast<uint32_t>(ntp >> 32));
+    put_u32(packet + 12, static_cast<uint32_t>(ntp));
+    put_u32(packet + 16, timestamp);
+    put_u32(packet + 20, packets_);
+    put_u32(packet + 24, octets_);
+    size += 28;
+    
+    // SDES with our CNAME, null-terminated and padded to a word boundary
+    size_t cname = std::min<size_t>(cname_.size(), 255);
+    size_t sdes = (4 + 4 + 2 + cname + 1 + 3) / 4 * 4;
+    uint8_t* chunk = packet + size;
+    std::fill(chunk, chunk + sdes, 0);
+    put_rtcp_header(chunk, 1, kSourceDescription, sdes);
+    put_u32(chunk + 4, ssrc_);
+    chunk[8] = kCname;
+    chunk[9] = static_cast<uint8_t>(cname);
+    std::copy(cname_.begin(), cname_.begin() + cname, chunk + 10);
+    size += sdes;
+    
+    if (bye) {
+        put_rtcp_header(packet + size, 1, kGoodbye, 8);
+        put_u32(packet + size + 4, ssrc_);
+        size += 8;
+    }
+    
+    ConstBuffer buffer{packet, size};
+    if (network_.send(&buffer, 1)) {
+        stats_.sender_reports++;
+    }
+}
+
+bool RtcpSession::parse(const uint8_t* data, size_t size) {
+    bool reported = false;
+    
+    // Walk the compound packet; anything malformed ends it
+    while (size >= 4) {
+        if ((data[0] >> 6) != 2) break;
+        size_t count = data[0] & 0x1f;
+        uint8_t type = data[1];
+        size_t length = (static_cast<size_t>(get_u16(data + 2)) + 1) * 4;
+        if (length > size) break;
+        
+        size_t blocks = 0;
+        if (type == kSenderReport) {
+            blocks = 28;
+        } else if (type == kReceiverReport) {
+            blocks = 8;
+        }
+        if (blocks > 0 && blocks + count * kReportBlockSize <= length) {
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t* block = data + blocks + i * kReportBlockSize;
+                if (get_u32(block) == ssrc_) {
+                    handle_block(block);
+                    reported = true;
+                }
+            }
+        }
+        
+        data += length;
+        size -= length;
+    }
+    return reported;
+}
+
+void RtcpSession::handle_block(const uint8_t* block) {
+    uint8_t fraction = block[4];
+    uint32_t cumulative = get_u32(block + 4) & 0xffffff;
+    uint32_t jitter = get_u32(block + 12);
+    uint32_t last_sr = get_u32(block + 16);
+    uint32_t delay = get_u32(block + 20);
+    
+    feedback_.loss = fraction / 256.0;
+    feedback_.jitter_ms = jitter * 1000.0 / clock_rate_;
+    feedback_.queue_ms = 0.0;
+    
+    // RFC 3550 6.4.1: RTT = arrival - LSR - DLSR, all in 1/65536 s; 0 means no SR seen yet
+    if (last_sr != 0) {
+        uint32_t rtt = ntp_middle(ntp_now()) - last_sr - delay;
+        if (rtt < 0x80000000u) {
+            feedback_.rtt_ms = rtt * 1000.0 / 65536.0;
+        }
+    }
+    
+    stats_.receiver_reports++;
+    stats_.cumulative_lost = cumulative;
+    stats_.last_loss = feedback_.loss;
+    stats_.last_jitter_ms = feedback_.jitter_ms;
+    stats_.last_rtt_ms = feedback_.rtt_ms;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+#include "codec.h"
+#include "network.h"
+#include "feedback.h"
+
+// RTP payload format of the stream (RFC 3551, RFC 3190, RFC 7587)
+struct RtpFormat {
+    static constexpr uint8_t kDynamicPayloadType = 96;
+    static constexpr uint8_t kOpusPayloadType = 111;   // what WebRTC stacks expect
+    
+    uint8_t payload_type = kDynamicPayloadType;
+    uint32_t clock_rate = 16000;    // RTP timestamp units per second
+    int channels = 1;
+    std::string encoding_name;      // as in an SDP rtpmap: "L16", "L24", "opus"
+    std::string fmtp;               // format parameters, empty if none
+    
+    // Picks the format for the codec. L16 at 44.1 kHz uses the static types
+    // 10/11, everything else a dynamic type; payload_type >= 0 overrides it.
+    // False if the codec has no RTP payload format (f32 PCM).
+    static bool for_codec(const CodecConfig& codec, int payload_type, RtpFormat& format);
+    
+    // Session description a receiver (ffmpeg, GStreamer, a recorder) can open
+    std::string sdp(const std::string& address, int port, uint32_t ssrc) const;
+};
+
+// Fixed RTP header (RFC 3550 section 5.1); no CSRCs or extensions
+//
+//   0  u8   V=2, P=0, X=0, CC=0
+//   1  u8   marker bit, payload type
+//   2  u16  sequence number
+//   4  u32  timestamp on the payload format's clock
+//   8  u32  SSRC
+struct RtpHeader {
+    static constexpr size_t kSize = 12;
+    
+    bool marker = false;
+    uint8_t payload_type = 0;
+    uint16_t sequence = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    
+    void serialize(uint8_t* out) const;
+    static bool parse(const uint8_t* in, size_t size, RtpHeader& header);
+};
+
+struct RtcpStats {
+    uint64_t sender_reports = 0;
+    uint64_t receiver_reports = 0;  // report blocks about our SSRC
+    uint32_t cumulative_lost = 0;
+    double last_loss = 0.0;
+    double last_jitter_ms = 0.0;
+    double last_rtt_ms = -1.0;
+};
+
+// The RTCP side of an RTP session, on its own socket (RTP port + 1).
+// Sends compound sender reports (SR + SDES CNAME) every 5 seconds,
+// randomized as RFC 3550 asks, and a BYE on close. Receiver report blocks
+// about our SSRC become PathFeedback for rate control, with the RTT from
+// their LSR/DLSR fields. Sender thread only.
+class RtcpSession {
+public:
+    RtcpSession(Network& network, uint32_t ssrc, uint32_t clock_rate);
+    
+    // One RTP message (RTP header part, then payload parts) was submitted
+    void sent(const ConstBuffer* parts, size_t count);
+    
+    // Sends a sender report if one is due and reads receiver reports;
+    // true if a report block about our stream arrived
+    bool poll();
+    
+    void send_bye();
+    
+    const PathFeedback& feedback() const { return feedback_; }
+    const RtcpStats& stats() const { return stats_; }
+
+private:
+    // SR + SDES CNAME, with a BYE appended when leaving
+    static constexpr size_t kMaxCompound = 28 + 268 + 8;
+    void send_compound(bool bye);
+    
+    bool parse(const uint8_t* data, size_t size);
+    void handle_block(const uint8_t* block);
+    void schedule_next();
+    
+    Network& network_;
+    uint32_t ssrc_;
+    uint32_t clock_rate_;
+    std::string cname_;
+    
+    // Sender info for the next report
+    uint32_t packets_ = 0;
+    uint32_t octets_ = 0;
+    uint32_t last_timestamp_ = 0;
+    std::chrono::steady_clock::time_point last_sent_;
+    bool started_ = false;
+    
+    std::chrono::steady_clock::time_point next_report_;
+    std::minstd_rand random_;
+    uint8_t buffer_[1500];
+    
+    PathFeedback feedback_;
+    RtcpStats stats_;
+};
@@ -0,0 +1,418 @@
+#include "sample_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAMPLE_FORMAT_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SAMPLE_FORMAT_AVX2 1
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SAMPLE_FORMAT_NEON 1
+#endif
+
+namespace {
+
+constexpr float kS16Scale = 32767.0f;
+constexpr float kS16Min = -32768.0f;
+constexpr float kS16Max = 32767.0f;
+constexpr float kS24Scale = 8388607.0f;
+constexpr float kS24Min = -8388608.0f;
+constexpr float kS24Max = 8388607.0f;
+
+// 24 random bits to [0, 1)
+constexpr float kDitherUnit = 1.0f / 16777216.0f;
+constexpr size_t kLanes = SampleConverter::kDitherLanes;
+
+inline uint32_t xorshift(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Every kernel follows exactly these steps, in this order, so results match:
+// scale, add dither, clamp (NaN clamps to hi), round to nearest even
+template <typename T>
+void quantize_scalar(const float* in, size_t count, T* out, float scale, float lo, float hi,
+                     uint32_t* lanes, bool dither) {
+    for (size_t base = 0; base < count; base += kLanes) {
+        float noise[kLanes] = {};
+        if (dither) {
+            for (size_t l = 0; l < kLanes; l++) {
+                float u1 = static_cast<float>(xorshift(lanes[l]) >> 8) * kDitherUnit;
+                float u2 = static_cast<float>(xorshift(lanes[l]) >> 8) * kDitherUnit;
+                noise[l] = u1 - u2;
+            }
+        }
+        
+        size_t n = std::min(kLanes, count - base);
+        for (size_t l = 0; l < n; l++) {
+            float y = in[base + l] * scale;
+            y = y + noise[l];
+            y = y < hi ? y : hi;
+            y = y > lo ? y : lo;
+            out[base + l] = static_cast<T>(std::lrintf(y));
+        }
+    }
+}
+
+using QuantizeI16 = size_t (*)(const float*, size_t, int16_t*, uint32_t*, bool);
+using QuantizeI32 = size_t (*)(const float*, size_t, int32_t*, float, float, float, uint32_t*, bool);
+
+// SIMD kernels handle whole groups of kLanes samples and return how many they did
+
+#ifdef SAMPLE_FORMAT_SSE2
+inline __m128i xorshift_sse2(__m128i s) {
+    s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+    s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+    return _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+}
+
+inline __m128 dither_sse2(__m128i& state) {
+    const __m128 unit = _mm_set1_ps(kDitherUnit);
+    state = xorshift_sse2(state);
+    __m128 u1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), unit);
+    state = xorshift_sse2(state);
+    __m128 u2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), unit);
+    return _mm_sub_ps(u1, u2);
+}
+
+inline void quantize_group_sse2(const float* in, __m128 scale, __m128 lo, __m128 hi,
+                                __m128i* state, bool dither, __m128i& out0, __m128i& out1) {
+    __m128 y0 = _mm_mul_ps(_mm_loadu_ps(in), scale);
+    __m128 y1 = _mm_mul_ps(_mm_loadu_ps(in + 4), scale);
+    if (dither) {
+        y0 = _mm_add_ps(y0, dither_sse2(state[0]));
+        y1 = _mm_add_ps(y1, dither_sse2(state[1]));
+    }
+    y0 = _mm_max_ps(_mm_min_ps(y0, hi), lo);
+    y1 = _mm_max_ps(_mm_min_ps(y1, hi), lo);
+    out0 = _mm_cvtps_epi32(y0);
+    out1 = _mm_cvtps_epi32(y1);
+}
+
+size_t quantize_i16_sse2(const float* in, size_t count, int16_t* out, uint32_t* lanes, bool dither) {
+    const __m128 scale = _mm_set1_ps(kS16Scale);
+    const __m128 lo = _mm_set1_ps(kS16Min);
+    const __m128 hi = _mm_set1_ps(kS16Max);
+    __m128i state[2] = {
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes + 4))
+    };
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        __m128i a, b;
+        quantize_group_sse2(in + i, scale, lo, hi, state, dither, a, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+    }
+    
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), state[0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 4), state[1]);
+    return done;
+}
+
+size_t quantize_i32_sse2(const float* in, size_t count, int32_t* out, float scale_value, float lo_value,
+                         float hi_value, uint32_t* lanes, bool dither) {
+    const __m128 scale = _mm_set1_ps(scale_value);
+    const __m128 lo = _mm_set1_ps(lo_value);
+    const __m128 hi = _mm_set1_ps(hi_value);
+    __m128i state[2] = {
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes + 4))
+    };
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        __m128i a, b;
+        quantize_group_sse2(in + i, scale, lo, hi, state, dither, a, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), b);
+    }
+    
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), state[0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 4), state[1]);
+    return done;
+}
+#endif
+
+#ifdef SAMPLE_FORMAT_AVX2
+__attribute__((target("avx2")))
+inline __m256i quantize_group_avx2(const float* in, __m256 scale, __m256 lo, __m256 hi,
+                                   __m256i& state, bool dither) {
+    __m256 y = _mm256_mul_ps(_mm256_loadu_ps(in), scale);
+    if (dither) {
+        const __m256 unit = _mm256_set1_ps(kDitherUnit);
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+        state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+        __m256 u1 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(state, 8)), unit);
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+        state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+        state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+        __m256 u2 = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(state, 8)), unit);
+        y = _mm256_add_ps(y, _mm256_sub_ps(u1, u2));
+    }
+    y = _mm256_max_ps(_mm256_min_ps(y, hi), lo);
+    return _mm256_cvtps_epi32(y);
+}
+
+__attribute__((target("avx2")))
+size_t quantize_i16_avx2(const float* in, size_t count, int16_t* out, uint32_t* lanes, bool dither) {
+    const __m256 scale = _mm256_set1_ps(kS16Scale);
+    const __m256 lo = _mm256_set1_ps(kS16Min);
+    const __m256 hi = _mm256_set1_ps(kS16Max);
+    __m256i state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        __m256i v = quantize_group_avx2(in + i, scale, lo, hi, state, dither);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), state);
+    return done;
+}
+
+__attribute__((target("avx2")))
+size_t quantize_i32_avx2(const float* in, size_t count, int32_t* out, float scale_value, float lo_value,
+                         float hi_value, uint32_t* lanes, bool dither) {
+    const __m256 scale = _mm256_set1_ps(scale_value);
+    const __m256 lo = _mm256_set1_ps(lo_value);
+    const __m256 hi = _mm256_set1_ps(hi_value);
+    __m256i state = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        __m256i v = quantize_group_avx2(in + i, scale, lo, hi, state, dither);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    }
+    
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), state);
+    return done;
+}
+#endif
+
+#ifdef SAMPLE_FORMAT_NEON
+inline uint32x4_t xorshift_neon(uint32x4_t s) {
+    s = veorq_u32(s, vshlq_n_u32(s, 13));
+    s = veorq_u32(s, vshrq_n_u32(s, 17));
+    return veorq_u32(s, vshlq_n_u32(s, 5));
+}
+
+inline int32x4_t quantize_quad_neon(const float* in, float32x4_t scale, float32x4_t lo, float32x4_t hi,
+                                    uint32x4_t& state, bool dither) {
+    float32x4_t y = vmulq_f32(vld1q_f32(in), scale);
+    if (dither) {
+        state = xorshift_neon(state);
+        float32x4_t u1 = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), kDitherUnit);
+        state = xorshift_neon(state);
+        float32x4_t u2 = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(state, 8)), kDitherUnit);
+        y = vaddq_f32(y, vsubq_f32(u1, u2));
+    }
+    // Select rather than vminq/vmaxq so NaN clamps to hi like the x86 kernels
+    y = vbslq_f32(vcltq_f32(y, hi), y, hi);
+    y = vbslq_f32(vcgtq_f32(y, lo), y, lo);
+    return vcvtnq_s32_f32(y);
+}
+
+size_t quantize_i16_neon(const float* in, size_t count, int16_t* out, uint32_t* lanes, bool dither) {
+    const float32x4_t scale = vdupq_n_f32(kS16Scale);
+    const float32x4_t lo = vdupq_n_f32(kS16Min);
+    const float32x4_t hi = vdupq_n_f32(kS16Max);
+    uint32x4_t state0 = vld1q_u32(lanes);
+    uint32x4_t state1 = vld1q_u32(lanes + 4);
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        int32x4_t a = quantize_quad_neon(in + i, scale, lo, hi, state0, dither);
+        int32x4_t b = quantize_quad_neon(in + i + 4, scale, lo, hi, state1, dither);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    
+    vst1q_u32(lanes, state0);
+    vst1q_u32(lanes + 4, state1);
+    return done;
+}
+
+size_t quantize_i32_neon(const float* in, size_t count, int32_t* out, float scale_value, float lo_value,
+                         float hi_value, uint32_t* lanes, bool dither) {
+    const float32x4_t scale = vdupq_n_f32(scale_value);
+    const float32x4_t lo = vdupq_n_f32(lo_value);
+    const float32x4_t hi = vdupq_n_f32(hi_value);
+    uint32x4_t state0 = vld1q_u32(lanes);
+    uint32x4_t state1 = vld1q_u32(lanes + 4);
+    
+    size_t done = count / kLanes * kLanes;
+    for (size_t i = 0; i < done; i += kLanes) {
+        vst1q_s32(out + i, quantize_quad_neon(in + i, scale, lo, hi, state0, dither));
+        vst1q_s32(out + i + 4, quantize_quad_neon(in + i + 4, scale, lo, hi, state1, dither));
+    }
+    
+    vst1q_u32(lanes, state0);
+    vst1q_u32(lanes + 4, state1);
+    return done;
+}
+#endif
+
+struct Kernels {
+    QuantizeI16 i16 = nullptr;
+    QuantizeI32 i32 = nullptr;
+    const char* name = "scalar";
+};
+
+const Kernels& kernels() {
+    static const Kernels selected = [] {
+        Kernels k;
+#ifdef SAMPLE_FORMAT_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            k.i16 = quantize_i16_avx2;
+            k.i32 = quantize_i32_avx2;
+            k.name = "avx2";
+            return k;
+        }
+#endif
+#ifdef SAMPLE_FORMAT_SSE2
+        k.i16 = quantize_i16_sse2;
+        k.i32 = quantize_i32_sse2;
+        k.name = "sse2";
+#endif
+#ifdef SAMPLE_FORMAT_NEON
+        k.i16 = quantize_i16_neon;
+        k.i32 = quantize_i32_neon;
+        k.name = "neon";
+#endif
+        return k;
+    }();
+    return selected;
+}
+
+void pack_s24(const int32_t* in, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v = static_cast<uint32_t>(in[i]);
+        out[i * 3] = static_cast<uint8_t>(v);
+        out[i * 3 + 1] = static_cast<uint8_t>(v >> 8);
+        out[i * 3 + 2] = static_cast<uint8_t>(v >> 16);
+    }
+}
+
+void pack_s24_be(const int32_t* in, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v = static_cast<uint32_t>(in[i]);
+        out[i * 3] = static_cast<uint8_t>(v >> 16);
+        out[i * 3 + 1] = static_cast<uint8_t>(v >> 8);
+        out[i * 3 + 2] = static_cast<uint8_t>(v);
+    }
+}
+
+// In place; simple enough for the compiler to vectorize
+void swap_s16(int16_t* samples, size_t count) {
+    auto* words = reinterpret_cast<uint16_t*>(samples);
+    for (size_t i = 0; i < count; i++) {
+        words[i] = static_cast<uint16_t>((words[i] << 8) | (words[i] >> 8));
+    }
+}
+
+} // namespace
+
+bool parse_sample_format(const std::string& name, SampleFormat& format) {
+    if (name == "f32") {
+        format = SampleFormat::F32;
+    } else if (name == "s16") {
+        format = SampleFormat::S16;
+    } else if (name == "s24") {
+        format = SampleFormat::S24;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* sample_format_name(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::F32: return "f32";
+    case SampleFormat::S16: return "s16";
+    case SampleFormat::S24: return "s24";
+    }
+    return "unknown";
+}
+
+size_t bytes_per_sample(SampleFormat format) {
+    switch (format) {
+    case SampleFormat::F32: return 4;
+    case SampleFormat::S16: return 2;
+    case SampleFormat::S24: return 3;
+    }
+    return 0;
+}
+
+SampleConverter::SampleConverter(SampleFormat format, bool dither, uint32_t seed)
+    : format_(format), dither_(dither) {
+    // xorshift32 must never hold zero
+    for (size_t l = 0; l < kDitherLanes; l++) {
+        lanes_[l] = (seed + 0x9E3779B9u * static_cast<uint32_t>(l + 1)) | 1u;
+    }
+}
+
+const char* SampleConverter::kernel_name() {
+    return kernels().name;
+}
+
+size_t SampleConverter::convert(const float* in, size_t count, uint8_t* out) {
+    const Kernels& k = kernels();
+    
+    switch (format_) {
+    case SampleFormat::F32:
+        std::memcpy(out, in, count * sizeof(float));
+        break;
+    case SampleFormat::S16: {
+        // The wire is little-endian; so is every target with a SIMD kernel
+        auto* samples = reinterpret_cast<int16_t*>(out);
+        size_t done = k.i16 ? k.i16(in, count, samples, lanes_, dither_) : 0;
+        quantize_scalar(in + done, count - done, samples + done, kS16Scale, kS16Min, kS16Max, lanes_, dither_);
+        if (big_endian_) swap_s16(samples, count);
+        break;
+    }
+    case SampleFormat::S24:
+        // Chunks are a multiple of the lane count so dither lanes line up with convert_scalar()
+        for (size_t base = 0; base < count; base += sizeof(scratch_) / sizeof(scratch_[0])) {
+            size_t n = std::min(count - base, sizeof(scratch_) / sizeof(scratch_[0]));
+            size_t done = k.i32 ? k.i32(in + base, n, scratch_, kS24Scale, kS24Min, kS24Max, lanes_, dither_) : 0;
+            quantize_scalar(in + base + done, n - done, scratch_ + done, kS24Scale, kS24Min, kS24Max, lanes_, dither_);
+            (big_endian_ ? pack_s24_be : pack_s24)(scratch_, n, out + base * 3);
+        }
+        break;
+    }
+    
+    return count * bytes_per_sample(format_);
+}
+
+size_t SampleConverter::convert_scalar(const float* in, size_t count, uint8_t* out) {
+    switch (format_) {
+    case SampleFormat::F32:
+        std::memcpy(out, in, count * sizeof(float));
+        break;
+    case SampleFormat::S16:
+        quantize_scalar(in, count, reinterpret_cast<int16_t*>(out), kS16Scale, kS16Min, kS16Max, lanes_, dither_);
+        if (big_endian_) swap_s16(reinterpret_cast<int16_t*>(out), count);
+        break;
+    case SampleFormat::S24:
+        for (size_t base = 0; base < count; base += sizeof(scratch_) / sizeof(scratch_[0])) {
+            size_t n = std::min(count - base, sizeof(scratch_) / sizeof(scratch_[0]));
+            quantize_scalar(in + base, n, scratch_, kS24Scale, kS24Min, kS24Max, lanes_, dither_);
+            (big_endian_ ? pack_s24_be : pack_s24)(scratch_, n, out + base * 3);
+        }
+        break;
+    }
+    
+    return count * bytes_per_sample(format_);
+}
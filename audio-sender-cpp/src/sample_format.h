@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Wire sample formats, interleaved and little-endian unless the converter
+// is switched to network byte order (RTP L16/L24)
+enum class SampleFormat {
+    F32,
+    S16,
+    S24
+};
+
+bool parse_sample_format(const std::string& name, SampleFormat& format);
+const char* sample_format_name(SampleFormat format);
+size_t bytes_per_sample(SampleFormat format);
+
+// Converts float samples to the wire format with clipping and optional TPDF
+// dither. The SIMD kernels (SSE2/AVX2 on x86, NEON on AArch64) and the scalar
+// fallback produce bit-identical output for the same seed.
+class SampleConverter {
+public:
+    static constexpr size_t kDitherLanes = 8;
+    
+    explicit SampleConverter(SampleFormat format = SampleFormat::F32, bool dither = false, uint32_t seed = 1);
+    
+    // Writes count * bytes_per_sample(format) bytes to out; returns bytes written
+    size_t convert(const float* in, size_t count, uint8_t* out);
+    
+    // Reference implementation used when no SIMD kernel is available
+    size_t convert_scalar(const float* in, size_t count, uint8_t* out);
+    
+    SampleFormat format() const { return format_; }
+    bool dither() const { return dither_; }
+    
+    // Big-endian integer samples; float output stays little-endian
+    void set_big_endian(bool big_endian) { big_endian_ = big_endian; }
+    bool big_endian() const { return big_endian_; }
+    
+    // Name of the kernel convert() dispatches to on this CPU
+    static const char* kernel_name();
+
+private:
+    SampleFormat format_;
+    bool dither_;
+    bool big_endian_ = false;
+    
+    // One xorshift32 generator per lane; sample i of each group of eight uses lane i
+    uint32_t lanes_[kDitherLanes];
+    
+    // Scratch for S24 packing, so convert() never allocates
+    int32_t scratch_[256];
+};
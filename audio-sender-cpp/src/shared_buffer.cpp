@@ -0,0 +1,173 @@
+#include "shared_buffer.h"
+#include <algorithm>
+
+// Returned blocks, shared by the pool and every block it made so a block
+// can find out whether its pool still exists when its last reference goes.
+// Any thread pushes onto returned; only the owner takes, and it takes the
+// whole list, so a block is never popped while another thread pushes it.
+struct BufferPool::Free {
+    std::atomic<SharedBuffer::Block*> returned{nullptr};
+    std::atomic<size_t> block_size{0};
+    std::atomic<bool> closed{false};
+};
+
+struct SharedBuffer::Block {
+    std::atomic<uint32_t> references{1};
+    std::shared_ptr<BufferPool::Free> free;
+    std::vector<uint8_t> bytes;
+    Block* next = nullptr;                      // on a free list
+};
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : block_(other.block_), size_(other.size_) {
+    if (block_) {
+        block_->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer&& other) noexcept : block_(other.block_), size_(other.size_) {
+    other.block_ = nullptr;
+    other.size_ = 0;
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other) {
+    if (this != &other) {
+        SharedBuffer copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+SharedBuffer& SharedBuffer::operator=(SharedBuffer&& other) noexcept {
+    if (this != &other) {
+        reset();
+        block_ = other.block_;
+        size_ = other.size_;
+        other.block_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+SharedBuffer::~SharedBuffer() {
+    reset();
+}
+
+uint8_t* SharedBuffer::data() {
+    return block_ ? block_->bytes.data() : nullptr;
+}
+
+const uint8_t* SharedBuffer::data() const {
+    return block_ ? block_->bytes.data() : nullptr;
+}
+
+size_t SharedBuffer::capacity() const {
+    return block_ ? block_->bytes.size() : 0;
+}
+
+void SharedBuffer::resize(size_t size) {
+    size_ = std::min(size, capacity());
+}
+
+bool SharedBuffer::contains(const uint8_t* data, size_t size) const {
+    if (!block_) return false;
+    
+    const uint8_t* begin = block_->bytes.data();
+    return data >= begin && data + size <= begin + size_;
+}
+
+void SharedBuffer::reset() {
+    Block* block = block_;
+    block_ = nullptr;
+    size_ = 0;
+    if (!block || block->references.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    
+    // Last reference: back to the pool, unless the pool or its block size is gone
+    std::shared_ptr<BufferPool::Free> free = block->free;
+    if (free->closed.load() || block->bytes.size() != free->block_size.load(std::memory_order_relaxed)) {
+        delete block;
+        return;
+    }
+    block->next = free->returned.load(std::memory_order_relaxed);
+    while (!free->returned.compare_exchange_weak(block->next, block)) {
+    }
+    
+    // The pool closed meanwhile and may have missed this block; whoever
+    // takes the list frees it
+    if (free->closed.load()) {
+        BufferPool::delete_blocks(free->returned.exchange(nullptr));
+    }
+}
+
+void BufferPool::delete_blocks(SharedBuffer::Block* block) {
+    while (block) {
+        SharedBuffer::Block* next = block->next;
+        delete block;
+        block = next;
+    }
+}
+
+BufferPool::~BufferPool() {
+    if (!free_) return;
+    
+    free_->closed.store(true);
+    delete_blocks(free_->returned.exchange(nullptr));
+    delete_blocks(cached_);
+}
+
+void BufferPool::configure(size_t block_size, size_t preallocate) {
+    if (!free_) {
+        free_ = std::make_shared<Free>();
+    }
+    
+    // Blocks of another size still in flight are freed by acquire() if they come back anyway
+    if (free_->block_size.load(std::memory_order_relaxed) != block_size) {
+        free_->block_size.store(block_size, std::memory_order_relaxed);
+        delete_blocks(free_->returned.exchange(nullptr, std::memory_order_acquire));
+        delete_blocks(cached_);
+        cached_ = nullptr;
+    }
+    block_size_ = block_size;
+    
+    std::vector<SharedBuffer> ready;
+    ready.reserve(preallocate);
+    for (size_t i = 0; i < preallocate; i++) {
+        ready.push_back(acquire());
+    }
+}
+
+void BufferPool::reserve(size_t blocks) {
+    // Free blocks are taken first, so every acquire() past them allocates
+    std::vector<SharedBuffer> ready;
+    ready.reserve(blocks);
+    while (allocated_ < blocks) {
+        ready.push_back(acquire());
+    }
+}
+
+SharedBuffer BufferPool::acquire() {
+    if (!free_) {
+        configure(block_size_, 0);
+    }
+    
+    // Everything returned since the last time, in one exchange
+    if (!cached_) {
+        cached_ = free_->returned.exchange(nullptr, std::memory_order_acquire);
+    }
+    while (cached_) {
+        SharedBuffer::Block* block = cached_;
+        cached_ = block->next;
+        if (block->bytes.size() != block_size_) {
+            delete block;
+            continue;
+        }
+        block->next = nullptr;
+        block->references.store(1, std::memory_order_relaxed);
+        return SharedBuffer(block);
+    }
+    
+    SharedBuffer::Block* block = new SharedBuffer::Block();
+    block->free = free_;
+    block->bytes.resize(block_size_);
+    allocated_++;
+    return SharedBuffer(block);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Reference-counted byte buffer handed out by a BufferPool. Copies share the
+// bytes, so one encoded payload can sit in several send queues at once; the
+// last reference returns the block to its pool. Write into it only before
+// it is shared.
+class SharedBuffer {
+public:
+    SharedBuffer() = default;
+    SharedBuffer(const SharedBuffer& other);
+    SharedBuffer(SharedBuffer&& other) noexcept;
+    SharedBuffer& operator=(const SharedBuffer& other);
+    SharedBuffer& operator=(SharedBuffer&& other) noexcept;
+    ~SharedBuffer();
+    
+    uint8_t* data();
+    const uint8_t* data() const;
+    size_t size() const { return size_; }
+    size_t capacity() const;
+    
+    // Sets the valid length, clamped to the capacity; never reallocates
+    void resize(size_t size);
+    
+    // Whether [data, data + size) lies inside this buffer, e.g. a payload chunk
+    bool contains(const uint8_t* data, size_t size) const;
+    
+    // Drops this reference
+    void reset();
+    
+    explicit operator bool() const { return block_ != nullptr; }
+
+private:
+    friend class BufferPool;
+    struct Block;
+    
+    explicit SharedBuffer(Block* block) : block_(block) {}
+    
+    Block* block_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Fixed-size blocks for SharedBuffer. acquire() reuses a returned block
+// when one is free and allocates only while more are in flight than ever
+// before, so steady streaming stops allocating once the send queues have
+// filled. Blocks still referenced when the pool goes away are freed by
+// their last reference.
+//
+// The last reference may go away on any thread: it pushes the block onto a
+// lock-free list, and acquire() takes that whole list at once, so no lock
+// is shared with the thread that owns the pool. configure(), reserve() and
+// acquire() belong to that one thread (or to one thread at a time).
+class BufferPool {
+public:
+    BufferPool() = default;
+    ~BufferPool();
+    
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    
+    // Block size for later acquire() calls, with preallocate blocks ready;
+    // blocks of the old size are freed as they come back
+    void configure(size_t block_size, size_t preallocate);
+    
+    // A buffer of block_size capacity and zero size
+    SharedBuffer acquire();
+    
+    // Allocates up front until blocks exist in total, so that many in
+    // flight never allocate
+    void reserve(size_t blocks);
+    
+    size_t block_size() const { return block_size_; }
+    
+    // Blocks allocated so far; flat once streaming reaches a steady state
+    size_t allocated() const { return allocated_; }
+
+private:
+    friend class SharedBuffer;
+    struct Free;
+    
+    // Frees a list of blocks linked through next
+    static void delete_blocks(SharedBuffer::Block* block);
+    
+    std::shared_ptr<Free> free_;
+    SharedBuffer::Block* cached_ = nullptr;     // returned blocks taken by acquire(), owner only
+    size_t block_size_ = 0;
+    std::atomic<size_t> allocated_{0};
+};
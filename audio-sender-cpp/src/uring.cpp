@@ -0,0 +1,330 @@
+#include "uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_SINGLE_MMAP)
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+
+namespace {
+
+// Operations the send engine cannot do without (all in Linux 5.6)
+const uint8_t kRequiredOps[] = {IORING_OP_SENDMSG, IORING_OP_READ, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL};
+
+// Largest opcode the probe asks about
+constexpr unsigned kProbeOps = 256;
+
+int uring_setup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+} // namespace
+
+bool UringCompletion::more() const {
+#ifdef IORING_CQE_F_MORE
+    return (flags & IORING_CQE_F_MORE) != 0;
+#else
+    return false;
+#endif
+}
+
+bool UringCompletion::notification() const {
+#ifdef IORING_CQE_F_NOTIF
+    return (flags & IORING_CQE_F_NOTIF) != 0;
+#else
+    return false;
+#endif
+}
+
+bool IoUring::available() {
+    static const bool result = [] {
+        IoUring ring;
+        return ring.init(4);
+    }();
+    return result;
+}
+
+IoUring::~IoUring() {
+    close();
+}
+
+bool IoUring::init(unsigned entries) {
+    close();
+    
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = uring_setup(entries, &params);
+    if (fd_ < 0) {
+        fd_ = -1;
+        return false;
+    }
+    
+    // Kernels since 5.4 map both rings with one mmap
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    
+    ring_map_ = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (ring_map_ == MAP_FAILED) {
+        ring_map_ = nullptr;
+        close();
+        return false;
+    }
+    ring_map_size_ = sq_size;
+    
+    uint8_t* cq = static_cast<uint8_t*>(ring_map_);
+    if (!single) {
+        cq_map_ = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_map_ == MAP_FAILED) {
+            cq_map_ = nullptr;
+            close();
+            return false;
+        }
+        cq_map_size_ = cq_size;
+        cq = static_cast<uint8_t*>(cq_map_);
+    }
+    
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+    
+    uint8_t* sq = static_cast<uint8_t*>(ring_map_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    to_submit_ = 0;
+    
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    
+    // The probe (Linux 5.6) says which operations this kernel has
+    std::vector<uint8_t> probe_bytes(sizeof(struct io_uring_probe) + kProbeOps * sizeof(struct io_uring_probe_op));
+    auto* probe = reinterpret_cast<struct io_uring_probe*>(probe_bytes.data());
+    if (uring_register(fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+        close();
+        return false;
+    }
+    auto supported = [probe](uint8_t op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    };
+    for (uint8_t op : kRequiredOps) {
+        if (!supported(op)) {
+            close();
+            return false;
+        }
+    }
+#ifdef IORING_CQE_F_NOTIF
+    zerocopy_ = supported(IORING_OP_SENDMSG_ZC);
+#endif
+    return true;
+}
+
+void IoUring::close() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_map_) {
+        munmap(cq_map_, cq_map_size_);
+        cq_map_ = nullptr;
+    }
+    if (ring_map_) {
+        munmap(ring_map_, ring_map_size_);
+        ring_map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    fixed_fd_ = -1;
+    zerocopy_ = false;
+}
+
+bool IoUring::register_file(int fd) {
+    if (fd_ < 0 || uring_register(fd_, IORING_REGISTER_FILES, &fd, 1) < 0) return false;
+    fixed_fd_ = fd;
+    return true;
+}
+
+struct io_uring_sqe* IoUring::next_sqe(int fd, uint8_t opcode, uint64_t user_data) {
+    if (fd_ < 0) return nullptr;
+    
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_local_tail_ - head >= sq_entries_) return nullptr;
+    
+    unsigned index = sq_local_tail_ & sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    if (fd >= 0 && fd == fixed_fd_) {
+        sqe->fd = 0;
+        sqe->flags |= IOSQE_FIXED_FILE;
+    } else {
+        sqe->fd = fd;
+    }
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    sq_local_tail_++;
+    to_submit_++;
+    return sqe;
+}
+
+bool IoUring::prepare_sendmsg(int fd, const struct msghdr* message, int flags, uint64_t user_data, bool link,
+                              bool zerocopy) {
+    uint8_t opcode = IORING_OP_SENDMSG;
+#ifdef IORING_CQE_F_NOTIF
+    if (zerocopy && zerocopy_) {
+        opcode = IORING_OP_SENDMSG_ZC;
+    }
+#else
+    (void)zerocopy;
+#endif
+    
+    struct io_uring_sqe* sqe = next_sqe(fd, opcode, user_data);
+    if (!sqe) return false;
+    sqe->addr = reinterpret_cast<uint64_t>(message);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    if (link) {
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+    return true;
+}
+
+bool IoUring::prepare_read(int fd, void* buffer, size_t size, uint64_t user_data) {
+    struct io_uring_sqe* sqe = next_sqe(fd, IORING_OP_READ, user_data);
+    if (!sqe) return false;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = static_cast<uint32_t>(size);
+    return true;
+}
+
+bool IoUring::prepare_poll(int fd, uint32_t events, uint64_t user_data) {
+    struct io_uring_sqe* sqe = next_sqe(fd, IORING_OP_POLL_ADD, user_data);
+    if (!sqe) return false;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // The kernel reads the mask as two little-endian halves
+    events = (events << 16) | (events >> 16);
+#endif
+    sqe->poll32_events = events;
+    return true;
+}
+
+bool IoUring::prepare_cancel(uint64_t target, uint64_t user_data) {
+    struct io_uring_sqe* sqe = next_sqe(-1, IORING_OP_ASYNC_CANCEL, user_data);
+    if (!sqe) return false;
+    sqe->addr = target;
+    return true;
+}
+
+int IoUring::enter(unsigned wait_for) {
+    if (fd_ < 0) return -EBADF;
+    
+    // Publish the prepared entries before the kernel looks at the tail
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    int submitted = uring_enter(fd_, to_submit_, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (submitted < 0) return -errno;
+    to_submit_ -= std::min(to_submit_, static_cast<unsigned>(submitted));
+    return submitted;
+}
+
+bool IoUring::next_completion(UringCompletion& completion) {
+    if (fd_ < 0) return false;
+    
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) return false;
+    
+    const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    completion.user_data = cqe.user_data;
+    completion.result = cqe.res;
+    completion.flags = cqe.flags;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+bool UringCompletion::more() const {
+    return false;
+}
+
+bool UringCompletion::notification() const {
+    return false;
+}
+
+bool IoUring::available() {
+    return false;
+}
+
+IoUring::~IoUring() {
+}
+
+bool IoUring::init(unsigned) {
+    return false;
+}
+
+void IoUring::close() {
+}
+
+bool IoUring::register_file(int) {
+    return false;
+}
+
+bool IoUring::prepare_sendmsg(int, const struct msghdr*, int, uint64_t, bool, bool) {
+    return false;
+}
+
+bool IoUring::prepare_read(int, void*, size_t, uint64_t) {
+    return false;
+}
+
+bool IoUring::prepare_poll(int, uint32_t, uint64_t) {
+    return false;
+}
+
+bool IoUring::prepare_cancel(uint64_t, uint64_t) {
+    return false;
+}
+
+int IoUring::enter(unsigned) {
+    return -1;
+}
+
+bool IoUring::next_completion(UringCompletion&) {
+    return false;
+}
+
+#endif
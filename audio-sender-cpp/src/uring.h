@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct msghdr;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// One finished request
+struct UringCompletion {
+    uint64_t user_data = 0;
+    int32_t result = 0;         // bytes, or -errno
+    uint32_t flags = 0;
+    
+    // A zero-copy send reports twice: its result, then a notification once
+    // the kernel no longer reads the buffers
+    bool more() const;
+    bool notification() const;
+};
+
+// Minimal io_uring on the raw system calls, so there is no liburing to
+// build against. Requests are prepared into the submission queue and go to
+// the kernel with the next enter(). One thread per ring. Linux only;
+// elsewhere available() is false and init() fails.
+class IoUring {
+public:
+    // Whether the kernel allows io_uring (seccomp often does not) and has
+    // every operation the send engine uses; probed once per process
+    static bool available();
+    
+    IoUring() = default;
+    ~IoUring();
+    
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    
+    bool init(unsigned entries);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+    
+    // Whether SENDMSG_ZC (Linux 6.1) is available
+    bool zerocopy() const { return zerocopy_; }
+    
+    // Registers fd as the ring's fixed file, so requests on it skip the
+    // per-request file table lookup; later prepares on fd use it
+    bool register_file(int fd);
+    
+    // Each returns false when the submission queue is full. link makes the
+    // next request wait for this one and fail if it fails.
+    bool prepare_sendmsg(int fd, const struct msghdr* message, int flags, uint64_t user_data, bool link,
+                         bool zerocopy);
+    bool prepare_read(int fd, void* buffer, size_t size, uint64_t user_data);
+    bool prepare_poll(int fd, uint32_t events, uint64_t user_data);
+    bool prepare_cancel(uint64_t target, uint64_t user_data);
+    
+    // Submits everything prepared and waits until wait_for completions are
+    // ready. Returns requests submitted, or -errno.
+    int enter(unsigned wait_for);
+    
+    // Pops the next completion; false if none is ready
+    bool next_completion(UringCompletion& completion);
+
+private:
+    struct io_uring_sqe* next_sqe(int fd, uint8_t opcode, uint64_t user_data);
+    
+    int fd_ = -1;
+    int fixed_fd_ = -1;
+    bool zerocopy_ = false;
+    
+    void* ring_map_ = nullptr;
+    size_t ring_map_size_ = 0;
+    void* cq_map_ = nullptr;         // separate only on kernels without a single ring mapping
+    size_t cq_map_size_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;
+    unsigned to_submit_ = 0;
+    
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    struct io_uring_cqe* cqes_ = nullptr;
+};
@@ -0,0 +1,138 @@
+#include "vad.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+constexpr size_t kMaxFftSize = 512;
+constexpr size_t kMinFftSize = 64;
+
+} // namespace
+
+void VoiceActivityDetector::configure(const VadConfig& config, size_t max_frames) {
+    config_ = config;
+    mono_.assign(max_frames, 0.0f);
+    
+    // Largest power of two that fits a frame, for the flatness estimate
+    fft_size_ = kMinFftSize;
+    while (fft_size_ * 2 <= std::min(max_frames, kMaxFftSize)) {
+        fft_size_ *= 2;
+    }
+    
+    window_.resize(fft_size_);
+    for (size_t i = 0; i < fft_size_; i++) {
+        window_[i] = 0.5f - 0.5f * std::cos(2.0f * kPi * i / (fft_size_ - 1));
+    }
+    
+    spectrum_.assign(fft_size_, {0.0f, 0.0f});
+    twiddles_.resize(fft_size_ / 2);
+    for (size_t i = 0; i < fft_size_ / 2; i++) {
+        twiddles_[i] = std::polar(1.0f, -2.0f * kPi * i / fft_size_);
+    }
+    
+    noise_floor_db_ = config.silence_floor_db;
+    hangover_remaining_ = 0;
+    primed_ = false;
+}
+
+float VoiceActivityDetector::spectral_flatness(size_t frames) {
+    if (frames < fft_size_) return 1.0f;
+    
+    // Analyze the most recent fft_size_ samples
+    const float* src = mono_.data() + (frames - fft_size_);
+    for (size_t i = 0; i < fft_size_; i++) {
+        spectrum_[i] = {src[i] * window_[i], 0.0f};
+    }
+    
+    // In-place iterative radix-2 FFT
+    for (size_t i = 1, j = 0; i < fft_size_; i++) {
+        size_t bit = fft_size_ >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(spectrum_[i], spectrum_[j]);
+    }
+    for (size_t len = 2; len <= fft_size_; len <<= 1) {
+        size_t stride = fft_size_ / len;
+        for (size_t i = 0; i < fft_size_; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                std::complex<float> t = twiddles_[k * stride] * spectrum_[i + k + len / 2];
+                spectrum_[i + k + len / 2] = spectrum_[i + k] - t;
+                spectrum_[i + k] += t;
+            }
+        }
+    }
+    
+    // Geometric over arithmetic mean of the power spectrum, skipping DC
+    double log_sum = 0.0;
+    double sum = 0.0;
+    size_t bins = fft_size_ / 2;
+    for (size_t i = 1; i <= bins; i++) {
+        double power = std::norm(spectrum_[i]) + 1e-12;
+        log_sum += std::log(power);
+        sum += power;
+    }
+    return static_cast<float>(std::exp(log_sum / bins) / (sum / bins));
+}
+
+bool VoiceActivityDetector::process(const float* samples, size_t frames, int channels) {
+    frames = std::min(frames, mono_.size());
+    if (frames == 0) return hangover_remaining_ > 0;
+    
+    double energy = 0.0;
+    for (size_t i = 0; i < frames; i++) {
+        float sum = 0.0f;
+        for (int ch = 0; ch < channels; ch++) {
+            sum += samples[i * channels + ch];
+        }
+        mono_[i] = sum / channels;
+        energy += static_cast<double>(mono_[i]) * mono_[i];
+    }
+    
+    float energy_db = static_cast<float>(10.0 * std::log10(energy / frames + 1e-12));
+    last_energy_db_ = energy_db;
+    
+    // Flatness only matters once the frame is clearly above the floor
+    bool voiced = false;
+    if (energy_db > config_.silence_floor_db &&
+        (!primed_ || energy_db > noise_floor_db_ + config_.energy_margin_db)) {
+        last_flatness_ = spectral_flatness(frames);
+        voiced = last_flatness_ < config_.max_flatness;
+    }
+    
+    // Start the floor at the first frame if it looks like noise rather than speech
+    if (!primed_) {
+        if (!voiced) {
+            noise_floor_db_ = std::max(energy_db, config_.silence_floor_db);
+        }
+        primed_ = true;
+    }
+    
+    bool speech = false;
+    if (energy_db > config_.silence_floor_db) {
+        speech = energy_db > noise_floor_db_ + config_.loud_margin_db ||
+                 (voiced && energy_db > noise_floor_db_ + config_.energy_margin_db);
+    }
+    
+    // Floor follows drops quickly and rises about 3 dB/s through anything not voiced,
+    // so loud stationary noise is eventually treated as silence
+    float seconds = static_cast<float>(frames) / config_.sample_rate;
+    if (energy_db < noise_floor_db_) {
+        noise_floor_db_ += (energy_db - noise_floor_db_) * std::min(1.0f, 5.0f * seconds);
+    } else if (!voiced) {
+        noise_floor_db_ += std::min(energy_db - noise_floor_db_, 3.0f * seconds);
+    }
+    noise_floor_db_ = std::max(noise_floor_db_, config_.silence_floor_db - 30.0f);
+    
+    size_t hangover = static_cast<size_t>(config_.hangover_ms) * config_.sample_rate / 1000;
+    if (speech) {
+        hangover_remaining_ = hangover;
+        return true;
+    }
+    
+    if (hangover_remaining_ > 0) {
+        hangover_remaining_ = hangover_remaining_ > frames ? hangover_remaining_ - frames : 0;
+        return true;
+    }
+    return false;
+}
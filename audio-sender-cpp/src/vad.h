@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+struct VadConfig {
+    int sample_rate = 16000;
+    int hangover_ms = 300;          // stay active this long after the last speech frame
+    float energy_margin_db = 9.0f;  // above the noise floor to count as speech
+    float loud_margin_db = 20.0f;   // above the noise floor counts regardless of flatness
+    float max_flatness = 0.45f;     // spectral flatness below this looks voiced
+    float silence_floor_db = -60.0f;
+};
+
+// Energy and spectral-flatness voice activity detector with a hangover timer.
+// Tracks an adaptive noise floor; a frame is speech when it is clearly above
+// the floor and spectrally non-flat (or very loud). Buffers are sized in
+// configure(), so process() does not allocate.
+class VoiceActivityDetector {
+public:
+    void configure(const VadConfig& config, size_t max_frames);
+    
+    // Analyzes one interleaved frame; returns true while speech (or hangover) is active
+    bool process(const float* samples, size_t frames, int channels);
+    
+    // Applies from the next speech frame on
+    void set_hangover_ms(int hangover_ms) { config_.hangover_ms = hangover_ms; }
+    
+    float noise_floor_db() const { return noise_floor_db_; }
+    float last_energy_db() const { return last_energy_db_; }
+    float last_flatness() const { return last_flatness_; }
+
+private:
+    float spectral_flatness(size_t frames);
+    
+    VadConfig config_;
+    std::vector<float> mono_;
+    std::vector<float> window_;
+    std::vector<std::complex<float>> spectrum_;
+    std::vector<std::complex<float>> twiddles_;
+    size_t fft_size_ = 0;
+    
+    float noise_floor_db_ = -60.0f;
+    float last_energy_db_ = -100.0f;
+    float last_flatness_ = 1.0f;
+    size_t hangover_remaining_ = 0;
+    bool primed_ = false;
+};
@@ -0,0 +1,134 @@
+// Runs the ALSA capture backend without sound hardware.
+// Opens devices through AudioInterface::create() the way main.cpp does and
+// captures through the mmap path (snd_pcm_mmap_begin/commit):
+//   - "null", which delivers endless silence
+//   - a file PCM reading a known ramp from disk, defined in a private
+//     .asoundrc, so the delivered samples can be checked
+// Each run must deliver whole periods with continuous sample_time, stop
+// delivering once stop_capture() returns, and stop within kMaxStop.
+
+#include "audio_base.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kRate = 48000;
+constexpr int kChannels = 2;
+constexpr int kPeriod = 256;
+constexpr uint64_t kBlocks = 32;
+constexpr uint64_t kFileFrames = kPeriod * kBlocks;
+constexpr auto kMaxStop = std::chrono::milliseconds(250);
+
+// Sample the file holds for frame and channel; exact in float
+float ramp(uint64_t frame, int channel) {
+    return static_cast<float>(static_cast<int>(frame % 2000) - 1000) / 1024.0f + (channel == 0 ? 0.0f : 0.5f);
+}
+
+bool run_case(const std::string& name, const std::string& device, bool check_samples) {
+    auto audio = AudioInterface::create();
+    AudioConfig config;
+    config.device_name = device;
+    config.sample_rate = kRate;
+    config.channels = kChannels;
+    config.buffer_size = kPeriod;
+    if (!audio->initialize(config)) {
+        std::cout << "  " << name << ": cannot open " << device << std::endl;
+        return false;
+    }
+    
+    // Written on the capture thread only; read after stop_capture() joins it
+    std::atomic<uint64_t> blocks{0};
+    uint64_t next_time = 0;
+    uint64_t gaps = 0;
+    uint64_t short_blocks = 0;
+    uint64_t wrong_samples = 0;
+    audio->start_capture([&](const AudioBlock& block) {
+        if (block.sample_time != next_time) gaps++;
+        if (block.frames != static_cast<size_t>(kPeriod) || block.channels != kChannels) short_blocks++;
+        if (check_samples) {
+            for (size_t f = 0; f < block.frames && block.sample_time + f < kFileFrames; f++) {
+                for (int c = 0; c < kChannels; c++) {
+                    if (block.data[f * kChannels + c] != ramp(block.sample_time + f, c)) wrong_samples++;
+                }
+            }
+        }
+        next_time = block.sample_time + block.frames;
+        blocks++;
+    });
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (blocks < kBlocks && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    auto stop_start = std::chrono::steady_clock::now();
+    audio->stop_capture();
+    auto stop_time = std::chrono::steady_clock::now() - stop_start;
+    uint64_t stopped_at = blocks;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    
+    auto stop_ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop_time).count();
+    std::cout << "  " << name << ": " << stopped_at << " blocks, " << gaps << " sample_time gaps, " << short_blocks
+              << " partial blocks, " << wrong_samples << " wrong samples, stop took " << stop_ms << " ms"
+              << std::endl;
+    return stopped_at >= kBlocks && blocks == stopped_at && gaps == 0 && short_blocks == 0 && wrong_samples == 0 &&
+           stop_time <= kMaxStop;
+}
+
+// A private HOME whose .asoundrc defines a capture PCM reading from a file
+// of float samples; returns the device name for it
+std::string prepare_file_device(std::string& directory) {
+    char pattern[] = "/tmp/alsa-capture-XXXXXX";
+    if (!mkdtemp(pattern)) return "";
+    directory = pattern;
+    
+    std::ofstream input(directory + "/input.raw", std::ios::binary);
+    for (uint64_t f = 0; f < kFileFrames; f++) {
+        for (int c = 0; c < kChannels; c++) {
+            float sample = ramp(f, c);
+            input.write(reinterpret_cast<const char*>(&sample), sizeof(sample));
+        }
+    }
+    
+    std::ofstream asoundrc(directory + "/.asoundrc");
+    asoundrc << "pcm.sender_test {\n"
+                "    @args [ FILE ]\n"
+                "    @args.FILE { type string }\n"
+                "    type file\n"
+                "    slave.pcm \"null\"\n"
+                "    file \"/dev/null\"\n"
+                "    infile $FILE\n"
+                "    format \"raw\"\n"
+                "}\n";
+    if (!input || !asoundrc) return "";
+    
+    // ALSA reads ~/.asoundrc when the first device is opened
+    setenv("HOME", directory.c_str(), 1);
+    return "sender_test:FILE=\"" + directory + "/input.raw\"";
+}
+
+} // namespace
+
+int main() {
+    std::string directory;
+    std::string file_device = prepare_file_device(directory);
+    
+    bool passed = run_case("null", "null", false);
+    passed = !file_device.empty() && run_case("file", file_device, true) && passed;
+    
+    if (!directory.empty()) {
+        std::remove((directory + "/input.raw").c_str());
+        std::remove((directory + "/.asoundrc").c_str());
+        rmdir(directory.c_str());
+    }
+    std::cout << (passed ? "ALSA capture works without hardware\n" : "FAILED: ALSA capture\n");
+    return passed ? 0 : 1;
+}
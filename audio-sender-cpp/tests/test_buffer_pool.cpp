@@ -0,0 +1,131 @@
+// Checks BufferPool's lock-free return path.
+// One thread acquires blocks, stamps them and hands them to releaser
+// threads, which check the stamp and drop the last reference, as relay
+// shards do with TCP packets handed to each other. A block reused while
+// still referenced shows up as a wrong stamp, and allocated() must stay
+// within the blocks in flight. Then the pool is destroyed while other
+// threads still hold blocks, which they must be able to free safely (run
+// under a sanitizer to check for leaks).
+
+#include "shared_buffer.h"
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kReleasers = 3;
+constexpr size_t kInFlight = 64;
+constexpr uint64_t kBlocks = 200000;
+constexpr size_t kBlockBytes = 256;
+
+// Handoff between the owner and one releaser; the pool itself takes no lock
+struct Handoff {
+    std::mutex mutex;
+    std::deque<SharedBuffer> buffers;
+};
+
+bool check_handoff() {
+    BufferPool pool;
+    pool.configure(kBlockBytes, 0);
+    std::vector<Handoff> handoffs(kReleasers);
+    std::atomic<size_t> in_flight{0};
+    std::atomic<uint64_t> corrupted{0};
+    std::atomic<bool> done{false};
+    
+    std::vector<std::thread> releasers;
+    for (int r = 0; r < kReleasers; r++) {
+        releasers.emplace_back([&, r] {
+            Handoff& handoff = handoffs[static_cast<size_t>(r)];
+            while (true) {
+                SharedBuffer buffer;
+                {
+                    std::lock_guard<std::mutex> lock(handoff.mutex);
+                    if (!handoff.buffers.empty()) {
+                        buffer = std::move(handoff.buffers.front());
+                        handoff.buffers.pop_front();
+                    }
+                }
+                if (!buffer) {
+                    if (done) return;
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint64_t stamp;
+                std::memcpy(&stamp, buffer.data(), sizeof(stamp));
+                for (size_t i = sizeof(stamp); i < kBlockBytes; i++) {
+                    if (buffer.data()[i] != static_cast<uint8_t>(stamp)) {
+                        corrupted++;
+                        break;
+                    }
+                }
+                buffer.reset();
+                in_flight--;
+            }
+        });
+    }
+    
+    for (uint64_t n = 0; n < kBlocks; n++) {
+        while (in_flight >= kInFlight) {
+            std::this_thread::yield();
+        }
+        in_flight++;
+        SharedBuffer buffer = pool.acquire();
+        buffer.resize(kBlockBytes);
+        std::memcpy(buffer.data(), &n, sizeof(n));
+        std::memset(buffer.data() + sizeof(n), static_cast<uint8_t>(n), kBlockBytes - sizeof(n));
+        
+        // A second reference kept for a while, as when a packet waits in two queues
+        SharedBuffer copy = buffer;
+        Handoff& handoff = handoffs[n % kReleasers];
+        std::lock_guard<std::mutex> lock(handoff.mutex);
+        handoff.buffers.push_back(std::move(buffer));
+    }
+    done = true;
+    for (auto& thread : releasers) {
+        thread.join();
+    }
+    
+    std::cout << "  handoff: " << kBlocks << " blocks through " << kReleasers << " threads, " << pool.allocated()
+              << " allocated, " << corrupted << " reused too early" << std::endl;
+    return corrupted == 0 && pool.allocated() <= kInFlight;
+}
+
+bool check_pool_gone_first() {
+    std::vector<SharedBuffer> held;
+    std::thread releaser;
+    {
+        BufferPool pool;
+        pool.configure(kBlockBytes, 16);
+        for (int i = 0; i < 1000; i++) {
+            held.push_back(pool.acquire());
+        }
+        
+        // Half are released while the pool goes away, the rest after
+        releaser = std::thread([&held] {
+            for (size_t i = 0; i < held.size() / 2; i++) {
+                held[i].reset();
+            }
+        });
+    }
+    releaser.join();
+    releaser = std::thread([&held] {
+        held.clear();
+    });
+    releaser.join();
+    std::cout << "  pool destroyed first: blocks freed by their last reference" << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main() {
+    bool passed = check_handoff();
+    passed = check_pool_gone_first() && passed;
+    std::cout << (passed ? "Blocks come back safely from other threads\n" : "FAILED: the pool lost or reused blocks\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Fails if the steady-state capture-to-send path allocates.
+// Counts every global operator new, then drives the sender's hot path the
+// way main.cpp does: ring push, SendPipeline::process, packetizing and
+// Connection::submit through a Destination, over UDP with and without the
+// event loop and over TCP. After a warm-up that lets pools and queues reach
+// their working size, thousands more frames must not allocate at all.
+
+#include "destination.h"
+#include "pipeline.h"
+#include "ring_buffer.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+void* counted_alloc(std::size_t size, std::size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (alignment > alignof(std::max_align_t)) {
+        size = (size + alignment - 1) / alignment * alignment;
+        p = std::aligned_alloc(alignment, size);
+    } else {
+        p = std::malloc(size == 0 ? 1 : size);
+    }
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return counted_alloc(size, 0); }
+void* operator new[](std::size_t size) { return counted_alloc(size, 0); }
+void* operator new(std::size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int kCaptureRate = 48000;
+constexpr int kWireRate = 16000;
+constexpr size_t kPeriod = 480;         // 10 ms device periods
+constexpr int kWarmupFrames = 500;
+constexpr int kMeasuredFrames = 5000;
+
+// Loopback socket that swallows whatever the destination sends
+struct Sink {
+    int fd = -1;
+    int listener = -1;
+    int port = 0;
+    
+    bool open(int type) {
+        int sock = socket(AF_INET, type, 0);
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (sock < 0 || bind(sock, reinterpret_cast<struct sockaddr*>(&address), length) < 0 ||
+            getsockname(sock, reinterpret_cast<struct sockaddr*>(&address), &length) < 0) {
+            return false;
+        }
+        port = ntohs(address.sin_port);
+        if (type == SOCK_STREAM) {
+            listener = sock;
+            return listen(listener, 1) == 0;
+        }
+        fd = sock;
+        return true;
+    }
+    
+    void drain() {
+        if (fd < 0 && listener >= 0) {
+            fd = accept(listener, nullptr, nullptr);
+        }
+        static uint8_t buffer[65536];
+        while (fd >= 0 && recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+        }
+    }
+    
+    ~Sink() {
+        for (int s : {fd, listener}) {
+            if (s >= 0) close(s);
+        }
+    }
+};
+
+bool run_case(const std::string& name, const std::string& protocol, bool event_loop) {
+    Sink sink;
+    if (!sink.open(protocol == "tcp" ? SOCK_STREAM : SOCK_DGRAM)) {
+        std::cerr << name << ": cannot open the loopback sink" << std::endl;
+        return false;
+    }
+    
+    PipelineConfig pipeline_config;
+    pipeline_config.capture_rate = kCaptureRate;
+    pipeline_config.wire_rate = kWireRate;
+    pipeline_config.max_frames = kPeriod;
+    pipeline_config.codec.format = SampleFormat::S16;
+    SendPipeline pipeline;
+    if (!pipeline.configure(pipeline_config)) return false;
+    
+    DestinationSpec spec;
+    spec.protocol = protocol;
+    spec.host = "127.0.0.1";
+    spec.port = sink.port;
+    DestinationConfig config;
+    config.sample_rate = kWireRate;
+    config.stream_id = 0x7e57;
+    config.event_loop = event_loop;
+    config.engine.sample_rate = kWireRate;
+    config.bytes_per_second = pipeline.encoder().estimated_bytes(kWireRate);
+    Destination destination(spec, config);
+    if (!destination.open(pipeline) || !destination.configure_framing(pipeline)) {
+        std::cerr << name << ": cannot open the destination" << std::endl;
+        return false;
+    }
+    pipeline.reserve_payloads(destination.queue_frames());
+    
+    FrameRingBuffer ring(8, kPeriod);
+    std::vector<float> samples(kPeriod);
+    uint64_t sample_time = 0;
+    auto run = [&](int frames) {
+        for (int f = 0; f < frames; f++) {
+            for (size_t i = 0; i < kPeriod; i++) {
+                samples[i] = 0.5f * static_cast<float>(std::sin(0.05 * static_cast<double>(sample_time + i)));
+            }
+            AudioBlock block;
+            block.data = samples.data();
+            block.frames = kPeriod;
+            block.channels = 1;
+            block.sample_time = sample_time;
+            ring.push(block);
+            sample_time += kPeriod;
+            
+            const FrameRingBuffer::Frame* frame = ring.wait_front(std::chrono::milliseconds(100));
+            if (!frame) continue;
+            size_t count = pipeline.process(*frame);
+            ring.pop();
+            destination.send(pipeline, count, false);
+            destination.poll(true);
+            sink.drain();
+        }
+    };
+    
+    run(kWarmupFrames);
+    uint64_t before = allocations.load();
+    run(kMeasuredFrames);
+    uint64_t grown = allocations.load() - before;
+    destination.close(std::chrono::milliseconds(100));
+    
+    std::cout << "  " << name << ": " << grown << " allocations in " << kMeasuredFrames << " frames" << std::endl;
+    return grown == 0;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    passed = run_case("udp, blocking", "udp", false) && passed;
+    passed = run_case("udp, epoll", "udp", true) && passed;
+    passed = run_case("tcp, epoll", "tcp", true) && passed;
+    std::cout << (passed ? "The hot path does not allocate\n" : "FAILED: the hot path allocates\n");
+    return passed ? 0 : 1;
+}
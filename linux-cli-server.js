@@ -14,6 +14,158 @@ import { fileURLToPath } from 'url';
 const __filename = fileURLToPath(import.meta.url);
 const __dirname = path.dirname(__filename);
 
+// audio-sender-cpp packet header (see audio-sender-cpp/src/packet.h)
+const HEADER_SIZE = 32;
+const HEADER_MAGIC = 0x4153;
+const HEADER_VERSION = 1;
+const FLAG_FEC = 0x02;
+const FLAG_REPORT = 0x04;
+const REPORT_SIZE = 28;
+const REPORT_INTERVAL_MS = 1000;
+// A header claiming a bigger packet means the stream is not header-framed (kMaxPacketBytes in relay.cpp)
+const MAX_PACKET_BYTES = 1 << 20;
+
+function parseHeader(buffer) {
+    if (buffer.length < HEADER_SIZE || buffer.readUInt16BE(0) !== HEADER_MAGIC || buffer[2] !== HEADER_VERSION) {
+        return null;
+    }
+    return {
+        flags: buffer[3],
+        streamId: buffer.readUInt32BE(4),
+        sequence: buffer.readUInt32BE(8),
+        timestamp: Number(buffer.readBigUInt64BE(12)),
+        sampleRate: buffer.readUInt32BE(20),
+        fragment: buffer[26],
+        payloadLength: buffer.readUInt32BE(28)
+    };
+}
+
+// Per-sender reception statistics, kept like an RTCP receiver (RFC 3550
+// A.1, A.3 and A.8), and the receiver report the sender adapts to
+class ReceiverStats {
+    constructor() {
+        this.streamId = null;
+    }
+
+    reset(header) {
+        this.streamId = header.streamId;
+        this.sampleRate = header.sampleRate;
+        this.baseSequence = header.sequence;
+        this.maxSequence = header.sequence;
+        this.extendedMax = 0;
+        this.received = 0;
+        this.expectedPrior = 0;
+        this.receivedPrior = 0;
+        this.jitter = 0;
+        this.transit = null;
+        this.bytes = 0;
+        this.reports = 0;
+    }
+
+    onPacket(header, size, now) {
+        // Repairs reuse their group's sequence number; fragments share one
+        if (header.flags & (FLAG_FEC | FLAG_REPORT) || header.fragment !== 0 || header.sampleRate === 0) {
+            return;
+        }
+        if (this.streamId !== header.streamId) {
+            this.reset(header);
+        }
+
+        const delta = (header.sequence - this.maxSequence) | 0;
+        if (delta > 0) {
+            this.maxSequence = header.sequence;
+            this.extendedMax += delta;
+        }
+        this.received++;
+        this.bytes += size;
+        this.lastSequence = header.sequence;
+        this.lastArrival = now;
+
+        // Interarrival jitter in samples; DTX gaps move both clocks alike
+        const transit = now * this.sampleRate / 1000 - header.timestamp;
+        if (this.transit !== null) {
+            this.jitter += (Math.abs(transit - this.transit) - this.jitter) / 16;
+        }
+        this.transit = transit;
+    }
+
+    // backlogBytes: relay output still queued toward listeners
+    buildReport(now, backlogBytes) {
+        if (this.streamId === null || this.received === this.receivedPrior) {
+            return null;
+        }
+
+        const expected = this.extendedMax + 1;
+        const lost = Math.max(0, expected - this.received);
+        const expectedInterval = expected - this.expectedPrior;
+        const lostInterval = expectedInterval - (this.received - this.receivedPrior);
+        this.expectedPrior = expected;
+        this.receivedPrior = this.received;
+        const fraction = expectedInterval > 0 && lostInterval > 0
+            ? Math.min(255, Math.floor(lostInterval * 256 / expectedInterval))
+            : 0;
+
+        // Backlog in milliseconds of this sender's own byte rate
+        const bytesPerMs = this.bytes / REPORT_INTERVAL_MS;
+        this.bytes = 0;
+        const queueMs = bytesPerMs > 0 ? Math.min(0xffffffff, Math.round(backlogBytes / bytesPerMs)) : 0;
+
+        const report = Buffer.alloc(HEADER_SIZE + REPORT_SIZE);
+        report.writeUInt16BE(HEADER_MAGIC, 0);
+        report[2] = HEADER_VERSION;
+        report[3] = FLAG_REPORT;
+        report.writeUInt32BE(this.streamId, 4);
+        report.writeUInt32BE(this.reports++ >>> 0, 8);
+        report.writeUInt32BE(this.sampleRate, 20);
+        report[27] = 1;
+        report.writeUInt32BE(REPORT_SIZE, 28);
+
+        report.writeUInt32BE(this.maxSequence >>> 0, HEADER_SIZE);
+        report.writeUInt32BE(Math.min(lost, 0xffffffff), HEADER_SIZE + 4);
+        report[HEADER_SIZE + 8] = fraction;
+        report.writeUInt32BE(Math.min(Math.round(this.jitter), 0xffffffff), HEADER_SIZE + 12);
+        report.writeUInt32BE(this.lastSequence >>> 0, HEADER_SIZE + 16);
+        report.writeUInt32BE(Math.min(Math.round((now - this.lastArrival) * 1000), 0xffffffff), HEADER_SIZE + 20);
+        report.writeUInt32BE(queueMs, HEADER_SIZE + 24);
+        return report;
+    }
+}
+
+// Splits a TCP byte stream into header-framed packets. Sets raw once the
+// stream turns out not to carry headers (--raw senders).
+class FrameParser {
+    constructor() {
+        this.buffer = Buffer.alloc(0);
+        this.raw = false;
+    }
+
+    push(data) {
+        this.buffer = this.buffer.length > 0 ? Buffer.concat([this.buffer, data]) : data;
+        const frames = [];
+        while (this.buffer.length >= HEADER_SIZE) {
+            const header = parseHeader(this.buffer);
+            if (!header || header.payloadLength > MAX_PACKET_BYTES - HEADER_SIZE) {
+                this.raw = true;
+                break;
+            }
+            const size = HEADER_SIZE + header.payloadLength;
+            if (this.buffer.length < size) {
+                break;
+            }
+            frames.push({ header, frame: this.buffer.subarray(0, size) });
+            this.buffer = this.buffer.subarray(size);
+        }
+        return frames;
+    }
+
+    // Unparsed bytes, forwarded as-is when falling back to raw
+    takeRemainder() {
+        const rest = this.buffer;
+        this.buffer = Buffer.alloc(0);
+        return rest;
+    }
+}
+
 class LinuxCLIServer extends EventEmitter {
     constructor() {
         super();
@@ -26,6 +178,32 @@ class LinuxCLIServer extends EventEmitter {
         this.rooms = new Map();
         this.bridgeMode = false; // WebSocket to UDP bridge mode
         this.udpBridge = null;
+        this.reportTimer = null;
+    }
+
+    // Receiver reports go back to every header-framed sender once a second
+    startReports() {
+        if (this.reportTimer) {
+            return;
+        }
+        this.reportTimer = setInterval(() => {
+            const now = performance.now();
+            for (const [id, client] of this.clients.entries()) {
+                if (!client.stats) continue;
+                let backlog = 0;
+                for (const [otherId, other] of this.clients.entries()) {
+                    if (otherId !== id) backlog = Math.max(backlog, other.socket.writableLength);
+                }
+                const report = client.stats.buildReport(now, backlog);
+                if (report) client.socket.write(report);
+            }
+            for (const client of this.udpClients.values()) {
+                if (!client.stats) continue;
+                const report = client.stats.buildReport(now, 0);
+                if (report) this.udpServer.send(report, client.port, client.address);
+            }
+        }, REPORT_INTERVAL_MS);
+        this.reportTimer.unref();
     }
 
     startWebServer(port = 3000) {
@@ -196,13 +374,34 @@ class LinuxCLIServer extends EventEmitter {
             const clientId = `${socket.remoteAddress}:${socket.remotePort}`;
             console.log(`[TCP] Client connected: ${clientId}`);
 
-            socket.on('data', (data) => {
+            const relay = (data) => {
                 // Broadcast data to all other TCP clients
                 for (const [id, client] of this.clients.entries()) {
                     if (id !== clientId && client.socket) {
                         client.socket.write(data);
                     }
                 }
+            };
+
+            socket.on('data', (data) => {
+                const sender = this.clients.get(clientId);
+
+                // Framed senders are relayed a whole packet at a time, so
+                // receiver reports never land inside someone else's packet
+                if (sender && sender.parser) {
+                    const now = performance.now();
+                    for (const { header, frame } of sender.parser.push(data)) {
+                        sender.stats.onPacket(header, frame.length, now);
+                        relay(frame);
+                    }
+                    if (sender.parser.raw) {
+                        relay(sender.parser.takeRemainder());
+                        sender.parser = null;
+                        sender.stats = null;
+                    }
+                } else {
+                    relay(data);
+                }
                 console.log(`[TCP] Data relayed from ${clientId}: ${data.length} bytes`);
             });
 
@@ -216,7 +415,12 @@ class LinuxCLIServer extends EventEmitter {
                 this.clients.delete(clientId);
             });
 
-            this.clients.set(clientId, { socket, connectedAt: new Date() });
+            this.clients.set(clientId, {
+                socket,
+                connectedAt: new Date(),
+                parser: new FrameParser(),
+                stats: new ReceiverStats()
+            });
         });
 
         this.tcpServer.on('error', (err) => {
@@ -226,6 +430,7 @@ class LinuxCLIServer extends EventEmitter {
         this.tcpServer.listen(port, '0.0.0.0', () => {
             console.log(`[TCP] Server started on port ${port}`);
         });
+        this.startReports();
     }
     
     startUDPServer(port = 8081) {
@@ -239,10 +444,18 @@ class LinuxCLIServer extends EventEmitter {
                 this.udpClients.set(clientId, {
                     address: rinfo.address,
                     port: rinfo.port,
-                    connectedAt: new Date()
+                    connectedAt: new Date(),
+                    stats: null
                 });
                 console.log(`[UDP] Client connected: ${clientId}`);
             }
+
+            const header = parseHeader(msg);
+            if (header) {
+                const client = this.udpClients.get(clientId);
+                client.stats = client.stats || new ReceiverStats();
+                client.stats.onPacket(header, msg.length, performance.now());
+            }
             
             // Broadcast to all other UDP clients
             for (const [id, client] of this.udpClients.entries()) {
@@ -273,6 +486,7 @@ class LinuxCLIServer extends EventEmitter {
             console.log(`[UDP] Server started on port ${port}`);
             this.udpBridge = this.udpServer;
         });
+        this.startReports();
     }
     
     enableBridgeMode() {
@@ -323,6 +537,10 @@ class LinuxCLIServer extends EventEmitter {
             this.udpServer.close();
             console.log('[UDP] Server stopped');
         }
+        if (this.reportTimer) {
+            clearInterval(this.reportTimer);
+            this.reportTimer = null;
+        }
         this.clients.clear();
         this.udpClients.clear();
     }